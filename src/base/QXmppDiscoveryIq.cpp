@@ -132,6 +132,17 @@ std::optional<QXmppDataForm> QXmppDiscoInfo::dataForm(QStringView formType) cons
 /// Calculates an \xep{0115, Entity Capabilities} hash value of this service discovery data object.
 ///
 QByteArray QXmppDiscoInfo::calculateEntityCapabilitiesHash() const
+{
+    return calculateEntityCapabilitiesHash(QCryptographicHash::Sha1);
+}
+
+///
+/// Calculates an \xep{0115, Entity Capabilities} hash value of this service discovery data object
+/// using the given hash algorithm.
+///
+/// \since QXmpp 1.13
+///
+QByteArray QXmppDiscoInfo::calculateEntityCapabilitiesHash(QCryptographicHash::Algorithm algorithm) const
 {
     QString S;
 
@@ -182,7 +193,7 @@ QByteArray QXmppDiscoInfo::calculateEntityCapabilitiesHash() const
         }
     }
 
-    return QCryptographicHash::hash(S.toUtf8(), QCryptographicHash::Sha1);
+    return QCryptographicHash::hash(S.toUtf8(), algorithm);
 }
 
 /// \cond
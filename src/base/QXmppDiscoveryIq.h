@@ -9,6 +9,7 @@
 #include "QXmppDataFormBase.h"
 #include "QXmppIq.h"
 
+#include <QCryptographicHash>
 #include <QSharedDataPointer>
 
 class QXmppDiscoveryIdentityPrivate;
@@ -181,6 +182,7 @@ public:
     }
 
     QByteArray calculateEntityCapabilitiesHash() const;
+    QByteArray calculateEntityCapabilitiesHash(QCryptographicHash::Algorithm algorithm) const;
 
     /// \cond
     static constexpr std::tuple XmlTag = { u"query", QXmpp::Private::ns_disco_info };
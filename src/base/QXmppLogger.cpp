@@ -5,6 +5,8 @@
 
 #include "QXmppLogger.h"
 
+#include "QXmppMetrics.h"
+
 #include "StringLiterals.h"
 
 #include <iostream>
@@ -12,11 +14,16 @@
 #include <QChildEvent>
 #include <QDateTime>
 #include <QFile>
+#include <QHash>
+#include <QMetaMethod>
 #include <QMetaType>
+#include <QReadWriteLock>
 #include <QTextStream>
 
 QXmppLogger *QXmppLogger::m_logger = nullptr;
 
+#define LOG_MESSAGE_SIGNAL SIGNAL(logMessage(QXmppLogger::MessageType, QString))
+
 static QStringView typeName(QXmppLogger::MessageType type)
 {
     switch (type) {
@@ -50,6 +57,27 @@ static void relaySignals(QXmppLoggable *from, QXmppLoggable *to)
                      to, &QXmppLoggable::updateCounter);
 }
 
+namespace {
+
+// Message types wanted by the receivers of a loggable's logMessage() signal
+struct LoggedMessageTypes {
+    // types wanted by the receivers set up by QXmpp (the logger or the relay to the parent)
+    QXmppLogger::MessageTypes known = QXmppLogger::NoMessage;
+    int knownReceivers = 0;
+    // types returned by isLoggingEnabled(), any other receiver may want everything
+    QXmppLogger::MessageTypes effective = QXmppLogger::NoMessage;
+};
+
+// Kept outside of QXmppLoggable so its size doesn't change
+struct LoggedMessageTypesTable {
+    QReadWriteLock lock;
+    QHash<const QXmppLoggable *, LoggedMessageTypes> entries;
+};
+
+}  // namespace
+
+Q_GLOBAL_STATIC(LoggedMessageTypesTable, loggedMessageTypesTable)
+
 /// Constructs a new QXmppLoggable.
 ///
 /// \param parent
@@ -60,10 +88,131 @@ QXmppLoggable::QXmppLoggable(QObject *parent)
     auto *logParent = qobject_cast<QXmppLoggable *>(parent);
     if (logParent) {
         relaySignals(this, logParent);
+        setLoggedMessageTypes(logParent->loggedMessageTypes(), 1);
+    }
+}
+
+QXmppLoggable::~QXmppLoggable()
+{
+    if (auto *table = loggedMessageTypesTable()) {
+        QWriteLocker locker(&table->lock);
+        table->entries.remove(this);
+    }
+}
+
+///
+/// Returns whether anyone is interested in log messages of the given type.
+///
+/// This can be used to avoid building expensive log messages that would be discarded anyway.
+///
+/// \since QXmpp 1.13
+///
+bool QXmppLoggable::isLoggingEnabled(QXmppLogger::MessageType type) const
+{
+    return loggedMessageTypes().testFlag(type);
+}
+
+///
+/// Updates the cached message types returned by isLoggingEnabled() for this object and all of its
+/// children.
+///
+/// This needs to be called by the top-level loggable whenever \a logger has been (dis)connected or
+/// its settings have changed. Other receivers of logMessage() than \a logger enable all message
+/// types.
+///
+/// \since QXmpp 1.13
+///
+void QXmppLoggable::updateLoggedMessageTypes(QXmppLogger *logger)
+{
+    if (logger && logger->loggingType() != QXmppLogger::NoLogging) {
+        setLoggedMessageTypes(logger->messageTypes(), 1);
+    } else {
+        setLoggedMessageTypes(QXmppLogger::NoMessage, logger ? 1 : 0);
+    }
+}
+
+QXmppLogger::MessageTypes QXmppLoggable::loggedMessageTypes() const
+{
+    auto *table = loggedMessageTypesTable();
+    if (!table) {
+        return QXmppLogger::NoMessage;
+    }
+
+    QReadLocker locker(&table->lock);
+    return table->entries.value(this).effective;
+}
+
+// Sets the message types wanted by a loggable in another thread that this one relays its log
+// messages to. Parents are handled automatically. Needs to be called in the thread of this object.
+void QXmppLoggable::setRelayedMessageTypes(QXmppLogger::MessageTypes types)
+{
+    setLoggedMessageTypes(types, 1);
+}
+
+void QXmppLoggable::setLoggedMessageTypes(QXmppLogger::MessageTypes types, int knownReceivers)
+{
+    auto *table = loggedMessageTypesTable();
+    if (!table) {
+        return;
+    }
+
+    {
+        QWriteLocker locker(&table->lock);
+        auto &entry = table->entries[this];
+        entry.known = types;
+        entry.knownReceivers = knownReceivers;
+    }
+    updateEffectiveLoggedMessageTypes();
+}
+
+void QXmppLoggable::updateEffectiveLoggedMessageTypes()
+{
+    auto *table = loggedMessageTypesTable();
+    if (!table) {
+        return;
+    }
+
+    const auto receiverCount = receivers(LOG_MESSAGE_SIGNAL);
+
+    QXmppLogger::MessageTypes types;
+    {
+        QWriteLocker locker(&table->lock);
+        auto &entry = table->entries[this];
+        if (receiverCount == 0) {
+            entry.effective = QXmppLogger::NoMessage;
+        } else if (receiverCount > entry.knownReceivers) {
+            entry.effective = QXmppLogger::AnyMessage;
+        } else {
+            entry.effective = entry.known;
+        }
+        types = entry.effective;
+    }
+
+    // children relay their messages to us
+    const auto children = this->children();
+    for (auto *child : children) {
+        if (auto *loggable = qobject_cast<QXmppLoggable *>(child)) {
+            loggable->setLoggedMessageTypes(types, 1);
+        }
     }
 }
 
 /// \cond
+void QXmppLoggable::connectNotify(const QMetaMethod &signal)
+{
+    if (signal == QMetaMethod::fromSignal(&QXmppLoggable::logMessage)) {
+        updateEffectiveLoggedMessageTypes();
+    }
+}
+
+void QXmppLoggable::disconnectNotify(const QMetaMethod &signal)
+{
+    // an invalid signal means everything has been disconnected
+    if (!signal.isValid() || signal == QMetaMethod::fromSignal(&QXmppLoggable::logMessage)) {
+        updateEffectiveLoggedMessageTypes();
+    }
+}
+
 void QXmppLoggable::childEvent(QChildEvent *event)
 {
     auto *child = qobject_cast<QXmppLoggable *>(event->child());
@@ -73,6 +222,7 @@ void QXmppLoggable::childEvent(QChildEvent *event)
 
     if (event->added()) {
         relaySignals(child, this);
+        child->setLoggedMessageTypes(loggedMessageTypes(), 1);
     } else if (event->removed()) {
         disconnect(child, &QXmppLoggable::logMessage,
                    this, &QXmppLoggable::logMessage);
@@ -93,6 +243,7 @@ public:
     QFile *logFile;
     QString logFilePath;
     QXmppLogger::MessageTypes messageTypes;
+    std::shared_ptr<QXmppMetrics> metrics;
 };
 
 QXmppLoggerPrivate::QXmppLoggerPrivate()
@@ -175,6 +326,49 @@ void QXmppLogger::setMessageTypes(QXmppLogger::MessageTypes types)
 /// \since QXmpp 1.7
 ///
 
+///
+/// Returns the registry that records the gauges and counters, nullptr if metrics are disabled.
+///
+/// \since QXmpp 1.13
+///
+std::shared_ptr<QXmppMetrics> QXmppLogger::metrics() const
+{
+    return d->metrics;
+}
+
+///
+/// Sets the registry that records the gauges and counters, nullptr disables metrics.
+///
+/// Clients and servers using this logger additionally record the stanzas and bytes they send and
+/// receive, the time spent parsing, routing and authenticating in the registry. The registry can
+/// be shared by multiple loggers.
+///
+/// \code
+/// auto metrics = std::make_shared<QXmppMetrics>();
+/// logger.setMetrics(metrics);
+///
+/// auto *exporter = new QXmppMetricsHttpExporter(metrics, &logger);
+/// exporter->listen(QHostAddress::LocalHost, 9100);
+/// \endcode
+///
+/// \since QXmpp 1.13
+///
+void QXmppLogger::setMetrics(std::shared_ptr<QXmppMetrics> metrics)
+{
+    if (d->metrics != metrics) {
+        d->metrics = std::move(metrics);
+        Q_EMIT metricsChanged();
+    }
+}
+
+///
+/// \fn QXmppLogger::metricsChanged()
+///
+/// Emitted when the metrics registry has been changed.
+///
+/// \since QXmpp 1.13
+///
+
 /// Add a logging message.
 void QXmppLogger::log(QXmppLogger::MessageType type, const QString &text)
 {
@@ -205,23 +399,29 @@ void QXmppLogger::log(QXmppLogger::MessageType type, const QString &text)
 ///
 /// Sets the given \a gauge to \a value.
 ///
-/// NOTE: the base implementation does nothing.
+/// The base implementation records the value in metrics() if set.
 ///
 void QXmppLogger::setGauge(const QString &gauge, double value)
 {
-    Q_UNUSED(gauge)
-    Q_UNUSED(value)
+    if (d->metrics) {
+        if (auto *handle = d->metrics->gauge(gauge)) {
+            handle->set(value);
+        }
+    }
 }
 
 ///
 /// Updates the given \a counter by \a amount.
 ///
-/// NOTE: the base implementation does nothing.
+/// The base implementation records the update in metrics() if set.
 ///
 void QXmppLogger::updateCounter(const QString &counter, qint64 amount)
 {
-    Q_UNUSED(counter)
-    Q_UNUSED(amount)
+    if (d->metrics) {
+        if (auto *handle = d->metrics->counter(counter)) {
+            handle->increment(amount);
+        }
+    }
 }
 
 QString QXmppLogger::logFilePath()
@@ -19,6 +19,7 @@
 #endif
 
 class QXmppLoggerPrivate;
+class QXmppMetrics;
 
 ///
 /// \brief The QXmppLogger class represents a sink for logging messages.
@@ -86,6 +87,10 @@ public:
     void setMessageTypes(QXmppLogger::MessageTypes types);
     Q_SIGNAL void messageTypesChanged();
 
+    std::shared_ptr<QXmppMetrics> metrics() const;
+    void setMetrics(std::shared_ptr<QXmppMetrics> metrics);
+    Q_SIGNAL void metricsChanged();
+
 public Q_SLOTS:
     virtual void setGauge(const QString &gauge, double value);
     virtual void updateCounter(const QString &counter, qint64 amount);
@@ -112,6 +117,12 @@ class QXMPP_EXPORT QXmppLoggable : public QObject
 
 public:
     QXmppLoggable(QObject *parent = nullptr);
+    ~QXmppLoggable() override;
+
+    /// \cond
+    QXmppLogger::MessageTypes loggedMessageTypes() const;
+    void setRelayedMessageTypes(QXmppLogger::MessageTypes types);
+    /// \endcond
 
 protected:
     /// \cond
@@ -151,7 +162,9 @@ protected:
 
     void logReceived(const QString &message)
     {
-        Q_EMIT logMessage(QXmppLogger::ReceivedMessage, qxmpp_loggable_trace(message));
+        if (isLoggingEnabled(QXmppLogger::ReceivedMessage)) {
+            Q_EMIT logMessage(QXmppLogger::ReceivedMessage, qxmpp_loggable_trace(message));
+        }
     }
 
     /// Logs a sent packet.
@@ -160,9 +173,19 @@ protected:
 
     void logSent(const QString &message)
     {
-        Q_EMIT logMessage(QXmppLogger::SentMessage, qxmpp_loggable_trace(message));
+        if (isLoggingEnabled(QXmppLogger::SentMessage)) {
+            Q_EMIT logMessage(QXmppLogger::SentMessage, qxmpp_loggable_trace(message));
+        }
     }
 
+    bool isLoggingEnabled(QXmppLogger::MessageType type) const;
+    void updateLoggedMessageTypes(QXmppLogger *logger);
+
+    /// \cond
+    void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
+    /// \endcond
+
 Q_SIGNALS:
     /// Sets the given \a gauge to \a value.
     void setGauge(const QString &gauge, double value);
@@ -172,6 +195,10 @@ Q_SIGNALS:
 
     /// Updates the given \a counter by \a amount.
     void updateCounter(const QString &counter, qint64 amount = 1);
+
+private:
+    void setLoggedMessageTypes(QXmppLogger::MessageTypes types, int knownReceivers);
+    void updateEffectiveLoggedMessageTypes();
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(QXmppLogger::MessageTypes)
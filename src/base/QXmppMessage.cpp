@@ -31,12 +31,16 @@
 
 #include "XmlWriter.h"
 
+#include <array>
+#include <limits>
 #include <ranges>
 
 #include <QDateTime>
 #include <QDomElement>
+#include <QHash>
 #include <QTextStream>
 #include <QTimeZone>
+#include <QVarLengthArray>
 #include <QXmlStreamWriter>
 
 using namespace QXmpp;
@@ -1618,6 +1622,304 @@ void QXmppMessage::toXml(QXmlStreamWriter *writer, QXmpp::SceMode sceMode) const
 }
 /// \endcond
 
+// Part of the message an extension element is parsed from (see QXmpp::SceMode).
+enum class ExtensionScope : uint8_t {
+    Public,
+    // only when parsing nothing but the public part
+    PublicOnly,
+    Sensitive,
+    Any,
+};
+
+struct MessageExtensionParser {
+    // empty for all namespaces
+    QStringView xmlns;
+    // empty for all tags of the namespace
+    QStringView tagName;
+    ExtensionScope scope;
+    // returns false if the element is not handled after all
+    bool (*parse)(QXmppMessage &message, QXmppMessagePrivate &d, const QDomElement &element);
+};
+
+// Known message extensions. If multiple parsers match an element, the first one is used.
+static constexpr auto MESSAGE_EXTENSION_PARSERS = std::to_array<MessageExtensionParser>({
+    { {}, u"body", ExtensionScope::PublicOnly, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.e2eeFallbackBody = el.text();
+         return true;
+     } },
+    // XEP-0280: Message Carbons
+    { ns_carbons, u"private", ExtensionScope::Public, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &) {
+         d.privatemsg = true;
+         return true;
+     } },
+    // XEP-0334: Message Processing Hints
+    { ns_message_processing_hints, {}, ExtensionScope::Public, [](QXmppMessage &message, QXmppMessagePrivate &, const QDomElement &el) {
+         if (auto type = Enums::fromString<QXmppMessage::Hint>(el.tagName())) {
+             message.addHint(*type);
+         }
+         return true;
+     } },
+    // XEP-0353: Jingle Message Initiation
+    { ns_jingle_message, {}, ExtensionScope::Public, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         if (!QXmppJingleMessageInitiationElement::isJingleMessageInitiationElement(el)) {
+             return false;
+         }
+         d.jingleMessageInitiationElement = parseOptionalElement<QXmppJingleMessageInitiationElement>(el);
+         return true;
+     } },
+    // XEP-0359: Unique and Stable Stanza IDs
+    { ns_sid, u"stanza-id", ExtensionScope::Public, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.stanzaIds.push_back(QXmppStanzaId {
+             el.attribute(u"id"_s),
+             el.attribute(u"by"_s),
+         });
+         return true;
+     } },
+    { ns_sid, u"origin-id", ExtensionScope::Public, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.originId = el.attribute(u"id"_s);
+         return true;
+     } },
+    // XEP-0369: Mediated Information eXchange (MIX)
+    { ns_mix, u"mix", ExtensionScope::Public, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.mixUserJid = el.firstChildElement(u"jid"_s).text();
+         d.mixUserNick = el.firstChildElement(u"nick"_s).text();
+         return true;
+     } },
+    // XEP-0380: Explicit Message Encryption
+    { ns_eme, u"encryption", ExtensionScope::Public, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.encryptionMethod = el.attribute(u"namespace"_s);
+         d.encryptionName = el.attribute(u"name"_s);
+         return true;
+     } },
+#ifdef BUILD_OMEMO
+    // XEP-0384: OMEMO Encryption
+    { ns_omemo_2, u"encrypted", ExtensionScope::Public, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.omemoElement = parseOptionalElement<QXmppOmemoElement>(el);
+         return true;
+     } },
+#endif
+    // XEP-0482: Call Invites
+    { ns_call_invites, {}, ExtensionScope::Public, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         if (!QXmppCallInviteElement::isCallInviteElement(el)) {
+             return false;
+         }
+         d.callInviteElement = parseOptionalElement<QXmppCallInviteElement>(el);
+         return true;
+     } },
+    { {}, u"body", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.body = el.text();
+         return true;
+     } },
+    { {}, u"subject", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.subject = el.text();
+         return true;
+     } },
+    { {}, u"thread", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.thread = el.text();
+         d.parentThread = el.attribute(u"parent"_s);
+         return true;
+     } },
+    // XEP-0091: Legacy Delayed Delivery
+    { ns_legacy_delayed_delivery, u"x", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         // if XEP-0203 exists, XEP-0091 has no need to parse because XEP-0091
+         // is no more standard protocol)
+         if (d.stamp.isNull()) {
+             d.stamp = QDateTime::fromString(
+                 el.attribute(u"stamp"_s),
+                 u"yyyyMMddThh:mm:ss"_s);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+             d.stamp.setTimeZone(QTimeZone::Initialization::UTC);
+#else
+             d.stamp.setTimeZone(QTimeZone(0));
+#endif
+             d.stampType = LegacyDelayedDelivery;
+         }
+         return true;
+     } },
+    // XEP-0249: Direct MUC Invitations
+    { ns_conference, u"x", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.mucInvitationJid = el.attribute(u"jid"_s);
+         d.mucInvitationPassword = el.attribute(u"password"_s);
+         d.mucInvitationReason = el.attribute(u"reason"_s);
+         return true;
+     } },
+    // XEP-0066: Out of Band Data
+    { ns_oob, u"x", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         QXmppOutOfBandUrl data;
+         data.parse(el);
+         d.outOfBandUrls.push_back(std::move(data));
+         return true;
+     } },
+    // XEP-0071: XHTML-IM
+    { ns_xhtml_im, u"html", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         QDomElement bodyElement = el.firstChildElement(u"body"_s);
+         if (!bodyElement.isNull() && bodyElement.namespaceURI() == ns_xhtml) {
+             QTextStream stream(&d.xhtml, QIODevice::WriteOnly);
+             bodyElement.save(stream, 0);
+
+             d.xhtml = d.xhtml.mid(d.xhtml.indexOf(u'>') + 1);
+             d.xhtml.replace(
+                 u" xmlns=\"http://www.w3.org/1999/xhtml\""_s,
+                 QString());
+             d.xhtml.replace(u"</body>"_s, QString());
+             d.xhtml = d.xhtml.trimmed();
+         }
+         return true;
+     } },
+    // XEP-0085: Chat State Notifications
+    { ns_chat_states, {}, ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.state = Enums::fromString<QXmppMessage::State>(el.tagName()).value_or(QXmppMessage::None);
+         return true;
+     } },
+    // XEP-0184: Message Delivery Receipts
+    { ns_message_receipts, u"received", ExtensionScope::Sensitive, [](QXmppMessage &message, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.receiptId = el.attribute(u"id"_s);
+
+         // compatibility with old-style XEP
+         if (d.receiptId.isEmpty()) {
+             d.receiptId = message.id();
+         }
+         return true;
+     } },
+    { ns_message_receipts, u"request", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &) {
+         d.receiptRequested = true;
+         return true;
+     } },
+    // XEP-0203: Delayed Delivery
+    { ns_delayed_delivery, u"delay", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.stamp = QXmppUtils::datetimeFromString(el.attribute(u"stamp"_s));
+         d.stampType = DelayedDelivery;
+         return true;
+     } },
+    // XEP-0224: Attention
+    { ns_attention, u"attention", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &) {
+         d.attentionRequested = true;
+         return true;
+     } },
+    // XEP-0231: Bits of Binary
+    { ns_bob, u"data", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         QXmppBitsOfBinaryData data;
+         data.parseElementFromChild(el);
+         d.bitsOfBinaryData << data;
+         return true;
+     } },
+    // XEP-0308: Last Message Correction
+    { ns_message_correct, u"replace", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.replaceId = el.attribute(u"id"_s);
+         return true;
+     } },
+    // XEP-0333: Chat Markers
+    { ns_chat_markers, {}, ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         if (el.tagName() == u"markable") {
+             d.markable = true;
+         } else {
+             if (auto marker = Enums::fromString<QXmppMessage::Marker>(el.tagName())) {
+                 d.marker = *marker;
+                 d.markedId = el.attribute(u"id"_s);
+                 d.markedThread = el.attribute(u"thread"_s);
+             }
+         }
+         return true;
+     } },
+    // XEP-0367: Message Attaching
+    { ns_message_attaching, u"attach-to", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.attachId = el.attribute(u"id"_s);
+         return true;
+     } },
+    // XEP-0382: Spoiler messages
+    { ns_spoiler, u"spoiler", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.isSpoiler = true;
+         d.spoilerHint = el.text();
+         return true;
+     } },
+    // XEP-0407: Mediated Information eXchange (MIX): Miscellaneous Capabilities
+    { ns_mix_misc, u"invitation", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.mixInvitation = parseOptionalElement<QXmppMixInvitation>(el);
+         return true;
+     } },
+    // XEP-0434: Trust Messages (TM)
+    { ns_tm, u"trust-message", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.trustMessageElement = parseOptionalElement<QXmppTrustMessageElement>(el);
+         return true;
+     } },
+    // XEP-0444: Message Reactions
+    { ns_reactions, u"reactions", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.reaction = parseOptionalElement<QXmppMessageReaction>(el);
+         return true;
+     } },
+    // XEP-0447: Stateless file sharing
+    { ns_sfs, u"file-sharing", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         QXmppFileShare share;
+         if (share.parse(el)) {
+             d.sharedFiles.push_back(std::move(share));
+         }
+         return true;
+     } },
+    // XEP-0461: Message Replies
+    { ns_reply, u"reply", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         d.reply = Reply {
+             el.attribute(u"to"_s),
+             el.attribute(u"id"_s),
+         };
+         return true;
+     } },
+    { ns_sfs, u"sources", ExtensionScope::Sensitive, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         if (auto fileSources = QXmppFileSourcesAttachment::fromDom(el)) {
+             d.fileSourcesAttachments.push_back(std::move(*fileSources));
+         }
+         return true;
+     } },
+    // XEP-0428: Fallback Indication
+    { ns_fallback_indication, u"fallback", ExtensionScope::Any, [](QXmppMessage &, QXmppMessagePrivate &d, const QDomElement &el) {
+         if (auto fallback = QXmppFallback::fromDom(el)) {
+             d.fallbackMarkers.push_back(std::move(*fallback));
+         }
+         return true;
+     } },
+});
+
+// Positions of the parsers in MESSAGE_EXTENSION_PARSERS by namespace (in ascending order)
+struct MessageExtensionIndex {
+    using Positions = QVarLengthArray<quint8, 4>;
+
+    QHash<QStringView, Positions> byNamespace;
+    Positions allNamespaces;
+};
+
+static const MessageExtensionIndex &messageExtensionIndex()
+{
+    static_assert(MESSAGE_EXTENSION_PARSERS.size() <= std::numeric_limits<quint8>::max());
+
+    static const auto index = [] {
+        MessageExtensionIndex index;
+        for (quint8 i = 0; i < MESSAGE_EXTENSION_PARSERS.size(); i++) {
+            const auto &parser = MESSAGE_EXTENSION_PARSERS[i];
+            if (parser.xmlns.isEmpty()) {
+                index.allNamespaces.append(i);
+            } else {
+                index.byNamespace[parser.xmlns].append(i);
+            }
+        }
+        return index;
+    }();
+    return index;
+}
+
+static bool matchesScope(ExtensionScope scope, QXmpp::SceMode sceMode)
+{
+    switch (scope) {
+    case ExtensionScope::Public:
+        return sceMode & QXmpp::ScePublic;
+    case ExtensionScope::PublicOnly:
+        return sceMode == QXmpp::ScePublic;
+    case ExtensionScope::Sensitive:
+        return sceMode & QXmpp::SceSensitive;
+    case ExtensionScope::Any:
+        return true;
+    }
+    return false;
+}
+
 ///
 /// Parses all child elements of a message stanza.
 ///
@@ -1656,243 +1958,28 @@ void QXmppMessage::parseExtensions(const QDomElement &element, const QXmpp::SceM
 ///
 bool QXmppMessage::parseExtension(const QDomElement &element, QXmpp::SceMode sceMode)
 {
-    if (sceMode & QXmpp::ScePublic) {
-        if (sceMode == QXmpp::ScePublic && element.tagName() == u"body") {
-            d->e2eeFallbackBody = element.text();
-            return true;
-        }
-
-        // XEP-0280: Message Carbons
-        if (checkElement(element, u"private", ns_carbons)) {
-            d->privatemsg = true;
-            return true;
-        }
-        // XEP-0334: Message Processing Hints
-        if (element.namespaceURI() == ns_message_processing_hints) {
-            if (auto type = Enums::fromString<Hint>(element.tagName())) {
-                addHint(*type);
-            }
-            return true;
-        }
-        // XEP-0353: Jingle Message Initiation
-        if (QXmppJingleMessageInitiationElement::isJingleMessageInitiationElement(element)) {
-            d->jingleMessageInitiationElement = parseOptionalElement<QXmppJingleMessageInitiationElement>(element);
-            return true;
-        }
-        // XEP-0359: Unique and Stable Stanza IDs
-        if (checkElement(element, u"stanza-id", ns_sid)) {
-            d->stanzaIds.push_back(QXmppStanzaId {
-                element.attribute(u"id"_s),
-                element.attribute(u"by"_s),
-            });
-            return true;
-        }
-        if (checkElement(element, u"origin-id", ns_sid)) {
-            d->originId = element.attribute(u"id"_s);
-            return true;
-        }
-        // XEP-0369: Mediated Information eXchange (MIX)
-        if (checkElement(element, u"mix", ns_mix)) {
-            d->mixUserJid = element.firstChildElement(u"jid"_s).text();
-            d->mixUserNick = element.firstChildElement(u"nick"_s).text();
+    const auto &index = messageExtensionIndex();
+    const auto xmlns = element.namespaceURI();
+    const auto tagName = element.tagName();
+
+    static const MessageExtensionIndex::Positions noPositions;
+    auto namespaceItr = index.byNamespace.constFind(xmlns);
+    const auto &namespacePositions = namespaceItr != index.byNamespace.cend() ? *namespaceItr : noPositions;
+
+    // merge parsers for the namespace and for all namespaces, keeping the order of the table
+    auto nsItr = namespacePositions.cbegin();
+    auto allItr = index.allNamespaces.cbegin();
+    while (nsItr != namespacePositions.cend() || allItr != index.allNamespaces.cend()) {
+        const auto position = (allItr == index.allNamespaces.cend() || (nsItr != namespacePositions.cend() && *nsItr < *allItr))
+            ? *nsItr++
+            : *allItr++;
+
+        const auto &parser = MESSAGE_EXTENSION_PARSERS[position];
+        if (matchesScope(parser.scope, sceMode) &&
+            (parser.tagName.isEmpty() || parser.tagName == tagName) &&
+            parser.parse(*this, *d, element)) {
             return true;
         }
-        // XEP-0380: Explicit Message Encryption
-        if (checkElement(element, u"encryption", ns_eme)) {
-            d->encryptionMethod = element.attribute(u"namespace"_s);
-            d->encryptionName = element.attribute(u"name"_s);
-            return true;
-        }
-#ifdef BUILD_OMEMO
-        // XEP-0384: OMEMO Encryption
-        if (QXmppOmemoElement::isOmemoElement(element)) {
-            d->omemoElement = parseOptionalElement<QXmppOmemoElement>(element);
-            return true;
-        }
-#endif
-        // XEP-0482: Call Invites
-        if (QXmppCallInviteElement::isCallInviteElement(element)) {
-            d->callInviteElement = parseOptionalElement<QXmppCallInviteElement>(element);
-            return true;
-        }
-    }
-    if (sceMode & QXmpp::SceSensitive) {
-        if (element.tagName() == u"body") {
-            d->body = element.text();
-            return true;
-        }
-        if (element.tagName() == u"subject") {
-            d->subject = element.text();
-            return true;
-        }
-        if (element.tagName() == u"thread") {
-            d->thread = element.text();
-            d->parentThread = element.attribute(u"parent"_s);
-            return true;
-        }
-        if (element.tagName() == u"x") {
-            if (element.namespaceURI() == ns_legacy_delayed_delivery) {
-                // if XEP-0203 exists, XEP-0091 has no need to parse because XEP-0091
-                // is no more standard protocol)
-                if (d->stamp.isNull()) {
-                    // XEP-0091: Legacy Delayed Delivery
-                    d->stamp = QDateTime::fromString(
-                        element.attribute(u"stamp"_s),
-                        u"yyyyMMddThh:mm:ss"_s);
-#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
-                    d->stamp.setTimeZone(QTimeZone::Initialization::UTC);
-#else
-                    d->stamp.setTimeZone(QTimeZone(0));
-#endif
-                    d->stampType = LegacyDelayedDelivery;
-                }
-                return true;
-            }
-            // XEP-0249: Direct MUC Invitations
-            if (element.namespaceURI() == ns_conference) {
-                d->mucInvitationJid = element.attribute(u"jid"_s);
-                d->mucInvitationPassword = element.attribute(u"password"_s);
-                d->mucInvitationReason = element.attribute(u"reason"_s);
-                return true;
-            }
-            // XEP-0066: Out of Band Data
-            if (element.namespaceURI() == ns_oob) {
-                QXmppOutOfBandUrl data;
-                data.parse(element);
-                d->outOfBandUrls.push_back(std::move(data));
-                return true;
-            }
-        }
-        // XEP-0071: XHTML-IM
-        if (checkElement(element, u"html", ns_xhtml_im)) {
-            QDomElement bodyElement = element.firstChildElement(u"body"_s);
-            if (!bodyElement.isNull() && bodyElement.namespaceURI() == ns_xhtml) {
-                QTextStream stream(&d->xhtml, QIODevice::WriteOnly);
-                bodyElement.save(stream, 0);
-
-                d->xhtml = d->xhtml.mid(d->xhtml.indexOf(u'>') + 1);
-                d->xhtml.replace(
-                    u" xmlns=\"http://www.w3.org/1999/xhtml\""_s,
-                    QString());
-                d->xhtml.replace(u"</body>"_s, QString());
-                d->xhtml = d->xhtml.trimmed();
-            }
-            return true;
-        }
-        // XEP-0085: Chat State Notifications
-        if (element.namespaceURI() == ns_chat_states) {
-            d->state = Enums::fromString<State>(element.tagName()).value_or(None);
-            return true;
-        }
-        // XEP-0184: Message Delivery Receipts
-        if (checkElement(element, u"received", ns_message_receipts)) {
-            d->receiptId = element.attribute(u"id"_s);
-
-            // compatibility with old-style XEP
-            if (d->receiptId.isEmpty()) {
-                d->receiptId = id();
-            }
-            return true;
-        }
-        if (checkElement(element, u"request", ns_message_receipts)) {
-            d->receiptRequested = true;
-            return true;
-        }
-        // XEP-0203: Delayed Delivery
-        if (checkElement(element, u"delay", ns_delayed_delivery)) {
-            d->stamp = QXmppUtils::datetimeFromString(
-                element.attribute(u"stamp"_s));
-            d->stampType = DelayedDelivery;
-            return true;
-        }
-        // XEP-0224: Attention
-        if (checkElement(element, u"attention", ns_attention)) {
-            d->attentionRequested = true;
-            return true;
-        }
-        // XEP-0231: Bits of Binary
-        if (QXmppBitsOfBinaryData::isBitsOfBinaryData(element)) {
-            QXmppBitsOfBinaryData data;
-            data.parseElementFromChild(element);
-            d->bitsOfBinaryData << data;
-            return true;
-        }
-        // XEP-0308: Last Message Correction
-        if (checkElement(element, u"replace", ns_message_correct)) {
-            d->replaceId = element.attribute(u"id"_s);
-            return true;
-        }
-        // XEP-0333: Chat Markers
-        if (element.namespaceURI() == ns_chat_markers) {
-            if (element.tagName() == u"markable") {
-                d->markable = true;
-            } else {
-                if (auto marker = Enums::fromString<Marker>(element.tagName())) {
-                    d->marker = *marker;
-                    d->markedId = element.attribute(u"id"_s);
-                    d->markedThread = element.attribute(u"thread"_s);
-                }
-            }
-            return true;
-        }
-        // XEP-0367: Message Attaching
-        if (checkElement(element, u"attach-to", ns_message_attaching)) {
-            d->attachId = element.attribute(u"id"_s);
-            return true;
-        }
-        // XEP-0382: Spoiler messages
-        if (checkElement(element, u"spoiler", ns_spoiler)) {
-            d->isSpoiler = true;
-            d->spoilerHint = element.text();
-            return true;
-        }
-        // XEP-0407: Mediated Information eXchange (MIX): Miscellaneous Capabilities
-        if (checkElement(element, u"invitation", ns_mix_misc)) {
-            d->mixInvitation = parseOptionalElement<QXmppMixInvitation>(element);
-            return true;
-        }
-        // XEP-0434: Trust Messages (TM)
-        if (QXmppTrustMessageElement::isTrustMessageElement(element)) {
-            d->trustMessageElement = parseOptionalElement<QXmppTrustMessageElement>(element);
-            return true;
-        }
-        // XEP-0444: Message Reactions
-        if (QXmppMessageReaction::isMessageReaction(element)) {
-            d->reaction = parseOptionalElement<QXmppMessageReaction>(element);
-            return true;
-        }
-        // XEP-0447: Stateless file sharing
-        if (checkElement(element, u"file-sharing", ns_sfs)) {
-            QXmppFileShare share;
-            if (share.parse(element)) {
-                d->sharedFiles.push_back(std::move(share));
-            }
-            return true;
-        }
-        // XEP-0461: Message Replies
-        if (checkElement(element, u"reply", ns_reply)) {
-            d->reply = Reply {
-                element.attribute(u"to"_s),
-                element.attribute(u"id"_s),
-            };
-            return true;
-        }
-        if (checkElement(element, u"sources", ns_sfs)) {
-            if (auto fileSources = QXmppFileSourcesAttachment::fromDom(element)) {
-                d->fileSourcesAttachments.push_back(std::move(*fileSources));
-            }
-            return true;
-        }
-    }
-
-    // read from both public and private extensions:
-
-    // XEP-0428: Fallback Indication
-    if (checkElement(element, u"fallback", ns_fallback_indication)) {
-        if (auto fallback = QXmppFallback::fromDom(element)) {
-            d->fallbackMarkers.push_back(std::move(*fallback));
-        }
-        return true;
     }
     return false;
 }
@@ -0,0 +1,285 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "QXmppMetrics.h"
+
+#include "QXmppMetrics_p.h"
+#include "QXmppVisitHelper_p.h"
+
+#include "StringLiterals.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <optional>
+#include <type_traits>
+#include <variant>
+
+#include <QLocale>
+#include <QReadWriteLock>
+#include <QSet>
+
+using namespace QXmpp::Private;
+
+using Metric = std::variant<std::unique_ptr<QXmppMetrics::Counter>,
+                            std::unique_ptr<QXmppMetrics::Gauge>,
+                            std::unique_ptr<QXmppMetrics::Histogram>>;
+
+class QXmppMetricsPrivate
+{
+public:
+    template<typename T, typename... Args>
+    T *get(const QString &name, Args &&...args);
+
+    mutable QReadWriteLock lock;
+    // sorted by name, so the export is stable
+    std::map<QString, Metric> metrics;
+    // names of the exported families and samples, different names may map to the same one
+    QSet<QString> exportedNames;
+};
+
+// Returns the names of the family and the samples of a metric in the export.
+template<typename T>
+static QList<QString> exportedSampleNames(const QString &name)
+{
+    const auto family = QXmppMetrics::exportName(name);
+    if constexpr (std::is_same_v<T, QXmppMetrics::Counter>) {
+        return { family, family + u"_total" };
+    } else if constexpr (std::is_same_v<T, QXmppMetrics::Histogram>) {
+        return { family, family + u"_bucket", family + u"_sum", family + u"_count" };
+    } else {
+        return { family };
+    }
+}
+
+// Returns the metric with the given name and creates it if needed.
+template<typename T, typename... Args>
+T *QXmppMetricsPrivate::get(const QString &name, Args &&...args)
+{
+    auto find = [&]() -> std::optional<T *> {
+        const auto itr = metrics.find(name);
+        if (itr == metrics.end()) {
+            return {};
+        }
+        // a metric of another type may have been registered with the name
+        const auto *metric = std::get_if<std::unique_ptr<T>>(&itr->second);
+        return metric ? metric->get() : nullptr;
+    };
+
+    {
+        QReadLocker locker(&lock);
+        if (auto metric = find()) {
+            return *metric;
+        }
+    }
+
+    QWriteLocker locker(&lock);
+    if (auto metric = find()) {
+        return *metric;
+    }
+    // the metric would be indistinguishable from another one in the export
+    const auto names = exportedSampleNames<T>(name);
+    if (std::any_of(names.cbegin(), names.cend(), [&](const auto &exportedName) { return exportedNames.contains(exportedName); })) {
+        return nullptr;
+    }
+    for (const auto &exportedName : names) {
+        exportedNames.insert(exportedName);
+    }
+
+    auto metric = std::make_unique<T>(std::forward<Args>(args)...);
+    auto *handle = metric.get();
+    metrics.emplace(name, std::move(metric));
+    return handle;
+}
+
+static QByteArray formatValue(double value)
+{
+    if (std::isnan(value)) {
+        return QByteArrayLiteral("NaN");
+    }
+    if (std::isinf(value)) {
+        return value > 0 ? QByteArrayLiteral("+Inf") : QByteArrayLiteral("-Inf");
+    }
+    return QByteArray::number(value, 'g', QLocale::FloatingPointShortest);
+}
+
+///
+/// Creates a histogram with the given bucket upper bounds. The bounds are sorted and a bucket for
+/// +Inf is always added.
+///
+QXmppMetrics::Histogram::Histogram(QList<double> upperBounds)
+    : m_upperBounds(std::move(upperBounds)),
+      m_buckets(m_upperBounds.size() + 1)
+{
+    std::sort(m_upperBounds.begin(), m_upperBounds.end());
+}
+
+/// Adds \a value to the histogram.
+void QXmppMetrics::Histogram::observe(double value)
+{
+    // upper bounds are inclusive
+    const auto bucket = std::lower_bound(m_upperBounds.cbegin(), m_upperBounds.cend(), value) - m_upperBounds.cbegin();
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+///
+/// Returns the number of observed values that fell into the bucket with the given index (not
+/// cumulative). The index upperBounds().size() is the bucket for +Inf.
+///
+quint64 QXmppMetrics::Histogram::bucketCount(qsizetype index) const
+{
+    return m_buckets.at(index).load(std::memory_order_relaxed);
+}
+
+/// Constructs an empty registry.
+QXmppMetrics::QXmppMetrics()
+    : d(std::make_unique<QXmppMetricsPrivate>())
+{
+}
+
+QXmppMetrics::~QXmppMetrics() = default;
+
+///
+/// Returns the counter with the given name, it is created if needed.
+///
+/// Returns nullptr if a metric of another type has been registered with the name, or if the name
+/// would be exported like the name of another metric (see exportName()).
+///
+QXmppMetrics::Counter *QXmppMetrics::counter(const QString &name)
+{
+    return d->get<Counter>(name);
+}
+
+///
+/// Returns the gauge with the given name, it is created if needed.
+///
+/// Returns nullptr if a metric of another type has been registered with the name, or if the name
+/// would be exported like the name of another metric (see exportName()).
+///
+QXmppMetrics::Gauge *QXmppMetrics::gauge(const QString &name)
+{
+    return d->get<Gauge>(name);
+}
+
+///
+/// Returns the histogram with the given name, it is created with the given bucket upper bounds if
+/// needed.
+///
+/// Returns nullptr if a metric of another type has been registered with the name, or if the name
+/// would be exported like the name of another metric (see exportName()).
+///
+QXmppMetrics::Histogram *QXmppMetrics::histogram(const QString &name, const QList<double> &upperBounds)
+{
+    return d->get<Histogram>(name, upperBounds);
+}
+
+///
+/// Returns the default bucket upper bounds for durations in seconds, from 0.5 ms to 10 s.
+///
+QList<double> QXmppMetrics::latencyBuckets()
+{
+    return { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+}
+
+///
+/// Returns the name under which a metric is exported, e.g. "qxmpp_incoming_client_count" for
+/// "incoming-client.count".
+///
+/// Different names can be exported with the same name, e.g. "a.b" and "a_b". Only the first of
+/// them can be registered.
+///
+QString QXmppMetrics::exportName(QStringView name)
+{
+    QString exported = u"qxmpp_"_s;
+    exported.reserve(exported.size() + name.size());
+    for (const auto c : name) {
+        const auto valid = (c >= u'a' && c <= u'z') || (c >= u'A' && c <= u'Z') || (c >= u'0' && c <= u'9') || c == u'_';
+        exported.append(valid ? c : QChar(u'_'));
+    }
+    return exported;
+}
+
+///
+/// Exports all metrics in the given text format.
+///
+/// Counters get the suffix "_total". The values are read without stopping updates, so the
+/// buckets of a histogram may be slightly inconsistent with its count.
+///
+QByteArray QXmppMetrics::exportText(ExportFormat format) const
+{
+    QByteArray text;
+    auto writeLine = [&](const QByteArray &name, const QByteArray &value) {
+        text += name + ' ' + value + '\n';
+    };
+
+    QReadLocker locker(&d->lock);
+    for (const auto &[name, metric] : d->metrics) {
+        const auto family = exportName(name).toUtf8();
+        std::visit(
+            overloaded {
+                [&](const std::unique_ptr<Counter> &counter) {
+                    // Prometheus uses the name of the sample as the name of the family
+                    const QByteArray typeName = format == OpenMetrics ? family : QByteArray(family + "_total");
+                    text += "# TYPE " + typeName + " counter\n";
+                    writeLine(family + "_total", QByteArray::number(counter->value()));
+                },
+                [&](const std::unique_ptr<Gauge> &gauge) {
+                    text += "# TYPE " + family + " gauge\n";
+                    writeLine(family, formatValue(gauge->value()));
+                },
+                [&](const std::unique_ptr<Histogram> &histogram) {
+                    text += "# TYPE " + family + " histogram\n";
+                    const auto &bounds = histogram->upperBounds();
+                    quint64 cumulative = 0;
+                    for (qsizetype i = 0; i <= bounds.size(); i++) {
+                        cumulative += histogram->bucketCount(i);
+                        const auto bound = i < bounds.size() ? formatValue(bounds[i]) : QByteArrayLiteral("+Inf");
+                        writeLine(family + "_bucket{le=\"" + bound + "\"}", QByteArray::number(cumulative));
+                    }
+                    writeLine(family + "_sum", formatValue(histogram->sum()));
+                    writeLine(family + "_count", QByteArray::number(cumulative));
+                },
+            },
+            metric);
+    }
+    if (format == OpenMetrics) {
+        text += "# EOF\n";
+    }
+    return text;
+}
+
+namespace QXmpp::Private {
+
+std::shared_ptr<StreamMetrics> StreamMetrics::create(std::shared_ptr<QXmppMetrics> registry, const QString &prefix)
+{
+    if (!registry) {
+        return {};
+    }
+
+    auto metrics = std::make_shared<StreamMetrics>();
+    metrics->stanzasReceived = registry->counter(prefix + u".stanzas-received"_s);
+    metrics->stanzasSent = registry->counter(prefix + u".stanzas-sent"_s);
+    metrics->bytesReceived = registry->counter(prefix + u".bytes-received"_s);
+    metrics->bytesSent = registry->counter(prefix + u".bytes-sent"_s);
+    metrics->writes = registry->counter(prefix + u".writes"_s);
+    metrics->flushes = registry->counter(prefix + u".flushes"_s);
+    metrics->parseTime = registry->histogram(prefix + u".parse-seconds"_s);
+    metrics->authTime = registry->histogram(prefix + u".auth-seconds"_s);
+
+    // the streams use the handles without checking them
+    if (!metrics->stanzasReceived || !metrics->stanzasSent || !metrics->bytesReceived ||
+        !metrics->bytesSent || !metrics->writes || !metrics->flushes || !metrics->parseTime ||
+        !metrics->authTime) {
+        qWarning("[QXmpp] Metrics of '%s' streams are disabled, their names are taken by other metrics",
+                 qPrintable(prefix));
+        return {};
+    }
+
+    metrics->registry = std::move(registry);
+    return metrics;
+}
+
+}  // namespace QXmpp::Private
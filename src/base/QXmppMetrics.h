@@ -0,0 +1,121 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef QXMPPMETRICS_H
+#define QXMPPMETRICS_H
+
+#include "QXmppGlobal.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+class QXmppMetricsPrivate;
+
+///
+/// \brief The QXmppMetrics class is a registry of counters, gauges and histograms.
+///
+/// Metrics are identified by their name, e.g. "incoming-client.count". Looking up a metric takes a
+/// lock, but the returned handles stay valid as long as the registry exists and updating them is
+/// lock-free. Code that updates a metric often should look it up once and keep the handle.
+///
+/// The metrics can be exported in the Prometheus or OpenMetrics text format, see
+/// QXmppMetricsExporter.
+///
+/// \sa QXmppLogger::setMetrics()
+///
+/// \ingroup Core
+///
+/// \since QXmpp 1.13
+///
+class QXMPP_EXPORT QXmppMetrics
+{
+public:
+    /// Text format of exported metrics.
+    enum ExportFormat {
+        /// Prometheus text exposition format 0.0.4
+        Prometheus,
+        /// OpenMetrics text format 1.0.0
+        OpenMetrics,
+    };
+
+    ///
+    /// \brief Monotonically increasing counter.
+    ///
+    class QXMPP_EXPORT Counter
+    {
+    public:
+        /// Increases the counter by \a amount.
+        void increment(qint64 amount = 1) { m_value.fetch_add(amount, std::memory_order_relaxed); }
+        /// Returns the current value.
+        qint64 value() const { return m_value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<qint64> m_value = 0;
+    };
+
+    ///
+    /// \brief Value that can go up and down.
+    ///
+    class QXMPP_EXPORT Gauge
+    {
+    public:
+        /// Sets the gauge to \a value.
+        void set(double value) { m_value.store(value, std::memory_order_relaxed); }
+        /// Returns the current value.
+        double value() const { return m_value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<double> m_value = 0.0;
+    };
+
+    ///
+    /// \brief Distribution of observed values in buckets with fixed upper bounds.
+    ///
+    class QXMPP_EXPORT Histogram
+    {
+    public:
+        explicit Histogram(QList<double> upperBounds);
+
+        void observe(double value);
+
+        /// Returns the upper bounds of the buckets (without +Inf).
+        const QList<double> &upperBounds() const { return m_upperBounds; }
+        quint64 bucketCount(qsizetype index) const;
+        /// Returns the number of observed values.
+        quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+        /// Returns the sum of the observed values.
+        double sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+    private:
+        QList<double> m_upperBounds;
+        // non-cumulative, the last bucket is +Inf
+        std::vector<std::atomic<quint64>> m_buckets;
+        std::atomic<quint64> m_count = 0;
+        std::atomic<double> m_sum = 0.0;
+    };
+
+    QXmppMetrics();
+    QXmppMetrics(const QXmppMetrics &) = delete;
+    QXmppMetrics &operator=(const QXmppMetrics &) = delete;
+    ~QXmppMetrics();
+
+    Counter *counter(const QString &name);
+    Gauge *gauge(const QString &name);
+    Histogram *histogram(const QString &name, const QList<double> &upperBounds = latencyBuckets());
+
+    static QList<double> latencyBuckets();
+    static QString exportName(QStringView name);
+
+    QByteArray exportText(ExportFormat format = Prometheus) const;
+
+private:
+    const std::unique_ptr<QXmppMetricsPrivate> d;
+};
+
+#endif  // QXMPPMETRICS_H
@@ -0,0 +1,201 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "QXmppMetricsExporter.h"
+
+#include <QSaveFile>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+// maximum size of the request line and headers of an HTTP request
+constexpr qsizetype MAX_HTTP_REQUEST_SIZE = 8 * 1024;
+// time after which a connection is closed, whether the request was complete or not
+constexpr auto HTTP_CONNECTION_TIMEOUT = std::chrono::seconds(10);
+
+class QXmppMetricsExporterPrivate
+{
+public:
+    std::shared_ptr<QXmppMetrics> metrics;
+    QXmppMetrics::ExportFormat format = QXmppMetrics::Prometheus;
+};
+
+class QXmppMetricsFileExporterPrivate
+{
+public:
+    QString path;
+    QTimer timer;
+};
+
+class QXmppMetricsHttpExporterPrivate
+{
+public:
+    QTcpServer server;
+};
+
+///
+/// Constructs an exporter for the given metrics.
+///
+QXmppMetricsExporter::QXmppMetricsExporter(std::shared_ptr<QXmppMetrics> metrics, QObject *parent)
+    : QObject(parent),
+      d(std::make_unique<QXmppMetricsExporterPrivate>())
+{
+    d->metrics = std::move(metrics);
+}
+
+QXmppMetricsExporter::~QXmppMetricsExporter() = default;
+
+/// Returns the exported metrics.
+std::shared_ptr<QXmppMetrics> QXmppMetricsExporter::metrics() const
+{
+    return d->metrics;
+}
+
+/// Returns the text format of the exported metrics.
+QXmppMetrics::ExportFormat QXmppMetricsExporter::format() const
+{
+    return d->format;
+}
+
+/// Sets the text format of the exported metrics, the default is QXmppMetrics::Prometheus.
+void QXmppMetricsExporter::setFormat(QXmppMetrics::ExportFormat format)
+{
+    d->format = format;
+}
+
+/// Returns the current metrics in the configured format.
+QByteArray QXmppMetricsExporter::exportText() const
+{
+    return d->metrics ? d->metrics->exportText(d->format) : QByteArray();
+}
+
+///
+/// Constructs an exporter that writes the metrics to the file at \a path.
+///
+/// The file is only written by write() until an interval is set.
+///
+QXmppMetricsFileExporter::QXmppMetricsFileExporter(std::shared_ptr<QXmppMetrics> metrics, const QString &path, QObject *parent)
+    : QXmppMetricsExporter(std::move(metrics), parent),
+      d(std::make_unique<QXmppMetricsFileExporterPrivate>())
+{
+    d->path = path;
+    connect(&d->timer, &QTimer::timeout, this, &QXmppMetricsFileExporter::write);
+}
+
+QXmppMetricsFileExporter::~QXmppMetricsFileExporter() = default;
+
+/// Returns the path of the file.
+QString QXmppMetricsFileExporter::path() const
+{
+    return d->path;
+}
+
+/// Returns the interval in which the file is written.
+std::chrono::milliseconds QXmppMetricsFileExporter::interval() const
+{
+    return d->timer.isActive() ? d->timer.intervalAsDuration() : std::chrono::milliseconds(0);
+}
+
+///
+/// Sets the interval in which the file is written, 0 stops writing the file periodically.
+///
+void QXmppMetricsFileExporter::setInterval(std::chrono::milliseconds interval)
+{
+    if (interval.count() > 0) {
+        d->timer.start(interval);
+    } else {
+        d->timer.stop();
+    }
+}
+
+/// Writes the current metrics to the file and returns whether that succeeded.
+bool QXmppMetricsFileExporter::write()
+{
+    QSaveFile file(d->path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    const auto text = exportText();
+    if (file.write(text) != text.size()) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+/// Constructs an HTTP endpoint for the given metrics.
+QXmppMetricsHttpExporter::QXmppMetricsHttpExporter(std::shared_ptr<QXmppMetrics> metrics, QObject *parent)
+    : QXmppMetricsExporter(std::move(metrics), parent),
+      d(std::make_unique<QXmppMetricsHttpExporterPrivate>())
+{
+    connect(&d->server, &QTcpServer::newConnection, this, [this] {
+        while (auto *socket = d->server.nextPendingConnection()) {
+            socket->setParent(this);
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            // clients that never finish their request must not keep the connection open
+            QTimer::singleShot(HTTP_CONNECTION_TIMEOUT, socket, [socket] {
+                socket->abort();
+                socket->deleteLater();
+            });
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket] {
+                // wait for the end of the headers, the request has no body
+                const auto request = socket->peek(MAX_HTTP_REQUEST_SIZE);
+                const auto headersEnd = request.indexOf("\r\n\r\n");
+                if (headersEnd < 0 && request.size() < MAX_HTTP_REQUEST_SIZE) {
+                    return;
+                }
+                disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+
+                const auto requestLine = request.left(request.indexOf("\r\n")).split(' ');
+                QByteArray status;
+                QByteArray contentType = QByteArrayLiteral("text/plain; charset=utf-8");
+                QByteArray body;
+                if (headersEnd < 0 || requestLine.size() != 3) {
+                    status = QByteArrayLiteral("400 Bad Request");
+                } else if (requestLine[0] != "GET") {
+                    status = QByteArrayLiteral("405 Method Not Allowed");
+                } else if (requestLine[1] != "/metrics") {
+                    status = QByteArrayLiteral("404 Not Found");
+                } else {
+                    status = QByteArrayLiteral("200 OK");
+                    contentType = format() == QXmppMetrics::OpenMetrics
+                        ? QByteArrayLiteral("application/openmetrics-text; version=1.0.0; charset=utf-8")
+                        : QByteArrayLiteral("text/plain; version=0.0.4; charset=utf-8");
+                    body = exportText();
+                }
+
+                const QByteArray response = "HTTP/1.0 " + status + "\r\n" +
+                    "Content-Type: " + contentType + "\r\n" +
+                    "Content-Length: " + QByteArray::number(body.size()) + "\r\n" +
+                    "Connection: close\r\n\r\n" +
+                    body;
+                socket->write(response);
+                socket->disconnectFromHost();
+            });
+        }
+    });
+}
+
+QXmppMetricsHttpExporter::~QXmppMetricsHttpExporter() = default;
+
+///
+/// Starts listening for HTTP requests on the given address and port. With port 0 a free port is
+/// chosen, see serverPort().
+///
+bool QXmppMetricsHttpExporter::listen(const QHostAddress &address, quint16 port)
+{
+    return d->server.listen(address, port);
+}
+
+/// Returns the port the endpoint listens on, or 0 if it is not listening.
+quint16 QXmppMetricsHttpExporter::serverPort() const
+{
+    return d->server.serverPort();
+}
+
+/// Stops listening for HTTP requests.
+void QXmppMetricsHttpExporter::close()
+{
+    d->server.close();
+}
@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef QXMPPMETRICSEXPORTER_H
+#define QXMPPMETRICSEXPORTER_H
+
+#include "QXmppMetrics.h"
+
+#include <chrono>
+
+#include <QHostAddress>
+#include <QObject>
+
+class QXmppMetricsExporterPrivate;
+class QXmppMetricsFileExporterPrivate;
+class QXmppMetricsHttpExporterPrivate;
+
+///
+/// \brief The QXmppMetricsExporter class is the base class for writers of exported metrics.
+///
+/// Subclasses write the output of exportText() somewhere, e.g. QXmppMetricsFileExporter to a file
+/// and QXmppMetricsHttpExporter to an HTTP endpoint that can be scraped by Prometheus.
+///
+/// \ingroup Core
+///
+/// \since QXmpp 1.13
+///
+class QXMPP_EXPORT QXmppMetricsExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QXmppMetricsExporter(std::shared_ptr<QXmppMetrics> metrics, QObject *parent = nullptr);
+    ~QXmppMetricsExporter() override;
+
+    std::shared_ptr<QXmppMetrics> metrics() const;
+
+    QXmppMetrics::ExportFormat format() const;
+    void setFormat(QXmppMetrics::ExportFormat format);
+
+protected:
+    QByteArray exportText() const;
+
+private:
+    const std::unique_ptr<QXmppMetricsExporterPrivate> d;
+};
+
+///
+/// \brief The QXmppMetricsFileExporter class writes exported metrics to a file.
+///
+/// The file is replaced atomically, so it can be read by other processes at any time, e.g. by the
+/// textfile collector of the Prometheus node exporter.
+///
+/// \ingroup Core
+///
+/// \since QXmpp 1.13
+///
+class QXMPP_EXPORT QXmppMetricsFileExporter : public QXmppMetricsExporter
+{
+    Q_OBJECT
+
+public:
+    QXmppMetricsFileExporter(std::shared_ptr<QXmppMetrics> metrics, const QString &path, QObject *parent = nullptr);
+    ~QXmppMetricsFileExporter() override;
+
+    QString path() const;
+
+    std::chrono::milliseconds interval() const;
+    void setInterval(std::chrono::milliseconds interval);
+
+    bool write();
+
+private:
+    const std::unique_ptr<QXmppMetricsFileExporterPrivate> d;
+};
+
+///
+/// \brief The QXmppMetricsHttpExporter class serves exported metrics over HTTP.
+///
+/// This is a minimal HTTP/1.0 server that answers GET requests for "/metrics" and is meant to be
+/// scraped by a local Prometheus or agent. It does not support TLS or authentication, so it should
+/// only listen on a local or otherwise protected address. Requests are limited to 8 KiB and
+/// connections are closed after 10 seconds.
+///
+/// \ingroup Core
+///
+/// \since QXmpp 1.13
+///
+class QXMPP_EXPORT QXmppMetricsHttpExporter : public QXmppMetricsExporter
+{
+    Q_OBJECT
+
+public:
+    explicit QXmppMetricsHttpExporter(std::shared_ptr<QXmppMetrics> metrics, QObject *parent = nullptr);
+    ~QXmppMetricsHttpExporter() override;
+
+    bool listen(const QHostAddress &address = QHostAddress::LocalHost, quint16 port = 0);
+    quint16 serverPort() const;
+    void close();
+
+private:
+    const std::unique_ptr<QXmppMetricsHttpExporterPrivate> d;
+};
+
+#endif  // QXMPPMETRICSEXPORTER_H
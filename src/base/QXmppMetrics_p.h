@@ -0,0 +1,86 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QXmpp API.
+//
+// This header file may change from version to version without notice,
+// or even be removed.
+//
+// We mean it.
+//
+
+#ifndef QXMPPMETRICS_P_H
+#define QXMPPMETRICS_P_H
+
+#include "QXmppMetrics.h"
+
+#include <chrono>
+
+#include <QElapsedTimer>
+
+namespace QXmpp::Private {
+
+//
+// Handles of the metrics of one kind of XMPP stream (e.g. "incoming-client").
+//
+// The handles are looked up once and shared by all streams of that kind. They keep the registry
+// alive, so streams may outlive the logger.
+//
+struct QXMPP_EXPORT StreamMetrics {
+    static std::shared_ptr<StreamMetrics> create(std::shared_ptr<QXmppMetrics> registry, const QString &prefix);
+
+    std::shared_ptr<QXmppMetrics> registry;
+    QXmppMetrics::Counter *stanzasReceived = nullptr;
+    QXmppMetrics::Counter *stanzasSent = nullptr;
+    QXmppMetrics::Counter *bytesReceived = nullptr;
+    QXmppMetrics::Counter *bytesSent = nullptr;
+    // sendData() calls and writes to the socket, they differ with write coalescing
+    QXmppMetrics::Counter *writes = nullptr;
+    QXmppMetrics::Counter *flushes = nullptr;
+    // time spent in the XML parser per received chunk of data
+    QXmppMetrics::Histogram *parseTime = nullptr;
+    // time from the start of the authentication until it succeeded
+    QXmppMetrics::Histogram *authTime = nullptr;
+};
+
+inline double toSeconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+// Adds the time elapsed since the timer was started to the histogram, if there is one.
+inline void observeElapsed(QXmppMetrics::Histogram *histogram, const QElapsedTimer &timer)
+{
+    if (histogram && timer.isValid()) {
+        histogram->observe(toSeconds(std::chrono::nanoseconds(timer.nsecsElapsed())));
+    }
+}
+
+// Adds the time until it is destroyed to the histogram, if there is one.
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(QXmppMetrics::Histogram *histogram)
+        : m_histogram(histogram)
+    {
+        if (m_histogram) {
+            m_timer.start();
+        }
+    }
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+    ~ScopedTimer() { observeElapsed(m_histogram, m_timer); }
+
+private:
+    QXmppMetrics::Histogram *m_histogram;
+    QElapsedTimer m_timer;
+};
+
+}  // namespace QXmpp::Private
+
+#endif  // QXMPPMETRICS_P_H
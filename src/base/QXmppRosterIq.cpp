@@ -85,6 +85,10 @@ QString QXmppRosterIq::version() const
 ///
 /// Sets the roster version of IQ.
 ///
+/// A null version is not serialized. An empty version is serialized as empty "ver" attribute, so a
+/// client can request the roster with \xep{0237, Roster Versioning} without having a cached
+/// roster.
+///
 /// \param version as a QString
 ///
 /// \since QXmpp 1.0
@@ -128,8 +132,8 @@ void QXmppRosterIq::toXmlElementFromChild(QXmlStreamWriter *writer) const
 {
     XmlWriter(writer).write(Element {
         PayloadXmlTag,
-        // XEP-0237: Roster Versioning
-        OptionalAttribute { u"ver", d->version },
+        // XEP-0237: Roster Versioning, an empty version requests versioning without a cached roster
+        OptionalAttribute { u"ver", d->version.isNull() ? std::optional<QString>() : d->version },
         // XEP-0405: Mediated Information eXchange (MIX): Participant Server Requirements
         OptionalContent { d->mixAnnotate, Element { { u"annotate", ns_mix_roster } } },
         d->items,
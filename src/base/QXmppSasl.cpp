@@ -1195,6 +1195,8 @@ std::unique_ptr<QXmppSaslServer> QXmppSaslServer::create(const QString &mechanis
         return std::make_unique<QXmppSaslServerDigestMd5>(parent);
     } else if (mechanism == u"ANONYMOUS") {
         return std::make_unique<QXmppSaslServerAnonymous>(parent);
+    } else if (auto scram = SaslScramMechanism::fromString(mechanism)) {
+        return std::make_unique<QXmppSaslServerScram>(*scram, parent);
     } else {
         return {};
     }
@@ -1377,6 +1379,156 @@ QXmppSaslServer::Response QXmppSaslServerPlain::respond(const QByteArray &reques
     }
 }
 
+QXmppSaslServerScram::QXmppSaslServerScram(SaslScramMechanism mechanism, QObject *parent)
+    : QXmppSaslServer(parent), m_mechanism(mechanism), m_step(0)
+{
+}
+
+QString QXmppSaslServerScram::mechanism() const
+{
+    return m_mechanism.toString();
+}
+
+void QXmppSaslServerScram::setCredentials(const QByteArray &salt, int iterations, const QByteArray &storedKey, const QByteArray &serverKey)
+{
+    m_salt = salt;
+    m_iterations = iterations;
+    m_storedKey = storedKey;
+    m_serverKey = serverKey;
+}
+
+// Decodes a saslname: ',' and '=' are escaped as "=2C" and "=3D".
+static std::optional<QByteArray> decodeSaslName(const QByteArray &name)
+{
+    QByteArray decoded;
+    decoded.reserve(name.size());
+    for (qsizetype i = 0; i < name.size(); i++) {
+        if (name[i] != '=') {
+            decoded.append(name[i]);
+        } else if (name.mid(i + 1, 2) == "2C") {
+            decoded.append(',');
+            i += 2;
+        } else if (name.mid(i + 1, 2) == "3D") {
+            decoded.append('=');
+            i += 2;
+        } else {
+            return {};
+        }
+    }
+    return decoded;
+}
+
+// Compares in constant time, so the comparison does not reveal how many bytes match.
+static bool constantTimeEquals(QByteArrayView a, QByteArrayView b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    char difference = 0;
+    for (qsizetype i = 0; i < a.size(); i++) {
+        difference |= a[i] ^ b[i];
+    }
+    return difference == 0;
+}
+
+// Returns a salt for a user that does not exist. It is the same for every login attempt with
+// the username, like the salt of an existing account.
+static QByteArray unknownUserSalt(const QString &username, QCryptographicHash::Algorithm algorithm)
+{
+    static const auto secret = QXmppUtils::generateRandomBytes(32);
+    return QMessageAuthenticationCode::hash(username.toUtf8(), secret, algorithm).left(16);
+}
+
+QXmppSaslServer::Response QXmppSaslServerScram::respond(const QByteArray &request, QByteArray &response)
+{
+    const auto algorithm = m_mechanism.qtAlgorithm();
+
+    if (m_step == 0) {
+        // client-first-message: gs2-header client-first-message-bare
+        // channel binding is not supported, authorization identities are not allowed
+        if (!request.startsWith("n,,") && !request.startsWith("y,,")) {
+            warning(u"QXmppSaslServerScram : Invalid GS2 header"_s);
+            return Failed;
+        }
+        m_gs2Header = request.left(3);
+        m_clientFirstMessageBare = request.mid(3);
+
+        if (!m_clientFirstMessageBare.startsWith("n=")) {
+            warning(u"QXmppSaslServerScram : Invalid input"_s);
+            return Failed;
+        }
+        const auto input = parseGS2(m_clientFirstMessageBare);
+        const auto username = decodeSaslName(input.value('n'));
+        const auto clientNonce = input.value('r');
+        if (!username || username->isEmpty() || clientNonce.isEmpty()) {
+            warning(u"QXmppSaslServerScram : Invalid input"_s);
+            return Failed;
+        }
+        setUsername(QString::fromUtf8(*username));
+        m_nonce = clientNonce + generateNonce();
+
+        m_step++;
+        response = QByteArray();
+        return InputNeeded;
+    } else if (m_step == 1) {
+        // the credentials have been set (if the user exists)
+        if (m_storedKey.isEmpty() || m_serverKey.isEmpty() || m_salt.isEmpty() || m_iterations < 1) {
+            // unknown user: continue with credentials no proof can match, so the server-first-message
+            // does not reveal whether the account exists
+            m_salt = unknownUserSalt(username(), algorithm);
+            m_iterations = 4096;
+            m_storedKey = QXmppUtils::generateRandomBytes(QCryptographicHash::hashLength(algorithm));
+            m_serverKey = QXmppUtils::generateRandomBytes(QCryptographicHash::hashLength(algorithm));
+        }
+
+        m_serverFirstMessage = QByteArrayLiteral("r=") + m_nonce +
+            QByteArrayLiteral(",s=") + m_salt.toBase64() +
+            QByteArrayLiteral(",i=") + QByteArray::number(m_iterations);
+
+        m_step++;
+        response = m_serverFirstMessage;
+        return Challenge;
+    } else if (m_step == 2) {
+        // client-final-message: channel-binding nonce [extensions] proof
+        const auto proofIndex = request.lastIndexOf(",p=");
+        if (proofIndex < 0) {
+            warning(u"QXmppSaslServerScram : Invalid input"_s);
+            return Failed;
+        }
+        const auto clientFinalMessageBare = request.left(proofIndex);
+        const auto input = parseGS2(clientFinalMessageBare);
+        if (input.value('c') != m_gs2Header.toBase64() || input.value('r') != m_nonce) {
+            warning(u"QXmppSaslServerScram : Invalid channel binding or nonce"_s);
+            return Failed;
+        }
+
+        // ClientKey = ClientProof XOR HMAC(StoredKey, AuthMessage), H(ClientKey) must be StoredKey
+        const auto authMessage = m_clientFirstMessageBare + ',' + m_serverFirstMessage + ',' + clientFinalMessageBare;
+        auto clientKey = QByteArray::fromBase64(request.mid(proofIndex + 3));
+        const auto clientSignature = QMessageAuthenticationCode::hash(authMessage, m_storedKey, algorithm);
+        if (clientKey.size() != clientSignature.size()) {
+            return Failed;
+        }
+        std::transform(clientKey.cbegin(), clientKey.cend(), clientSignature.cbegin(),
+                       clientKey.begin(), std::bit_xor<char>());
+        if (!constantTimeEquals(QCryptographicHash::hash(clientKey, algorithm), m_storedKey)) {
+            return Failed;
+        }
+
+        // server-final-message, sent as challenge, so clients can verify the server
+        m_step++;
+        response = QByteArrayLiteral("v=") + QMessageAuthenticationCode::hash(authMessage, m_serverKey, algorithm).toBase64();
+        return Challenge;
+    } else if (m_step == 3) {
+        m_step++;
+        response = QByteArray();
+        return Succeeded;
+    } else {
+        warning(u"QXmppSaslServerScram : Invalid step"_s);
+        return Failed;
+    }
+}
+
 void QXmppSaslDigestMd5::setNonce(const QByteArray &nonce)
 {
     forcedNonce = nonce;
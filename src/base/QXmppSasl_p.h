@@ -644,6 +644,33 @@ private:
     int m_step;
 };
 
+// Server side of SCRAM (RFC 5802). The password is not needed: the credentials (salt, iteration
+// count, StoredKey and ServerKey) are requested with InputNeeded after the client's first message.
+class QXmppSaslServerScram : public QXmppSaslServer
+{
+    Q_OBJECT
+public:
+    QXmppSaslServerScram(QXmpp::Private::SaslScramMechanism mechanism, QObject *parent = nullptr);
+    QString mechanism() const override;
+    QXmpp::Private::SaslScramMechanism scramMechanism() const { return m_mechanism; }
+
+    void setCredentials(const QByteArray &salt, int iterations, const QByteArray &storedKey, const QByteArray &serverKey);
+
+    Response respond(const QByteArray &challenge, QByteArray &response) override;
+
+private:
+    QXmpp::Private::SaslScramMechanism m_mechanism;
+    int m_step;
+    QByteArray m_salt;
+    int m_iterations = 0;
+    QByteArray m_storedKey;
+    QByteArray m_serverKey;
+    QByteArray m_gs2Header;
+    QByteArray m_clientFirstMessageBare;
+    QByteArray m_serverFirstMessage;
+    QByteArray m_nonce;
+};
+
 class QXmppSaslServerPlain : public QXmppSaslServer
 {
     Q_OBJECT
@@ -149,6 +149,10 @@ void SmRequest::toXml(XmlWriter &w) const
 StreamAckManager::StreamAckManager(XmppSocket &socket)
     : socket(socket)
 {
+    m_ackRequestTimer.setSingleShot(true);
+    QObject::connect(&m_ackRequestTimer, &QTimer::timeout, &socket, [this]() {
+        sendAcknowledgementRequest();
+    });
 }
 
 bool StreamAckManager::handleStanza(const QDomElement &stanza)
@@ -172,6 +176,8 @@ bool StreamAckManager::handleStanza(const QDomElement &stanza)
 void StreamAckManager::onSessionClosed()
 {
     m_enabled = false;
+    m_unrequestedStanzas = 0;
+    m_ackRequestTimer.stop();
 }
 
 void StreamAckManager::enableStreamManagement(bool resetSequenceNumber)
@@ -179,43 +185,57 @@ void StreamAckManager::enableStreamManagement(bool resetSequenceNumber)
     m_enabled = true;
 
     if (resetSequenceNumber) {
-        m_lastOutgoingSequenceNumber = 0;
         m_lastIncomingSequenceNumber = 0;
+        // the unacked stanzas are resent with new sequence numbers
+        m_lastOutgoingSequenceNumber = m_unacknowledgedStanzas.size();
+    }
 
-        // resend unacked stanzas
-        if (!m_unacknowledgedStanzas.isEmpty()) {
-            auto oldUnackedStanzas = m_unacknowledgedStanzas;
-            m_unacknowledgedStanzas.clear();
+    // resend unacked stanzas
+    if (!m_unacknowledgedStanzas.empty()) {
+        m_unacknowledgedStanzas.forEach([this](UnacknowledgedStanza &stanza) {
+            socket.sendData(stanza.packet.data());
+        });
 
-            for (auto &packet : oldUnackedStanzas) {
-                m_unacknowledgedStanzas.insert(++m_lastOutgoingSequenceNumber, packet);
-                socket.sendData(packet.data());
-            }
+        sendAcknowledgementRequest();
+    }
 
-            sendAcknowledgementRequest();
-        }
-    } else {
-        // resend unacked stanzas
-        if (!m_unacknowledgedStanzas.isEmpty()) {
-            for (auto &packet : m_unacknowledgedStanzas) {
-                socket.sendData(packet.data());
-            }
+    sendPendingStanzas();
+}
 
-            sendAcknowledgementRequest();
-        }
+void StreamAckManager::setAcknowledgedSequenceNumber(unsigned int sequenceNumber)
+{
+    // sequence numbers wrap around at 2^32
+    const auto firstSequenceNumber = m_lastOutgoingSequenceNumber - unsigned(m_unacknowledgedStanzas.size()) + 1;
+    const auto acknowledged = qint32(sequenceNumber - firstSequenceNumber + 1);
+
+    for (qint32 i = 0; i < acknowledged && !m_unacknowledgedStanzas.empty(); i++) {
+        auto stanza = m_unacknowledgedStanzas.take_front();
+        m_unacknowledgedBytes -= stanza.packet.data().size();
+        stanza.packet.reportFinished(QXmpp::SendSuccess { true });
     }
+
+    if (m_enabled) {
+        sendPendingStanzas();
+    }
+    updateBackpressure();
+    updateMetrics();
 }
 
-void StreamAckManager::setAcknowledgedSequenceNumber(unsigned int sequenceNumber)
+void StreamAckManager::setQueueLimit(qsizetype bytes)
 {
-    for (auto it = m_unacknowledgedStanzas.begin(); it != m_unacknowledgedStanzas.end();) {
-        if (it.key() <= sequenceNumber) {
-            it->reportFinished(QXmpp::SendSuccess { true });
-            it = m_unacknowledgedStanzas.erase(it);
-        } else {
-            break;
-        }
+    m_queueLimit = bytes;
+    if (m_enabled) {
+        sendPendingStanzas();
     }
+    updateBackpressure();
+}
+
+std::chrono::milliseconds StreamAckManager::oldestUnacknowledgedAge() const
+{
+    if (m_unacknowledgedStanzas.empty()) {
+        return {};
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - m_unacknowledgedStanzas.front().sentTime);
 }
 
 QXmppTask<SendResult> StreamAckManager::send(QXmppPacket &&packet)
@@ -231,27 +251,94 @@ bool StreamAckManager::sendPacketCompat(QXmppPacket &&packet)
 // Returns written to socket (bool) and QXmppTask
 std::tuple<bool, QXmppTask<SendResult>> StreamAckManager::internalSend(QXmppPacket &&packet)
 {
-    // the writtenToSocket parameter is just for backwards compat
-    bool writtenToSocket = socket.sendData(packet.data());
-
     // handle stream management
     if (m_enabled && packet.isXmppStanza()) {
-        m_unacknowledgedStanzas.insert(++m_lastOutgoingSequenceNumber, packet);
-        sendAcknowledgementRequest();
-    } else {
-        if (writtenToSocket) {
-            packet.reportFinished(QXmpp::SendSuccess { false });
-        } else {
-            packet.reportFinished(QXmppError {
-                u"Couldn't write data to socket. No stream management enabled."_s,
-                QXmpp::SendError::SocketWriteError,
-            });
+        auto task = packet.task();
+
+        // wait until the server has acknowledged enough stanzas
+        if (!m_pendingStanzas.empty() || isQueueFull()) {
+            m_pendingStanzas.push_back(std::move(packet));
+            updateBackpressure();
+            return { true, std::move(task) };
         }
+
+        // the writtenToSocket parameter is just for backwards compat
+        bool writtenToSocket = writeStanza(std::move(packet));
+        updateBackpressure();
+        return { writtenToSocket, std::move(task) };
+    }
+
+    bool writtenToSocket = socket.sendData(packet.data());
+    if (writtenToSocket) {
+        packet.reportFinished(QXmpp::SendSuccess { false });
+    } else {
+        packet.reportFinished(QXmppError {
+            u"Couldn't write data to socket. No stream management enabled."_s,
+            QXmpp::SendError::SocketWriteError,
+        });
     }
 
     return { writtenToSocket, packet.task() };
 }
 
+// Writes a stanza, adds it to the unacked stanzas and requests an ack if required by the ack
+// request policy.
+bool StreamAckManager::writeStanza(QXmppPacket &&packet)
+{
+    const auto writtenToSocket = socket.sendData(packet.data());
+
+    const auto previousBytes = m_unacknowledgedBytes;
+    m_unacknowledgedBytes += packet.data().size();
+    m_unacknowledgedStanzas.push_back({ std::move(packet), Clock::now() });
+    ++m_lastOutgoingSequenceNumber;
+    m_unrequestedStanzas++;
+
+    const auto &policy = m_ackRequestPolicy;
+    if (m_unrequestedStanzas >= policy.stanzaThreshold ||
+        (previousBytes < policy.byteThreshold && m_unacknowledgedBytes >= policy.byteThreshold) ||
+        policy.delay <= std::chrono::milliseconds::zero() ||
+        isQueueFull()) {
+        sendAcknowledgementRequest();
+    } else if (!m_ackRequestTimer.isActive()) {
+        m_ackRequestTimer.start(policy.delay);
+    }
+    return writtenToSocket;
+}
+
+void StreamAckManager::sendPendingStanzas()
+{
+    while (!m_pendingStanzas.empty() && !isQueueFull()) {
+        writeStanza(m_pendingStanzas.take_front());
+    }
+}
+
+void StreamAckManager::updateBackpressure()
+{
+    // release when the queue has been drained to half of the limit, so the state does not change
+    // with every ack
+    bool backpressure = m_backpressure;
+    if (!m_pendingStanzas.empty() || isQueueFull()) {
+        backpressure = true;
+    } else if (m_queueLimit <= 0 || m_unacknowledgedBytes <= m_queueLimit / 2) {
+        backpressure = false;
+    }
+
+    if (backpressure != m_backpressure) {
+        m_backpressure = backpressure;
+        if (m_backpressureHandler) {
+            m_backpressureHandler(backpressure);
+        }
+    }
+}
+
+void StreamAckManager::updateMetrics()
+{
+    Q_EMIT socket.setGauge(u"stream-management.unacked-count"_s, m_unacknowledgedStanzas.size());
+    Q_EMIT socket.setGauge(u"stream-management.unacked-bytes"_s, m_unacknowledgedBytes);
+    Q_EMIT socket.setGauge(u"stream-management.oldest-unacked-age"_s, oldestUnacknowledgedAge().count());
+    Q_EMIT socket.setGauge(u"stream-management.pending-count"_s, m_pendingStanzas.size());
+}
+
 void StreamAckManager::handleAcknowledgement(SmAck ack)
 {
     if (!m_enabled) {
@@ -276,19 +363,33 @@ void StreamAckManager::sendAcknowledgementRequest()
         return;
     }
 
+    m_unrequestedStanzas = 0;
+    m_ackRequestTimer.stop();
+
     // send packet
     socket.sendData(serializeXml(SmRequest {}));
+    updateMetrics();
 }
 
 void StreamAckManager::resetCache()
 {
-    for (auto &packet : m_unacknowledgedStanzas) {
+    m_unacknowledgedStanzas.forEach([](UnacknowledgedStanza &stanza) {
+        stanza.packet.reportFinished(QXmppError {
+            u"Disconnected"_s,
+            QXmpp::SendError::Disconnected });
+    });
+    m_pendingStanzas.forEach([](QXmppPacket &packet) {
         packet.reportFinished(QXmppError {
             u"Disconnected"_s,
             QXmpp::SendError::Disconnected });
-    }
+    });
 
     m_unacknowledgedStanzas.clear();
+    m_pendingStanzas.clear();
+    m_unacknowledgedBytes = 0;
+    m_unrequestedStanzas = 0;
+    m_ackRequestTimer.stop();
+    updateBackpressure();
 }
 
 }  // namespace QXmpp::Private
@@ -7,15 +7,19 @@
 
 #include "QXmppConstants_p.h"
 #include "QXmppGlobal.h"
+#include "QXmppPacket_p.h"
 #include "QXmppSendResult.h"
 #include "QXmppStanza.h"
 #include "QXmppTask.h"
+#include "RingBuffer.h"
+
+#include <chrono>
+#include <functional>
 
 #include <QDomDocument>
+#include <QTimer>
 #include <QXmlStreamWriter>
 
-class QXmppPacket;
-
 namespace QXmpp::Private {
 class XmlWriter;
 class XmppSocket;
@@ -100,6 +104,21 @@ struct SmRequest {
     void toXml(XmlWriter &w) const;
 };
 
+//
+// Specifies when acks are requested for sent stanzas.
+//
+// An ack is requested when one of the limits is reached, so sending many stanzas at once does
+// not need one <r/> per stanza.
+//
+struct SmAckRequestPolicy {
+    // number of stanzas sent since the last ack request
+    int stanzaThreshold = 10;
+    // maximum time a sent stanza waits for an ack request
+    std::chrono::milliseconds delay = std::chrono::milliseconds(250);
+    // size of all unacknowledged stanzas in bytes
+    qsizetype byteThreshold = 32 * 1024;
+};
+
 //
 // This manager handles sending and receiving of stream management acks.
 // Enabling of stream management and stream resumption is done in the C2sStreamManager.
@@ -126,17 +145,58 @@ public:
 
     void sendAcknowledgementRequest();
 
+    const SmAckRequestPolicy &ackRequestPolicy() const { return m_ackRequestPolicy; }
+    void setAckRequestPolicy(const SmAckRequestPolicy &policy) { m_ackRequestPolicy = policy; }
+
+    // Maximum size of unacknowledged stanzas in bytes (0 means unlimited). When the limit is
+    // reached, further stanzas are held back until the server acknowledges the sent ones.
+    qsizetype queueLimit() const { return m_queueLimit; }
+    void setQueueLimit(qsizetype bytes);
+    bool hasBackpressure() const { return m_backpressure; }
+    void setBackpressureHandler(std::function<void(bool)> handler) { m_backpressureHandler = std::move(handler); }
+
+    // metrics
+    qsizetype unacknowledgedCount() const { return qsizetype(m_unacknowledgedStanzas.size()); }
+    qsizetype unacknowledgedBytes() const { return m_unacknowledgedBytes; }
+    qsizetype pendingCount() const { return qsizetype(m_pendingStanzas.size()); }
+    std::chrono::milliseconds oldestUnacknowledgedAge() const;
+
 private:
+    using Clock = std::chrono::steady_clock;
+
+    struct UnacknowledgedStanza {
+        QXmppPacket packet;
+        Clock::time_point sentTime;
+    };
+
     void handleAcknowledgement(SmAck ack);
+    bool writeStanza(QXmppPacket &&packet);
+    void sendPendingStanzas();
+    bool isQueueFull() const { return m_queueLimit > 0 && m_unacknowledgedBytes >= m_queueLimit; }
+    void updateBackpressure();
+    void updateMetrics();
 
     void sendAcknowledgement();
 
     QXmpp::Private::XmppSocket &socket;
 
     bool m_enabled = false;
-    QMap<unsigned int, QXmppPacket> m_unacknowledgedStanzas;
+    // stanzas with the sequence numbers up to m_lastOutgoingSequenceNumber
+    RingBuffer<UnacknowledgedStanza> m_unacknowledgedStanzas;
+    qsizetype m_unacknowledgedBytes = 0;
     unsigned int m_lastOutgoingSequenceNumber = 0;
     unsigned int m_lastIncomingSequenceNumber = 0;
+
+    SmAckRequestPolicy m_ackRequestPolicy;
+    // stanzas sent since the last ack request
+    int m_unrequestedStanzas = 0;
+    QTimer m_ackRequestTimer;
+
+    // stanzas held back because of the queue limit
+    RingBuffer<QXmppPacket> m_pendingStanzas;
+    qsizetype m_queueLimit = 0;
+    bool m_backpressure = false;
+    std::function<void(bool)> m_backpressureHandler;
 };
 
 }  // namespace QXmpp::Private
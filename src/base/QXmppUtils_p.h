@@ -245,8 +245,8 @@ auto parseSingleAttributeElements(const QDomElement &parent, QStringView tagName
     });
 }
 
-QByteArray serializeXmlWriter(std::function<void(XmlWriter &)>);
-QByteArray serializeQXmlStream(std::function<void(QXmlStreamWriter *)>);
+QXMPP_EXPORT QByteArray serializeXmlWriter(std::function<void(XmlWriter &)>);
+QXMPP_EXPORT QByteArray serializeQXmlStream(std::function<void(QXmlStreamWriter *)>);
 
 template<typename T>
 concept XmlWriterSerializeable =
@@ -0,0 +1,100 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace QXmpp::Private {
+
+//
+// FIFO queue in one contiguous block of memory.
+//
+// Elements can be accessed by their position relative to the front, so a queue of elements with
+// consecutive sequence numbers can be indexed by sequence number without any lookup structure.
+// The capacity is always a power of two and grows when the queue is full; it is never shrunk
+// (except by clear()).
+//
+template<typename T>
+class RingBuffer
+{
+public:
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    std::size_t capacity() const { return m_slots.size(); }
+
+    T &operator[](std::size_t index) { return *m_slots[(m_head + index) & (capacity() - 1)]; }
+    const T &operator[](std::size_t index) const { return *m_slots[(m_head + index) & (capacity() - 1)]; }
+    T &front() { return (*this)[0]; }
+    const T &front() const { return (*this)[0]; }
+    T &back() { return (*this)[m_size - 1]; }
+    const T &back() const { return (*this)[m_size - 1]; }
+
+    void push_back(T &&value)
+    {
+        if (m_size == capacity()) {
+            grow();
+        }
+        m_slots[(m_head + m_size) & (capacity() - 1)].emplace(std::move(value));
+        m_size++;
+    }
+
+    T take_front()
+    {
+        auto &slot = m_slots[m_head];
+        T value = std::move(*slot);
+        slot.reset();
+        m_head = (m_head + 1) & (capacity() - 1);
+        m_size--;
+        return value;
+    }
+
+    void pop_front()
+    {
+        m_slots[m_head].reset();
+        m_head = (m_head + 1) & (capacity() - 1);
+        m_size--;
+    }
+
+    void clear()
+    {
+        m_slots = {};
+        m_head = 0;
+        m_size = 0;
+    }
+
+    template<typename Function>
+    void forEach(Function function)
+    {
+        for (std::size_t i = 0; i < m_size; i++) {
+            function((*this)[i]);
+        }
+    }
+
+private:
+    void grow()
+    {
+        std::vector<std::optional<T>> slots(std::max<std::size_t>(2 * capacity(), InitialCapacity));
+        for (std::size_t i = 0; i < m_size; i++) {
+            slots[i].emplace(std::move(*m_slots[(m_head + i) & (capacity() - 1)]));
+        }
+        m_slots = std::move(slots);
+        m_head = 0;
+    }
+
+    static constexpr std::size_t InitialCapacity = 16;
+
+    std::vector<std::optional<T>> m_slots;
+    std::size_t m_head = 0;
+    std::size_t m_size = 0;
+};
+
+}  // namespace QXmpp::Private
+
+#endif  // RINGBUFFER_H
@@ -7,6 +7,7 @@
 #include "Stream.h"
 
 #include "QXmppConstants_p.h"
+#include "QXmppMetrics_p.h"
 #include "QXmppUtils.h"
 #include "QXmppUtils_p.h"
 #include "QXmppVisitHelper_p.h"
@@ -20,6 +21,8 @@
 #include <QRegularExpression>
 #include <QSslSocket>
 
+#include <algorithm>
+
 using namespace QXmpp;
 using namespace QXmpp::Private;
 
@@ -204,12 +207,18 @@ DomReader::Result DomReader::process(QXmlStreamReader &r)
             auto child = r.prefix().isNull()
                 ? doc.createElement(r.name().toString())
                 : doc.createElementNS(r.namespaceUri().toString(), r.qualifiedName().toString());
+            if (!r.prefix().isEmpty()) {
+                relocatable = false;
+            }
 
             // xmlns attribute
             const auto nsDeclarations = r.namespaceDeclarations();
             for (const auto &ns : nsDeclarations) {
                 if (ns.prefix().isEmpty()) {
                     child.setAttribute(u"xmlns"_s, ns.namespaceUri().toString());
+                    if (depth == 0) {
+                        relocatable = false;
+                    }
                 } else {
                     // namespace declarations are not supported in XMPP
                     return Error { UnsupportedXmlFeature, u"XML namespace declarations are not allowed in XMPP."_s };
@@ -220,6 +229,9 @@ DomReader::Result DomReader::process(QXmlStreamReader &r)
             const auto attributes = r.attributes();
             for (const auto &a : attributes) {
                 child.setAttribute(a.name().toString(), a.value().toString());
+                if (!a.prefix().isEmpty() && a.prefix() != u"xml") {
+                    relocatable = false;
+                }
             }
 
             if (currentElement.isNull()) {
@@ -297,6 +309,9 @@ void XmppSocket::setSocket(QSslSocket *socket)
         m_socket->deleteLater();
     }
 
+    // buffered data was meant for the old connection
+    m_writeBuffer.clear();
+
     m_socket = socket;
     if (!m_socket) {
         return;
@@ -327,7 +342,7 @@ void XmppSocket::setSocket(QSslSocket *socket)
     });
     connect(socket, QOverload<const QList<QSslError> &>::of(&QSslSocket::sslErrors), this, &XmppSocket::sslErrorsOccurred);
     connect(socket, &QSslSocket::readyRead, this, [this]() {
-        processData(QString::fromUtf8(m_socket->readAll()));
+        processRawData(m_socket->readAll());
     });
     connect(socket, &QSslSocket::stateChanged, this, &XmppSocket::internalSocketStateChanged);
 }
@@ -360,7 +375,7 @@ void XmppSocket::disconnectFromHost()
     if (m_socket) {
         if (m_socket->state() == QAbstractSocket::ConnectedState) {
             sendData(QByteArrayLiteral("</stream:stream>"));
-            m_socket->flush();
+            flush();
         }
         // FIXME: according to RFC 6120 section 4.4, we should wait for
         // the incoming stream to end before closing the socket
@@ -369,13 +384,103 @@ void XmppSocket::disconnectFromHost()
     m_acceptInput = false;
 }
 
+// Returns whether the data is a serialized stanza, which is counted by stream management.
+bool isStanzaData(QByteArrayView data)
+{
+    while (!data.isEmpty() && (data.front() == ' ' || data.front() == '\n' || data.front() == '\r' || data.front() == '\t')) {
+        data = data.sliced(1);
+    }
+    auto startsWithTag = [&](QByteArrayView tag) {
+        if (data.size() <= tag.size() || !data.startsWith(tag)) {
+            return false;
+        }
+        const auto next = data[tag.size()];
+        return next == '>' || next == '/' || next == ' ' || next == '\n' || next == '\r' || next == '\t';
+    };
+    return startsWithTag("<message") || startsWithTag("<presence") || startsWithTag("<iq");
+}
+
 bool XmppSocket::sendData(const QByteArray &data)
 {
-    logSent(QString::fromUtf8(data));
+    if (isLoggingEnabled(QXmppLogger::SentMessage)) {
+        logSent(QString::fromUtf8(data));
+    }
     if (!m_socket || m_socket->state() != QAbstractSocket::ConnectedState) {
         return false;
     }
-    return m_socket->write(data) == data.size();
+    if (m_metrics) {
+        m_metrics->bytesSent->increment(data.size());
+        if (isStanzaData(data)) {
+            m_metrics->stanzasSent->increment();
+        }
+    }
+
+    m_writeStatistics.writes++;
+    if (m_metrics) {
+        m_metrics->writes->increment();
+    }
+    if (!m_writeCoalescing) {
+        recordFlush(data.size());
+        return m_socket->write(data) == data.size();
+    }
+
+    m_writeBuffer.append(data);
+    if (m_writeBuffer.size() >= m_flushThreshold) {
+        return writeBufferedData();
+    }
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, [this]() { writeBufferedData(); }, Qt::QueuedConnection);
+    }
+    return true;
+}
+
+// Writes all buffered data to the internal socket and flushes it. This needs to be called before
+// the internal socket is used directly, e.g. for starting TLS.
+bool XmppSocket::flush()
+{
+    const auto written = writeBufferedData();
+    if (m_socket) {
+        m_socket->flush();
+    }
+    return written;
+}
+
+void XmppSocket::setWriteCoalescingEnabled(bool enabled)
+{
+    if (m_writeCoalescing && !enabled) {
+        writeBufferedData();
+    }
+    m_writeCoalescing = enabled;
+}
+
+bool XmppSocket::writeBufferedData()
+{
+    m_flushScheduled = false;
+    if (m_writeBuffer.isEmpty()) {
+        return true;
+    }
+    if (!isConnected()) {
+        m_writeBuffer.clear();
+        return false;
+    }
+
+    const auto size = m_writeBuffer.size();
+    const auto written = m_socket->write(m_writeBuffer);
+    // keeps the capacity for the next iteration
+    m_writeBuffer.resize(0);
+
+    recordFlush(size);
+    return written == size;
+}
+
+void XmppSocket::recordFlush(qsizetype size)
+{
+    m_writeStatistics.flushes++;
+    m_writeStatistics.bytes += size;
+    if (m_metrics) {
+        m_metrics->flushes->increment();
+    }
 }
 
 void XmppSocket::resetStream()
@@ -384,6 +489,20 @@ void XmppSocket::resetStream()
     m_domReader.reset();
     m_streamReceived = false;
     m_acceptInput = true;
+
+    m_receivedData.clear();
+    m_receivedDataOffset = 0;
+    m_stanzaStartOffset = 0;
+}
+
+void XmppSocket::setStanzaDataCaptureEnabled(bool enabled)
+{
+    m_captureStanzaData = enabled;
+    if (!enabled) {
+        m_receivedData.clear();
+    }
+    // capturing can only start at the beginning of a stream
+    Q_ASSERT(!enabled || m_reader.characterOffset() == 0);
 }
 
 void XmppSocket::throwError(const QString &text, StreamError condition)
@@ -414,7 +533,54 @@ void XmppSocket::processData(const QString &data)
     // log data received and process
     logReceived(data);
     m_reader.addData(data);
+    if (m_captureStanzaData) {
+        m_receivedData.append(data.toUtf8());
+    }
+
+    processBufferedData();
+}
+
+// Processes UTF-8 data as received from the socket. The reader takes over the (implicitly shared)
+// buffer and decodes it incrementally: no UTF-16 copy of the input is created and multi-byte
+// characters split across two reads are handled correctly.
+void XmppSocket::processRawData(const QByteArray &data)
+{
+    // stop parsing after an error has occurred
+    if (!m_acceptInput) {
+        return;
+    }
+
+    // Check for whitespace pings
+    if (data.isEmpty()) {
+        logReceived({});
+        Q_EMIT stanzaReceived(QDomElement());
+        return;
+    }
+
+    if (isLoggingEnabled(QXmppLogger::ReceivedMessage)) {
+        logReceived(QString::fromUtf8(data));
+    }
+    m_reader.addData(data);
+    if (m_captureStanzaData) {
+        m_receivedData.append(data);
+    }
+
+    // the handlers of the stanzas may replace the metrics
+    if (const auto metrics = m_metrics) {
+        metrics->bytesReceived->increment(data.size());
+
+        // the time spent in the handlers of the stanzas is not counted as parsing time
+        m_parseTimer.start();
+        m_handlerTime = 0;
+        processBufferedData();
+        metrics->parseTime->observe(toSeconds(std::chrono::nanoseconds(m_parseTimer.nsecsElapsed() - m_handlerTime)));
+        return;
+    }
+    processBufferedData();
+}
 
+void XmppSocket::processBufferedData()
+{
     // 'm_reader' parses the XML stream and 'm_domReader' creates DOM elements with the parsed XML
     // from it. 'm_domReader' lives as long as one stanza element is parsed.
 
@@ -422,8 +588,22 @@ void XmppSocket::processData(const QString &data)
         return std::visit(
             overloaded {
                 [this](const QDomElement &element) {
+                    if (m_captureStanzaData) {
+                        captureStanzaData(element, m_domReader->isRelocatable());
+                    }
                     m_domReader.reset();
-                    Q_EMIT stanzaReceived(element);
+                    if (m_metrics) {
+                        const auto tagName = element.tagName();
+                        if (tagName == u"message" || tagName == u"presence" || tagName == u"iq") {
+                            m_metrics->stanzasReceived->increment();
+                        }
+                        const auto handlerStart = m_parseTimer.nsecsElapsed();
+                        Q_EMIT stanzaReceived(element);
+                        m_handlerTime += m_parseTimer.nsecsElapsed() - handlerStart;
+                    } else {
+                        Q_EMIT stanzaReceived(element);
+                    }
+                    m_stanzaData.clear();
                     return true;
                 },
                 [](DomReader::Unfinished) {
@@ -459,6 +639,7 @@ void XmppSocket::processData(const QString &data)
 
     // reading new elements at top-level
     do {
+        const auto tokenOffset = m_reader.characterOffset();
         switch (m_reader.readNext()) {
         case QXmlStreamReader::Invalid:
             // error received
@@ -468,6 +649,12 @@ void XmppSocket::processData(const QString &data)
             break;
         case QXmlStreamReader::StartDocument:
             // pre-stream open
+            // XMPP only allows UTF-8 (RFC 6120, section 11.6)
+            if (const auto encoding = m_reader.documentEncoding();
+                !encoding.isEmpty() && encoding.compare(u"UTF-8", Qt::CaseInsensitive) != 0) {
+                throwError(u"Only UTF-8 is supported as stream encoding."_s,
+                           StreamError::UnsupportedEncoding);
+            }
             break;
         case QXmlStreamReader::EndDocument:
             // post-stream close
@@ -491,6 +678,7 @@ void XmppSocket::processData(const QString &data)
                     StreamError::BadFormat);
             } else {
                 // parse top-level stream element
+                m_stanzaStartOffset = tokenOffset;
                 m_domReader = DomReader();
                 if (!readDomElement()) {
                     return;
@@ -525,4 +713,62 @@ void XmppSocket::processData(const QString &data)
     } while (!m_reader.hasError() && m_acceptInput);
 }
 
+// Returns the number of bytes of UTF-8 data that make up the given number of UTF-16 code units.
+static qsizetype utf8Size(QByteArrayView data, qint64 utf16Size)
+{
+    qsizetype i = 0;
+    while (utf16Size > 0 && i < data.size()) {
+        const auto lead = uchar(data[i]);
+        if (lead < 0x80) {
+            i += 1;
+        } else if (lead < 0xe0) {
+            i += 2;
+        } else if (lead < 0xf0) {
+            i += 3;
+        } else {
+            // outside of the BMP: surrogate pair
+            i += 4;
+            utf16Size--;
+        }
+        utf16Size--;
+    }
+    return std::min(i, data.size());
+}
+
+// Cuts the XML of the stanza that has just been read out of the received data. The reader's
+// character offsets are used to find it, the result is only used if it is verifiably the stanza.
+void XmppSocket::captureStanzaData(const QDomElement &element, bool relocatable)
+{
+    const auto endOffset = m_reader.characterOffset();
+    const auto start = utf8Size(m_receivedData, m_stanzaStartOffset - m_receivedDataOffset);
+    const auto size = utf8Size(QByteArrayView(m_receivedData).sliced(start), endOffset - m_stanzaStartOffset);
+
+    auto isSpace = [](char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    };
+
+    auto data = QByteArrayView(m_receivedData).sliced(start, size);
+    // skip whitespace before the element
+    while (!data.isEmpty() && isSpace(data.front())) {
+        data = data.sliced(1);
+    }
+
+    const auto tagName = element.tagName().toUtf8();
+    auto isTagStart = [&]() {
+        if (!data.startsWith('<') || !data.sliced(1).startsWith(tagName) || data.size() < tagName.size() + 2) {
+            return false;
+        }
+        const auto next = data[tagName.size() + 1];
+        return next == '>' || next == '/' || isSpace(next);
+    };
+    if (relocatable && isTagStart() && data.endsWith('>')) {
+        m_stanzaData = data.toByteArray();
+    } else {
+        m_stanzaData.clear();
+    }
+
+    m_receivedData.remove(0, start + size);
+    m_receivedDataOffset = endOffset;
+}
+
 }  // namespace QXmpp::Private
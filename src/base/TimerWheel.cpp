@@ -0,0 +1,140 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+namespace QXmpp::Private {
+
+void TimerWheelEntry::cancel()
+{
+    if (m_wheel) {
+        m_wheel->remove(*this);
+    }
+}
+
+// Makes this the sentinel of an empty circular list.
+void TimerWheelEntry::initSentinel()
+{
+    m_previous = this;
+    m_next = this;
+}
+
+void TimerWheelEntry::linkBefore(TimerWheelEntry &next)
+{
+    m_previous = next.m_previous;
+    m_next = &next;
+    next.m_previous->m_next = this;
+    next.m_previous = this;
+}
+
+void TimerWheelEntry::unlink()
+{
+    m_previous->m_next = m_next;
+    m_next->m_previous = m_previous;
+    m_previous = nullptr;
+    m_next = nullptr;
+}
+
+TimerWheel::TimerWheel(std::chrono::milliseconds resolution, std::size_t slotCount, Handler handler)
+    : m_resolution(std::max(resolution, std::chrono::milliseconds(1))),
+      m_handler(std::move(handler)),
+      m_slots(std::make_unique<TimerWheelEntry[]>(slotCount)),
+      m_slotCount(slotCount)
+{
+    Q_ASSERT(slotCount > 0);
+    for (std::size_t i = 0; i < m_slotCount; i++) {
+        m_slots[i].initSentinel();
+    }
+
+    m_clock.start();
+    m_timer.setInterval(m_resolution);
+    QObject::connect(&m_timer, &QTimer::timeout, &m_timer, [this]() {
+        processExpired();
+    });
+}
+
+TimerWheel::~TimerWheel()
+{
+    // detach remaining entries, they may outlive the wheel
+    for (std::size_t i = 0; i < m_slotCount; i++) {
+        auto &sentinel = m_slots[i];
+        while (sentinel.m_next != &sentinel) {
+            remove(*sentinel.m_next);
+        }
+    }
+}
+
+void TimerWheel::schedule(TimerWheelEntry &entry, std::chrono::milliseconds timeout)
+{
+    if (entry.m_wheel) {
+        entry.m_wheel->remove(entry);
+    }
+
+    if (m_size == 0) {
+        // nothing has been processed while the timer was stopped
+        m_processedTick = currentTick();
+        m_timer.start();
+    }
+
+    // round up, so the entry never expires early
+    const auto resolution = m_resolution.count();
+    const auto expiry = m_clock.elapsed() + std::max<qint64>(timeout.count(), 0);
+    entry.m_expiryTick = std::max((expiry + resolution - 1) / resolution, m_processedTick + 1);
+
+    entry.linkBefore(m_slots[entry.m_expiryTick % m_slotCount]);
+    entry.m_wheel = this;
+    m_size++;
+}
+
+// Reports all expired entries to the handler.
+void TimerWheel::processExpired()
+{
+    const auto tick = currentTick();
+    if (tick <= m_processedTick) {
+        return;
+    }
+
+    // collect expired entries first, the handler may schedule or cancel other entries
+    TimerWheelEntry expired;
+    expired.initSentinel();
+
+    // after a long pause (e.g. system suspend) every slot only needs to be checked once
+    const auto ticks = std::min<qint64>(tick - m_processedTick, qint64(m_slotCount));
+    for (qint64 i = 1; i <= ticks; i++) {
+        auto &sentinel = m_slots[(m_processedTick + i) % m_slotCount];
+        for (auto *entry = sentinel.m_next; entry != &sentinel;) {
+            auto *next = entry->m_next;
+            if (entry->m_expiryTick <= tick) {
+                entry->unlink();
+                entry->linkBefore(expired);
+            }
+            entry = next;
+        }
+    }
+    m_processedTick = tick;
+
+    while (expired.m_next != &expired) {
+        auto &entry = *expired.m_next;
+        remove(entry);
+        m_handler(entry);
+    }
+}
+
+qint64 TimerWheel::currentTick() const
+{
+    return m_clock.elapsed() / m_resolution.count();
+}
+
+void TimerWheel::remove(TimerWheelEntry &entry)
+{
+    entry.unlink();
+    entry.m_wheel = nullptr;
+    if (--m_size == 0) {
+        m_timer.stop();
+    }
+}
+
+}  // namespace QXmpp::Private
@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "QXmppGlobal.h"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+namespace QXmpp::Private {
+
+class TimerWheel;
+
+//
+// Timer entry that is embedded into the object that is timed out.
+//
+// Scheduling does not allocate. The entry is removed from the wheel when it is destroyed, so the
+// owning object can simply be deleted when it is not needed anymore.
+//
+class QXMPP_EXPORT TimerWheelEntry
+{
+public:
+    TimerWheelEntry() = default;
+    TimerWheelEntry(const TimerWheelEntry &) = delete;
+    TimerWheelEntry &operator=(const TimerWheelEntry &) = delete;
+    ~TimerWheelEntry() { cancel(); }
+
+    bool isScheduled() const { return m_wheel != nullptr; }
+    void cancel();
+
+private:
+    friend class TimerWheel;
+
+    void initSentinel();
+    void linkBefore(TimerWheelEntry &next);
+    void unlink();
+
+    TimerWheelEntry *m_previous = nullptr;
+    TimerWheelEntry *m_next = nullptr;
+    TimerWheel *m_wheel = nullptr;
+    qint64 m_expiryTick = 0;
+};
+
+//
+// Hashed timer wheel for large numbers of timeouts with a coarse resolution.
+//
+// Entries are put into one of a fixed number of slots (expiry tick modulo slot count), so
+// scheduling and cancelling are O(1). One QTimer ticks with the configured resolution while
+// entries are scheduled. Timeouts are never reported early, but may be late by up to one tick.
+//
+class QXMPP_EXPORT TimerWheel
+{
+public:
+    using Handler = std::function<void(TimerWheelEntry &)>;
+
+    TimerWheel(std::chrono::milliseconds resolution, std::size_t slotCount, Handler handler);
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+    ~TimerWheel();
+
+    std::chrono::milliseconds resolution() const { return m_resolution; }
+    std::size_t size() const { return m_size; }
+    // Time of the last processed tick in milliseconds. This only needs a memory read, but only
+    // advances while entries are scheduled.
+    qint64 coarseTime() const { return m_processedTick * m_resolution.count(); }
+
+    void schedule(TimerWheelEntry &entry, std::chrono::milliseconds timeout);
+    void processExpired();
+
+private:
+    friend class TimerWheelEntry;
+
+    qint64 currentTick() const;
+    void remove(TimerWheelEntry &entry);
+
+    std::chrono::milliseconds m_resolution;
+    Handler m_handler;
+    // sentinel entries of the circular lists
+    std::unique_ptr<TimerWheelEntry[]> m_slots;
+    std::size_t m_slotCount;
+    std::size_t m_size = 0;
+    qint64 m_processedTick = 0;
+    QElapsedTimer m_clock;
+    QTimer m_timer;
+};
+
+}  // namespace QXmpp::Private
+
+#endif  // TIMERWHEEL_H
@@ -9,19 +9,26 @@
 
 #include "StreamError.h"
 
+#include <memory>
+
 #include <QAbstractSocket>
 #include <QDomDocument>
+#include <QElapsedTimer>
 #include <QSslError>
 #include <QXmlStreamReader>
 
 class QSslSocket;
 class TestStream;
+class tst_QXmppBenchmark;
 class tst_QXmppStream;
 
 namespace QXmpp::Private {
 
+struct StreamMetrics;
 struct StreamOpen;
 
+QXMPP_EXPORT bool isStanzaData(QByteArrayView data);
+
 struct ServerAddress {
     enum ConnectionType {
         Tcp,
@@ -58,10 +65,15 @@ public:
 
     Result process(QXmlStreamReader &);
 
+    // Whether the XML of the element can be copied into another stream as is: it must not use
+    // namespace prefixes of the stream and must not declare its own default namespace.
+    bool isRelocatable() const { return relocatable; }
+
 private:
     QDomDocument doc;
     QDomElement currentElement;
     uint depth = 0;
+    bool relocatable = true;
 };
 
 class QXMPP_EXPORT XmppSocket : public QXmppLoggable, public SendDataInterface
@@ -79,9 +91,38 @@ public:
     void connectToHost(const ServerAddress &);
     void disconnectFromHost();
     bool sendData(const QByteArray &) override;
+    bool flush();
     void resetStream();
     bool isStreamReceived() const { return m_streamReceived; }
 
+    // Write coalescing: data sent in one event loop iteration is written to the socket at once,
+    // so e.g. a stanza and a following <r/> end up in one TLS record.
+    struct WriteStatistics {
+        // number of sendData() calls
+        quint64 writes = 0;
+        // number of writes to the internal socket
+        quint64 flushes = 0;
+        quint64 bytes = 0;
+    };
+
+    bool isWriteCoalescingEnabled() const { return m_writeCoalescing; }
+    void setWriteCoalescingEnabled(bool enabled);
+    qsizetype flushThreshold() const { return m_flushThreshold; }
+    void setFlushThreshold(qsizetype bytes) { m_flushThreshold = bytes; }
+    const WriteStatistics &writeStatistics() const { return m_writeStatistics; }
+
+    // Stanza data capture: the received XML of each stanza is kept, so it can be forwarded without
+    // serializing the DOM again. The data is only available while stanzaReceived() is emitted and
+    // is empty if the XML of the stanza can not be used in another stream.
+    bool isStanzaDataCaptureEnabled() const { return m_captureStanzaData; }
+    void setStanzaDataCaptureEnabled(bool enabled);
+    const QByteArray &receivedStanzaData() const { return m_stanzaData; }
+
+    // Metrics: stanzas and bytes sent and received, the writes and flushes of the write coalescing
+    // and the parsing time are recorded if set.
+    const StreamMetrics *metrics() const { return m_metrics.get(); }
+    void setMetrics(std::shared_ptr<StreamMetrics> metrics) { m_metrics = std::move(metrics); }
+
     Q_SIGNAL void started();
     Q_SIGNAL void disconnected();
     Q_SIGNAL void stanzaReceived(const QDomElement &);
@@ -96,7 +137,13 @@ private:
     void setSocket(QSslSocket *socket);
     void throwError(const QString &text, StreamError condition);
     void processData(const QString &data);
+    void processRawData(const QByteArray &data);
+    void processBufferedData();
+    void captureStanzaData(const QDomElement &element, bool relocatable);
+    bool writeBufferedData();
+    void recordFlush(qsizetype size);
 
+    friend class ::tst_QXmppBenchmark;
     friend class ::tst_QXmppStream;
 
     QXmlStreamReader m_reader;
@@ -105,6 +152,25 @@ private:
     bool m_directTls = false;
     bool m_acceptInput = true;
 
+    bool m_writeCoalescing = false;
+    bool m_flushScheduled = false;
+    qsizetype m_flushThreshold = 16 * 1024;
+    QByteArray m_writeBuffer;
+    WriteStatistics m_writeStatistics;
+
+    bool m_captureStanzaData = false;
+    // received data that has not been consumed by a stanza yet
+    QByteArray m_receivedData;
+    // character offset of the reader at the beginning of m_receivedData
+    qint64 m_receivedDataOffset = 0;
+    qint64 m_stanzaStartOffset = 0;
+    QByteArray m_stanzaData;
+
+    std::shared_ptr<StreamMetrics> m_metrics;
+    QElapsedTimer m_parseTimer;
+    // time spent in the handlers of stanzas during the current processRawData() call
+    qint64 m_handlerTime = 0;
+
     QSslSocket *m_socket = nullptr;
 };
 
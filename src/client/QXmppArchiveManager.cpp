@@ -10,6 +10,8 @@
 #include "QXmppTask.h"
 #include "QXmppUtils.h"
 
+#include "StringLiterals.h"
+
 #include <QDomElement>
 
 using namespace QXmpp::Private;
@@ -21,6 +23,13 @@ QStringList QXmppArchiveManager::discoveryFeatures() const
     return { ns_archive.toString() };
 }
 
+QList<QXmppClientExtension::StanzaFilter> QXmppArchiveManager::stanzaFilters() const
+{
+    return {
+        { u"iq"_s, {}, ns_archive.toString() },
+    };
+}
+
 bool QXmppArchiveManager::handleStanza(const QDomElement &element)
 {
     auto tag = iqPayloadXmlTag(element);
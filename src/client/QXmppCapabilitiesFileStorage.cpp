@@ -0,0 +1,163 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "QXmppCapabilitiesFileStorage.h"
+
+#include "QXmppUtils_p.h"
+
+#include "Async.h"
+#include "StringLiterals.h"
+#include "XmlWriter.h"
+
+#include <map>
+
+#include <QDomDocument>
+#include <QFile>
+#include <QSaveFile>
+
+using namespace QXmpp::Private;
+
+///
+/// \class QXmppCapabilitiesFileStorage
+///
+/// \brief The QXmppCapabilitiesFileStorage class persists \xep{0115, Entity Capabilities} in a
+/// file.
+///
+/// The file is read on the first access and rewritten atomically when new capabilities are
+/// stored. It contains the service discovery information by hash algorithm and verification
+/// string:
+///
+/// \code{.xml}
+/// <capabilities>
+///     <entry hash="sha-1" ver="QgayPKawpkPSDYmwT/WM94uAlu0=">
+///         <query xmlns="http://jabber.org/protocol/disco#info">...</query>
+///     </entry>
+/// </capabilities>
+/// \endcode
+///
+/// \since QXmpp 1.13
+///
+
+class QXmppCapabilitiesFileStoragePrivate
+{
+public:
+    void readFile();
+    void writeFile() const;
+
+    QString path;
+    bool fileRead = false;
+    // (hash algorithm, verification string) mapped to the info, sorted for a stable file
+    std::map<std::pair<QString, QByteArray>, QXmppDiscoInfo> entries;
+};
+
+void QXmppCapabilitiesFileStoragePrivate::readFile()
+{
+    if (fileRead) {
+        return;
+    }
+    fileRead = true;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDomDocument document;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    if (!document.setContent(&file, QDomDocument::ParseOption::UseNamespaceProcessing)) {
+#else
+    if (!document.setContent(&file, true)) {
+#endif
+        qWarning("[QXmpp] QXmppCapabilitiesFileStorage: Could not parse capabilities file");
+        return;
+    }
+
+    const auto root = document.documentElement();
+    if (root.tagName() != u"capabilities") {
+        qWarning("[QXmpp] QXmppCapabilitiesFileStorage: Invalid capabilities file");
+        return;
+    }
+
+    for (const auto &entry : iterChildElements(root, u"entry")) {
+        auto hash = entry.attribute(u"hash"_s);
+        auto ver = QByteArray::fromBase64(entry.attribute(u"ver"_s).toLatin1());
+        if (hash.isEmpty() || ver.isEmpty()) {
+            continue;
+        }
+        if (auto info = parseOptionalChildElement<QXmppDiscoInfo>(entry)) {
+            entries.insert_or_assign(std::pair { std::move(hash), std::move(ver) }, std::move(*info));
+        }
+    }
+}
+
+void QXmppCapabilitiesFileStoragePrivate::writeFile() const
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("[QXmpp] QXmppCapabilitiesFileStorage: Could not open capabilities file for writing");
+        return;
+    }
+
+    QXmlStreamWriter writer(&file);
+    XmlWriter w(&writer);
+    writer.writeStartDocument();
+    w.write(Element {
+        u"capabilities",
+        [&] {
+            for (const auto &[key, info] : entries) {
+                w.write(Element {
+                    u"entry",
+                    Attribute { u"hash", key.first },
+                    Attribute { u"ver", Base64 { key.second } },
+                    info,
+                });
+            }
+        },
+    });
+    writer.writeEndDocument();
+
+    if (writer.hasError() || !file.commit()) {
+        qWarning("[QXmpp] QXmppCapabilitiesFileStorage: Could not write capabilities file");
+    }
+}
+
+///
+/// Constructs a capabilities storage that uses the file at \a path.
+///
+QXmppCapabilitiesFileStorage::QXmppCapabilitiesFileStorage(const QString &path)
+    : d(std::make_unique<QXmppCapabilitiesFileStoragePrivate>())
+{
+    d->path = path;
+}
+
+QXmppCapabilitiesFileStorage::~QXmppCapabilitiesFileStorage() = default;
+
+///
+/// Returns the path of the file.
+///
+QString QXmppCapabilitiesFileStorage::path() const
+{
+    return d->path;
+}
+
+/// \cond
+QXmppTask<std::optional<QXmppDiscoInfo>> QXmppCapabilitiesFileStorage::info(const QString &hashAlgorithm, const QByteArray &verificationString)
+{
+    d->readFile();
+
+    const auto itr = d->entries.find(std::pair { hashAlgorithm, verificationString });
+    if (itr == d->entries.end()) {
+        return makeReadyTask<std::optional<QXmppDiscoInfo>>(std::nullopt);
+    }
+    return makeReadyTask<std::optional<QXmppDiscoInfo>>(itr->second);
+}
+
+QXmppTask<void> QXmppCapabilitiesFileStorage::store(const QString &hashAlgorithm, const QByteArray &verificationString, const QXmppDiscoInfo &info)
+{
+    d->readFile();
+    d->entries.insert_or_assign(std::pair { hashAlgorithm, verificationString }, info);
+    d->writeFile();
+    return makeReadyTask();
+}
+/// \endcond
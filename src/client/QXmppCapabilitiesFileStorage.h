@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef QXMPPCAPABILITIESFILESTORAGE_H
+#define QXMPPCAPABILITIESFILESTORAGE_H
+
+#include "QXmppCapabilitiesStorage.h"
+
+#include <memory>
+
+class QXmppCapabilitiesFileStoragePrivate;
+
+class QXMPP_EXPORT QXmppCapabilitiesFileStorage : public QXmppCapabilitiesStorage
+{
+public:
+    explicit QXmppCapabilitiesFileStorage(const QString &path);
+    ~QXmppCapabilitiesFileStorage() override;
+
+    QString path() const;
+
+    /// \cond
+    QXmppTask<std::optional<QXmppDiscoInfo>> info(const QString &hashAlgorithm, const QByteArray &verificationString) override;
+    QXmppTask<void> store(const QString &hashAlgorithm, const QByteArray &verificationString, const QXmppDiscoInfo &info) override;
+    /// \endcond
+
+private:
+    const std::unique_ptr<QXmppCapabilitiesFileStoragePrivate> d;
+};
+
+#endif  // QXMPPCAPABILITIESFILESTORAGE_H
@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+///
+/// \class QXmppCapabilitiesStorage
+///
+/// \brief The QXmppCapabilitiesStorage class persists \xep{0115, Entity Capabilities}.
+///
+/// The QXmppDiscoveryManager caches the service discovery information of entities by their
+/// verification string. With a storage the cache survives restarts of the application, so known
+/// capabilities do not need to be requested again.
+///
+/// Only verified information is stored.
+///
+/// \sa QXmppDiscoveryManager::setCapabilitiesStorage()
+///
+/// \since QXmpp 1.13
+///
+
+///
+/// \fn QXmppCapabilitiesStorage::info(const QString &hashAlgorithm, const QByteArray &verificationString)
+///
+/// Returns the stored service discovery information for a verification string, if there is any.
+///
+/// \param hashAlgorithm name of the hash algorithm, e.g. "sha-1"
+/// \param verificationString the verification string (not base64 encoded)
+///
+
+///
+/// \fn QXmppCapabilitiesStorage::store(const QString &hashAlgorithm, const QByteArray &verificationString, const QXmppDiscoInfo &info)
+///
+/// Stores the service discovery information for a verification string.
+///
+/// \param hashAlgorithm name of the hash algorithm, e.g. "sha-1"
+/// \param verificationString the verification string (not base64 encoded)
+/// \param info service discovery information without node
+///
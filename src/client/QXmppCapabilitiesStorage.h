@@ -0,0 +1,24 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef QXMPPCAPABILITIESSTORAGE_H
+#define QXMPPCAPABILITIESSTORAGE_H
+
+#include "QXmppDiscoveryIq.h"
+
+#include <optional>
+
+template<typename T>
+class QXmppTask;
+
+class QXMPP_EXPORT QXmppCapabilitiesStorage
+{
+public:
+    virtual ~QXmppCapabilitiesStorage() = default;
+
+    virtual QXmppTask<std::optional<QXmppDiscoInfo>> info(const QString &hashAlgorithm, const QByteArray &verificationString) = 0;
+    virtual QXmppTask<void> store(const QString &hashAlgorithm, const QByteArray &verificationString, const QXmppDiscoInfo &info) = 0;
+};
+
+#endif  // QXMPPCAPABILITIESSTORAGE_H
@@ -69,6 +69,14 @@ QStringList QXmppCarbonManager::discoveryFeatures() const
     return { ns_carbons.toString() };
 }
 
+QList<QXmppClientExtension::StanzaFilter> QXmppCarbonManager::stanzaFilters() const
+{
+    return {
+        { u"message"_s, u"sent"_s, ns_carbons.toString() },
+        { u"message"_s, u"received"_s, ns_carbons.toString() },
+    };
+}
+
 bool QXmppCarbonManager::handleStanza(const QDomElement &element)
 {
     if (element.tagName() != u"message") {
@@ -18,6 +18,7 @@
 #include "QXmppLogger.h"
 #include "QXmppMessage.h"
 #include "QXmppMessageHandler.h"
+#include "QXmppMetrics_p.h"
 #include "QXmppPacket_p.h"
 #include "QXmppPromise.h"
 #include "QXmppRosterManager.h"
@@ -31,6 +32,7 @@
 #include "StringLiterals.h"
 #include "XmppSocket.h"
 
+#include <algorithm>
 #include <chrono>
 
 #include <QDomElement>
@@ -158,12 +160,72 @@ void QXmppClientPrivate::onErrorOccurred(const QString &text, const QXmppOutgoin
 }
 /// \endcond
 
+namespace QXmpp::Private {
+
+void ExtensionIndex::rebuild(const QList<QXmppClientExtension *> &extensions)
+{
+    m_extensions = extensions;
+    m_filtersByNamespace.clear();
+    m_unfiltered.clear();
+    m_messageHandlers.clear();
+
+    for (qsizetype i = 0; i < extensions.size(); i++) {
+        auto *extension = extensions.at(i);
+        const auto filters = extension->stanzaFilters();
+        if (filters.isEmpty()) {
+            m_unfiltered.push_back(i);
+        }
+        for (const auto &filter : filters) {
+            m_filtersByNamespace[filter.payloadNamespace].push_back({ filter.tagName, filter.payloadTagName, i });
+        }
+        if (auto *messageHandler = dynamic_cast<QXmppMessageHandler *>(extension)) {
+            m_messageHandlers.append(messageHandler);
+        }
+    }
+}
+
+void ExtensionIndex::findCandidates(const QDomElement &stanza, Candidates &candidates) const
+{
+    // no extension declared filters
+    if (m_filtersByNamespace.isEmpty()) {
+        candidates.append(m_extensions.constData(), m_extensions.size());
+        return;
+    }
+
+    QVarLengthArray<qsizetype, 32> indices(m_unfiltered.cbegin(), m_unfiltered.cend());
+    const auto tagName = stanza.tagName();
+    for (auto child = stanza.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+        auto itr = m_filtersByNamespace.constFind(child.namespaceURI());
+        if (itr == m_filtersByNamespace.cend()) {
+            continue;
+        }
+        for (const auto &filter : *itr) {
+            if ((filter.tagName.isEmpty() || filter.tagName == tagName) &&
+                (filter.payloadTagName.isEmpty() || filter.payloadTagName == child.tagName())) {
+                indices.append(filter.extensionIndex);
+            }
+        }
+    }
+
+    // restore the order of the extension list
+    std::sort(indices.begin(), indices.end());
+    auto end = std::unique(indices.begin(), indices.end());
+    for (auto itr = indices.begin(); itr != end; ++itr) {
+        candidates.append(m_extensions.at(*itr));
+    }
+}
+
+}  // namespace QXmpp::Private
+
 namespace QXmpp::Private::StanzaPipeline {
 
-bool process(const QList<QXmppClientExtension *> &extensions, const QDomElement &element, const std::optional<QXmppE2eeMetadata> &e2eeMetadata)
+bool process(const ExtensionIndex &index, const QDomElement &element, const std::optional<QXmppE2eeMetadata> &e2eeMetadata)
 {
+    ExtensionIndex::Candidates extensions;
+    index.findCandidates(element, extensions);
+
     const bool unencrypted = !e2eeMetadata.has_value();
-    for (auto *extension : extensions) {
+    for (auto *extension : std::as_const(extensions)) {
         // e2e encrypted stanzas are not passed to the old handleStanza() overload, because such
         // managers are likely not handling the encrypted contents correctly (e.g. sending
         // unencrypted replies and thereby leaking information).
@@ -179,19 +241,17 @@ bool process(const QList<QXmppClientExtension *> &extensions, const QDomElement
 
 namespace QXmpp::Private::MessagePipeline {
 
-bool process(QXmppClient *client, const QList<QXmppClientExtension *> &extensions, QXmppMessage &&message)
+bool process(QXmppClient *client, const ExtensionIndex &index, QXmppMessage &&message)
 {
-    for (auto *extension : extensions) {
-        if (auto *messageHandler = dynamic_cast<QXmppMessageHandler *>(extension)) {
-            if (messageHandler->handleMessage(message)) {
-                return true;
-            }
+    for (auto *messageHandler : index.messageHandlers()) {
+        if (messageHandler->handleMessage(message)) {
+            return true;
         }
     }
     return false;
 }
 
-bool process(QXmppClient *client, const QList<QXmppClientExtension *> &extensions, QXmppE2eeExtension *e2eeExt, const QDomElement &element)
+bool process(QXmppClient *client, const ExtensionIndex &index, QXmppE2eeExtension *e2eeExt, const QDomElement &element)
 {
     if (element.tagName() != u"message") {
         return false;
@@ -202,7 +262,7 @@ bool process(QXmppClient *client, const QList<QXmppClientExtension *> &extension
     } else {
         message.parse(element);
     }
-    return process(client, extensions, std::move(message));
+    return process(client, index, std::move(message));
 }
 
 }  // namespace QXmpp::Private::MessagePipeline
@@ -329,6 +389,10 @@ QXmppClient::QXmppClient(InitialExtensions initialExtensions, QObject *parent)
         d->onErrorOccurred(text, error, oldError);
     });
 
+    d->stream->streamAckManager().setBackpressureHandler([this](bool active) {
+        Q_EMIT backpressureChanged(active);
+    });
+
     connect(&d->stream->xmppSocket(), &XmppSocket::internalSocketStateChanged, this, &QXmppClient::onInternalSocketStateChanged);
 
     // reconnection
@@ -391,6 +455,7 @@ bool QXmppClient::insertExtension(int index, QXmppClientExtension *extension)
     extension->setParent(this);
     d->extensions.insert(index, extension);
     extension->setClient(this);
+    d->extensionIndex.rebuild(d->extensions);
     return true;
 }
 
@@ -402,6 +467,7 @@ bool QXmppClient::removeExtension(QXmppClientExtension *extension)
 {
     if (d->extensions.contains(extension)) {
         d->extensions.removeAll(extension);
+        d->extensionIndex.rebuild(d->extensions);
         extension->setClient(nullptr);
         delete extension;
         return true;
@@ -585,9 +651,9 @@ QXmppTask<QXmpp::SendResult> QXmppClient::reply(QXmppStanza &&stanza, const std:
 ///
 /// \since QXmpp 1.5
 ///
-QXmppTask<QXmppClient::IqResult> QXmppClient::sendIq(QXmppIq &&iq, const std::optional<QXmppSendStanzaParams> &)
+QXmppTask<QXmppClient::IqResult> QXmppClient::sendIq(QXmppIq &&iq, const std::optional<QXmppSendStanzaParams> &params)
 {
-    return d->stream->sendIq(std::move(iq));
+    return d->stream->sendIq(std::move(iq), params ? params->iqTimeout() : std::nullopt);
 }
 
 ///
@@ -606,14 +672,16 @@ QXmppTask<QXmppClient::IqResult> QXmppClient::sendIq(QXmppIq &&iq, const std::op
 ///
 QXmppTask<QXmppClient::IqResult> QXmppClient::sendSensitiveIq(QXmppIq &&iq, const std::optional<QXmppSendStanzaParams> &params)
 {
+    const auto timeout = params ? params->iqTimeout() : std::nullopt;
+
     if (d->encryptionExtension) {
         QXmppPromise<IqResult> p;
         auto task = p.task();
-        d->encryptionExtension->encryptIq(std::move(iq), params).then(this, [this, p = std::move(p)](IqEncryptResult result) mutable {
+        d->encryptionExtension->encryptIq(std::move(iq), params).then(this, [this, p = std::move(p), timeout](IqEncryptResult result) mutable {
             std::visit(overloaded {
                            [&](std::unique_ptr<QXmppIq> &&iq) {
                                // success (encrypted)
-                               d->stream->sendIq(std::move(*iq)).then(this, [this, p = std::move(p)](IqResult &&result) mutable {
+                               d->stream->sendIq(std::move(*iq), timeout).then(this, [this, p = std::move(p)](IqResult &&result) mutable {
                                    // iq sent, response received
                                    std::visit(overloaded {
                                                   [&](QDomElement &&el) {
@@ -662,7 +730,7 @@ QXmppTask<QXmppClient::IqResult> QXmppClient::sendSensitiveIq(QXmppIq &&iq, cons
 
         return task;
     }
-    return d->stream->sendIq(std::move(iq));
+    return d->stream->sendIq(std::move(iq), timeout);
 }
 
 ///
@@ -843,7 +911,7 @@ void QXmppClient::injectIq(const QDomElement &element, const std::optional<QXmpp
     if (element.tagName() != u"iq") {
         return;
     }
-    if (!StanzaPipeline::process(d->extensions, element, e2eeMetadata)) {
+    if (!StanzaPipeline::process(d->extensionIndex, element, e2eeMetadata)) {
         const auto iqType = element.attribute(u"type"_s);
         if (iqType == u"get" || iqType == u"set") {
             // send error IQ
@@ -867,7 +935,7 @@ void QXmppClient::injectIq(const QDomElement &element, const std::optional<QXmpp
 ///
 bool QXmppClient::injectMessage(QXmppMessage &&message)
 {
-    auto handled = MessagePipeline::process(this, d->extensions, std::move(message));
+    auto handled = MessagePipeline::process(this, d->extensionIndex, std::move(message));
     if (!handled) {
         // no extension handled the message
         Q_EMIT messageReceived(message);
@@ -894,8 +962,8 @@ void QXmppClient::_q_elementReceived(const QDomElement &element, bool &handled)
 {
     // The stanza comes directly from the XMPP stream, so it's not end-to-end
     // encrypted and there's no e2ee metadata (std::nullopt).
-    handled = StanzaPipeline::process(d->extensions, element, std::nullopt) ||
-        MessagePipeline::process(this, d->extensions, d->encryptionExtension, element);
+    handled = StanzaPipeline::process(d->extensionIndex, element, std::nullopt) ||
+        MessagePipeline::process(this, d->extensionIndex, d->encryptionExtension, element);
 }
 
 void QXmppClient::_q_reconnect()
@@ -954,6 +1022,7 @@ void QXmppClient::setLogger(QXmppLogger *logger)
                        d->logger, &QXmppLogger::setGauge);
             disconnect(this, &QXmppLoggable::updateCounter,
                        d->logger, &QXmppLogger::updateCounter);
+            disconnect(d->logger, nullptr, this, nullptr);
         }
 
         d->logger = logger;
@@ -964,7 +1033,20 @@ void QXmppClient::setLogger(QXmppLogger *logger)
                     d->logger, &QXmppLogger::setGauge);
             connect(this, &QXmppLoggable::updateCounter,
                     d->logger, &QXmppLogger::updateCounter);
+
+            // only build log messages that are going to be logged
+            connect(d->logger, &QXmppLogger::loggingTypeChanged, this, [this] {
+                updateLoggedMessageTypes(d->logger);
+            });
+            connect(d->logger, &QXmppLogger::messageTypesChanged, this, [this] {
+                updateLoggedMessageTypes(d->logger);
+            });
+            connect(d->logger, &QXmppLogger::metricsChanged, this, [this] {
+                d->stream->xmppSocket().setMetrics(StreamMetrics::create(d->logger->metrics(), u"client"_s));
+            });
         }
+        updateLoggedMessageTypes(d->logger);
+        d->stream->xmppSocket().setMetrics(StreamMetrics::create(d->logger ? d->logger->metrics() : nullptr, u"client"_s));
 
         Q_EMIT loggerChanged(d->logger);
     }
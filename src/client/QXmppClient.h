@@ -295,6 +295,19 @@ public:
     /// \since QXmpp 1.8
     Q_SIGNAL void credentialsChanged();
 
+    /// Emitted when the server does not acknowledge sent stanzas fast enough (\a active is true)
+    /// and when it has caught up again.
+    ///
+    /// When \xep{0198, Stream Management} is enabled, sent stanzas are kept until the server
+    /// acknowledges them. Once they reach the limit set with
+    /// QXmppConfiguration::setStreamManagementQueueLimit(), further stanzas are not written
+    /// to the socket anymore: their tasks stay pending until enough stanzas have been
+    /// acknowledged. Applications sending lots of stanzas should pause while backpressure is
+    /// active.
+    ///
+    /// \since QXmpp 1.13
+    Q_SIGNAL void backpressureChanged(bool active);
+
     Q_SLOT void connectToServer(const QXmppConfiguration &, const QXmppPresence &initialPresence = {});
     Q_SLOT void connectToServer(const QString &jid, const QString &password);
     Q_SLOT void disconnectFromServer();
@@ -345,6 +358,7 @@ private:
     friend class QXmppClientExtension;
     friend class QXmppCarbonManagerV2;
     friend class QXmppRegistrationManager;
+    friend class QXmppRosterManager;
     friend class TestClient;
 };
 
@@ -125,3 +125,22 @@ bool QXmppClientExtension::injectMessage(QXmppMessage &&message)
 {
     return client()->injectMessage(std::move(message));
 }
+
+///
+/// Returns the stanzas this extension handles.
+///
+/// The client uses the filters to pass incoming stanzas only to the extensions that can handle
+/// them. handleStanza() is only called for stanzas that have a direct child element matching one
+/// of the filters.
+///
+/// If an empty list is returned (the default), all stanzas are passed to handleStanza(). Only
+/// reimplement this if handleStanza() returns false for all other stanzas.
+///
+/// The filters are read when the extension is added to the client.
+///
+/// \since QXmpp 1.13
+///
+QList<QXmppClientExtension::StanzaFilter> QXmppClientExtension::stanzaFilters() const
+{
+    return {};
+}
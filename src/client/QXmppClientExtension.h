@@ -33,6 +33,20 @@ class QXMPP_EXPORT QXmppClientExtension : public QXmppLoggable, public QXmppExte
     Q_OBJECT
 
 public:
+    ///
+    /// Describes stanzas an extension handles by one of their direct child elements.
+    ///
+    /// \since QXmpp 1.13
+    ///
+    struct StanzaFilter {
+        /// Tag name of the stanza, e.g. "iq" or "message". Empty matches all stanzas.
+        QString tagName;
+        /// Tag name of the child element. Empty matches all elements in payloadNamespace.
+        QString payloadTagName;
+        /// Namespace URI of the child element
+        QString payloadNamespace;
+    };
+
     QXmppClientExtension();
     ~QXmppClientExtension() override;
 
@@ -52,6 +66,9 @@ protected:
     void injectIq(const QDomElement &element, const std::optional<QXmppE2eeMetadata> &e2eeMetadata);
     bool injectMessage(QXmppMessage &&message);
 
+public:
+    virtual QList<StanzaFilter> stanzaFilters() const;
+
 private:
     // m_client can be replaced with a d-ptr if needed (same size)
     QXmppClient *m_client;
@@ -23,13 +23,55 @@
 #include "QXmppPresence.h"
 
 #include <chrono>
+#include <vector>
+
+#include <QHash>
+#include <QVarLengthArray>
 
 class QXmppClient;
 class QXmppClientExtension;
 class QXmppE2eeExtension;
 class QXmppLogger;
+class QXmppMessageHandler;
 class QTimer;
 
+namespace QXmpp::Private {
+
+//
+// Index of the client extensions by the stanzas they handle (see
+// QXmppClientExtension::stanzaFilters()).
+//
+// Built when extensions are added or removed, so incoming stanzas are only offered to extensions
+// that declared a matching payload and to extensions that declared nothing. The order of the
+// extension list is kept.
+//
+class ExtensionIndex
+{
+public:
+    using Candidates = QVarLengthArray<QXmppClientExtension *, 32>;
+
+    void rebuild(const QList<QXmppClientExtension *> &extensions);
+
+    // Extensions that may handle the element, in the order of the extension list.
+    void findCandidates(const QDomElement &stanza, Candidates &candidates) const;
+    const QList<QXmppMessageHandler *> &messageHandlers() const { return m_messageHandlers; }
+
+private:
+    struct Filter {
+        QString tagName;
+        QString payloadTagName;
+        qsizetype extensionIndex;
+    };
+
+    QList<QXmppClientExtension *> m_extensions;
+    QHash<QString, std::vector<Filter>> m_filtersByNamespace;
+    // extensions without filters
+    std::vector<qsizetype> m_unfiltered;
+    QList<QXmppMessageHandler *> m_messageHandlers;
+};
+
+}  // namespace QXmpp::Private
+
 class QXmppClientPrivate
 {
 public:
@@ -40,6 +82,7 @@ public:
     /// Current presence of the client
     QXmppPresence clientPresence;
     QList<QXmppClientExtension *> extensions;
+    QXmpp::Private::ExtensionIndex extensionIndex;
     QXmppLogger *logger;
     /// Pointer to the XMPP stream
     QXmppOutgoingClient *stream;
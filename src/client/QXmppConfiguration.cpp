@@ -100,6 +100,15 @@ public:
     int keepAliveInterval = 60;
     // interval in seconds, if zero won't timeout
     int keepAliveTimeout = 20;
+    bool writeCoalescingEnabled = false;
+    qsizetype writeCoalescingThreshold = 16 * 1024;
+    // stream management ack requests
+    int ackRequestStanzaThreshold = 10;
+    std::chrono::milliseconds ackRequestDelay = std::chrono::milliseconds(250);
+    qsizetype ackRequestByteThreshold = 32 * 1024;
+    qsizetype streamManagementQueueLimit = 4 * 1024 * 1024;
+    // zero means no timeout
+    std::chrono::milliseconds iqTimeout = {};
     // will keep reconnecting if disconnected, default is true
     bool autoReconnectionEnabled = true;
     // which authentication systems to use (if any)
@@ -708,6 +717,207 @@ int QXmppConfiguration::keepAliveTimeout() const
     return d->keepAliveTimeout;
 }
 
+///
+/// Specifies whether outgoing data is collected and written to the socket once per event loop
+/// iteration.
+///
+/// Without this, every stanza (and every stream management ack request) is written to the socket
+/// separately, which results in one TLS record per write. With write coalescing enabled, data sent
+/// in a burst is written at once, which reduces the number of TLS records and syscalls. The data is
+/// still sent without waiting for any timer.
+///
+/// The default value is false.
+///
+/// \since QXmpp 1.13
+///
+void QXmppConfiguration::setWriteCoalescingEnabled(bool enabled)
+{
+    d->writeCoalescingEnabled = enabled;
+}
+
+///
+/// Returns whether outgoing data is collected and written to the socket once per event loop
+/// iteration.
+///
+/// The default value is false.
+///
+/// \since QXmpp 1.13
+///
+bool QXmppConfiguration::writeCoalescingEnabled() const
+{
+    return d->writeCoalescingEnabled;
+}
+
+///
+/// Specifies the number of bytes after which collected data is written to the socket immediately
+/// when write coalescing is enabled.
+///
+/// The default value is 16 KiB (the maximum size of a TLS record).
+///
+/// \since QXmpp 1.13
+///
+void QXmppConfiguration::setWriteCoalescingThreshold(qsizetype bytes)
+{
+    d->writeCoalescingThreshold = bytes;
+}
+
+///
+/// Returns the number of bytes after which collected data is written to the socket immediately
+/// when write coalescing is enabled.
+///
+/// The default value is 16 KiB (the maximum size of a TLS record).
+///
+/// \since QXmpp 1.13
+///
+qsizetype QXmppConfiguration::writeCoalescingThreshold() const
+{
+    return d->writeCoalescingThreshold;
+}
+
+///
+/// Specifies after how many sent stanzas an acknowledgement is requested from the server when
+/// \xep{0198, Stream Management} is enabled.
+///
+/// Requesting an acknowledgement after every stanza doubles the number of packets sent and
+/// makes the server respond to each request. Stanzas that are not covered by this limit are
+/// acknowledged after the ack request delay. A value of 1 requests an acknowledgement for every
+/// stanza.
+///
+/// The default value is 10.
+///
+/// \sa setAckRequestDelay(), setAckRequestByteThreshold()
+/// \since QXmpp 1.13
+///
+void QXmppConfiguration::setAckRequestStanzaThreshold(int stanzas)
+{
+    d->ackRequestStanzaThreshold = stanzas;
+}
+
+///
+/// Returns after how many sent stanzas an acknowledgement is requested from the server.
+///
+/// The default value is 10.
+///
+/// \since QXmpp 1.13
+///
+int QXmppConfiguration::ackRequestStanzaThreshold() const
+{
+    return d->ackRequestStanzaThreshold;
+}
+
+///
+/// Specifies the maximum time a sent stanza waits until an acknowledgement for it is requested
+/// from the server when \xep{0198, Stream Management} is enabled.
+///
+/// If set to zero, an acknowledgement is requested after every stanza.
+///
+/// The default value is 250 ms.
+///
+/// \since QXmpp 1.13
+///
+void QXmppConfiguration::setAckRequestDelay(std::chrono::milliseconds delay)
+{
+    d->ackRequestDelay = delay;
+}
+
+///
+/// Returns the maximum time a sent stanza waits until an acknowledgement for it is requested.
+///
+/// The default value is 250 ms.
+///
+/// \since QXmpp 1.13
+///
+std::chrono::milliseconds QXmppConfiguration::ackRequestDelay() const
+{
+    return d->ackRequestDelay;
+}
+
+///
+/// Specifies the size in bytes of unacknowledged stanzas at which an acknowledgement is
+/// requested immediately when \xep{0198, Stream Management} is enabled.
+///
+/// The default value is 32 KiB.
+///
+/// \since QXmpp 1.13
+///
+void QXmppConfiguration::setAckRequestByteThreshold(qsizetype bytes)
+{
+    d->ackRequestByteThreshold = bytes;
+}
+
+///
+/// Returns the size in bytes of unacknowledged stanzas at which an acknowledgement is
+/// requested immediately.
+///
+/// The default value is 32 KiB.
+///
+/// \since QXmpp 1.13
+///
+qsizetype QXmppConfiguration::ackRequestByteThreshold() const
+{
+    return d->ackRequestByteThreshold;
+}
+
+///
+/// Specifies the maximum size in bytes of sent stanzas that have not been acknowledged by the
+/// server yet when \xep{0198, Stream Management} is enabled.
+///
+/// Unacknowledged stanzas are kept in memory, so they can be resent after a reconnect. When the
+/// limit is reached, further stanzas are held back until the server has acknowledged enough
+/// stanzas and QXmppClient::backpressureChanged() is emitted. A value of 0 disables the limit.
+///
+/// The default value is 4 MiB.
+///
+/// \since QXmpp 1.13
+///
+void QXmppConfiguration::setStreamManagementQueueLimit(qsizetype bytes)
+{
+    d->streamManagementQueueLimit = bytes;
+}
+
+///
+/// Returns the maximum size in bytes of sent stanzas that have not been acknowledged by the
+/// server yet.
+///
+/// The default value is 4 MiB.
+///
+/// \since QXmpp 1.13
+///
+qsizetype QXmppConfiguration::streamManagementQueueLimit() const
+{
+    return d->streamManagementQueueLimit;
+}
+
+///
+/// Specifies the time to wait for the response to an IQ request.
+///
+/// When no response has been received in time, the request finishes with a QXmppError
+/// containing QXmpp::TimeoutError and its state is released. The timeout can be overridden for
+/// single requests using QXmppSendStanzaParams::setIqTimeout().
+///
+/// Timeouts have a resolution of 250 ms.
+///
+/// The default value is zero, which means that requests do not time out.
+///
+/// \since QXmpp 1.13
+///
+void QXmppConfiguration::setIqTimeout(std::chrono::milliseconds timeout)
+{
+    d->iqTimeout = timeout;
+}
+
+///
+/// Returns the time to wait for the response to an IQ request.
+///
+/// The default value is zero, which means that requests do not time out.
+///
+/// \since QXmpp 1.13
+///
+std::chrono::milliseconds QXmppConfiguration::iqTimeout() const
+{
+    return d->iqTimeout;
+}
+
 /// Specifies a list of trusted CA certificates.
 void QXmppConfiguration::setCaCertificates(const QList<QSslCertificate> &caCertificates)
 {
@@ -7,6 +7,7 @@
 
 #include "QXmppGlobal.h"
 
+#include <chrono>
 #include <optional>
 
 #include <QSharedDataPointer>
@@ -150,6 +151,27 @@ public:
     int keepAliveTimeout() const;
     void setKeepAliveTimeout(int secs);
 
+    bool writeCoalescingEnabled() const;
+    void setWriteCoalescingEnabled(bool enabled);
+
+    qsizetype writeCoalescingThreshold() const;
+    void setWriteCoalescingThreshold(qsizetype bytes);
+
+    int ackRequestStanzaThreshold() const;
+    void setAckRequestStanzaThreshold(int stanzas);
+
+    std::chrono::milliseconds ackRequestDelay() const;
+    void setAckRequestDelay(std::chrono::milliseconds delay);
+
+    qsizetype ackRequestByteThreshold() const;
+    void setAckRequestByteThreshold(qsizetype bytes);
+
+    qsizetype streamManagementQueueLimit() const;
+    void setStreamManagementQueueLimit(qsizetype bytes);
+
+    std::chrono::milliseconds iqTimeout() const;
+    void setIqTimeout(std::chrono::milliseconds timeout);
+
     QList<QSslCertificate> caCertificates() const;
     void setCaCertificates(const QList<QSslCertificate> &);
 
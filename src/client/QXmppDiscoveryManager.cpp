@@ -3,6 +3,7 @@
 //
 // SPDX-License-Identifier: LGPL-2.1-or-later
 
+#include "QXmppCapabilitiesStorage.h"
 #include "QXmppClient.h"
 #include "QXmppClient_p.h"
 #include "QXmppConstants_p.h"
@@ -47,6 +48,14 @@ static QXmppTask<std::variant<Response, QXmppError>> get(QXmppClient *client, co
 ///
 /// Since QXmpp 1.12 info and items queries are cached per session by default.
 ///
+/// ## XEP-0115: Entity Capabilities
+///
+/// Since QXmpp 1.13 the capabilities advertised in received presences are cached by their hash
+/// algorithm and verification string. Many entities usually share the same capabilities, so only
+/// one info query is sent per verification string. The received information is only cached if it
+/// matches the verification string. The cache is kept between sessions and can be persisted with
+/// setCapabilitiesStorage(). info() returns the cached capabilities of an entity without a query.
+///
 /// \ingroup Managers
 ///
 
@@ -55,6 +64,7 @@ QXmppDiscoveryManager::QXmppDiscoveryManager()
 {
     d->infoCache.setMaxCost(50);
     d->itemsCache.setMaxCost(50);
+    d->capabilitiesCache.setMaxCost(500);
     d->clientCapabilitiesNode = u"org.qxmpp.caps"_s;
     d->identities = { d->defaultIdentity() };
 }
@@ -68,6 +78,28 @@ QXmppDiscoveryManager::~QXmppDiscoveryManager() = default;
 ///
 QXmppTask<Result<QXmppDiscoInfo>> QXmppDiscoveryManager::info(const QString &jid, const QString &node, CachePolicy cachePolicy)
 {
+    // XEP-0115: Entity Capabilities: verified capabilities are always current
+    if (const auto itr = d->entityCapabilities.constFind(jid); node.isEmpty() && itr != d->entityCapabilities.cend()) {
+        if (auto *capabilities = d->capabilitiesCache.object(*itr)) {
+            return makeReadyTask<Result<QXmppDiscoInfo>>(*capabilities);
+        }
+        if (auto task = d->capabilitiesRequests.attach(*itr)) {
+            QXmppPromise<Result<QXmppDiscoInfo>> promise;
+            auto resultTask = promise.task();
+            task->then(this, [this, jid, cachePolicy, promise](Result<QXmppDiscoInfo> &&result) mutable {
+                if (std::holds_alternative<QXmppDiscoInfo>(result)) {
+                    promise.finish(std::move(result));
+                } else {
+                    // the capabilities could not be verified, query the entity itself
+                    info(jid, {}, cachePolicy).then(this, [promise](Result<QXmppDiscoInfo> &&fallback) mutable {
+                        promise.finish(std::move(fallback));
+                    });
+                }
+            });
+            return resultTask;
+        }
+    }
+
     if (cachePolicy == CachePolicy::Relaxed) {
         if (auto *cachedInfo = d->infoCache[{ jid, node }]) {
             return makeReadyTask<Result<QXmppDiscoInfo>>(*cachedInfo);
@@ -227,12 +259,43 @@ void QXmppDiscoveryManager::setClientCapabilitiesNode(const QString &node)
     d->clientCapabilitiesNode = node;
 }
 
+///
+/// Returns the storage that persists \xep{0115, Entity Capabilities}, nullptr by default.
+///
+/// \since QXmpp 1.13
+///
+QXmppCapabilitiesStorage *QXmppDiscoveryManager::capabilitiesStorage() const
+{
+    return d->capabilitiesStorage;
+}
+
+///
+/// Sets the storage that persists \xep{0115, Entity Capabilities}.
+///
+/// Capabilities that are not in the memory cache are looked up in the storage before they are
+/// requested. The storage is not owned by the manager and must outlive it.
+///
+/// \since QXmpp 1.13
+///
+void QXmppDiscoveryManager::setCapabilitiesStorage(QXmppCapabilitiesStorage *storage)
+{
+    d->capabilitiesStorage = storage;
+}
+
 /// \cond
 QStringList QXmppDiscoveryManager::discoveryFeatures() const
 {
     return { ns_disco_info.toString() };
 }
 
+QList<QXmppClientExtension::StanzaFilter> QXmppDiscoveryManager::stanzaFilters() const
+{
+    return {
+        { u"iq"_s, u"query"_s, ns_disco_info.toString() },
+        { u"iq"_s, u"query"_s, ns_disco_items.toString() },
+    };
+}
+
 bool QXmppDiscoveryManager::handleStanza(const QDomElement &element)
 {
     if (handleIqRequests<GetIq<QXmppDiscoInfo>, GetIq<QXmppDiscoItems>>(element, client(), d.get())) {
@@ -274,8 +337,13 @@ void QXmppDiscoveryManager::onRegistered(QXmppClient *client)
         if (client->streamManagementState() != QXmppClient::ResumedStream) {
             d->itemsCache.clear();
             d->infoCache.clear();
+            // the capabilities of the entities are sent again in their presences
+            d->entityCapabilities.clear();
         }
     });
+    connect(client, &QXmppClient::presenceReceived, this, [this](const QXmppPresence &presence) {
+        d->handlePresence(presence);
+    });
 }
 
 void QXmppDiscoveryManager::onUnregistered(QXmppClient *client)
@@ -309,6 +377,113 @@ QXmppDiscoIdentity QXmppDiscoveryManagerPrivate::defaultIdentity()
     };
 }
 
+std::optional<QCryptographicHash::Algorithm> QXmppDiscoveryManagerPrivate::capabilitiesHashAlgorithm(const QString &name)
+{
+    // hash function names from the IANA registry, MD5 is not accepted
+    if (name == u"sha-1") {
+        return QCryptographicHash::Sha1;
+    }
+    if (name == u"sha-224") {
+        return QCryptographicHash::Sha224;
+    }
+    if (name == u"sha-256") {
+        return QCryptographicHash::Sha256;
+    }
+    if (name == u"sha-384") {
+        return QCryptographicHash::Sha384;
+    }
+    if (name == u"sha-512") {
+        return QCryptographicHash::Sha512;
+    }
+    return {};
+}
+
+bool QXmppDiscoveryManagerPrivate::verifyCapabilities(const CapabilitiesKey &key, const QXmppDiscoInfo &info)
+{
+    const auto &[hash, ver] = key;
+    const auto algorithm = capabilitiesHashAlgorithm(hash);
+    return algorithm && info.calculateEntityCapabilitiesHash(*algorithm) == ver;
+}
+
+void QXmppDiscoveryManagerPrivate::handlePresence(const QXmppPresence &presence)
+{
+    const auto jid = presence.from();
+    if (jid.isEmpty() || jid == q->client()->configuration().jid()) {
+        return;
+    }
+
+    if (presence.type() == QXmppPresence::Unavailable) {
+        entityCapabilities.remove(jid);
+        return;
+    }
+    if (presence.type() != QXmppPresence::Available) {
+        return;
+    }
+
+    // legacy capabilities without hash are not supported
+    if (presence.capabilityNode().isEmpty() || presence.capabilityVer().isEmpty() ||
+        !capabilitiesHashAlgorithm(presence.capabilityHash())) {
+        entityCapabilities.remove(jid);
+        return;
+    }
+
+    const CapabilitiesKey key { presence.capabilityHash(), presence.capabilityVer() };
+    entityCapabilities.insert(jid, key);
+    if (!capabilitiesCache.contains(key)) {
+        requestCapabilities(key, jid, presence.capabilityNode());
+    }
+}
+
+// Looks up the capabilities in the storage or requests them from \a jid. Concurrent requests for
+// the same capabilities are merged.
+QXmppTask<Result<QXmppDiscoInfo>> QXmppDiscoveryManagerPrivate::requestCapabilities(const CapabilitiesKey &key, const QString &jid, const QString &node)
+{
+    return capabilitiesRequests.produce(
+        key,
+        [this, jid, node](const CapabilitiesKey &key) {
+            QXmppPromise<Result<QXmppDiscoInfo>> promise;
+            auto task = promise.task();
+
+            auto request = [this, key, jid, node, promise]() mutable {
+                const auto &[hash, ver] = key;
+                const auto capabilitiesNode = node + u'#' + QString::fromLatin1(ver.toBase64());
+                get<QXmppDiscoInfo>(q->client(), jid, QXmppDiscoInfo { capabilitiesNode }).then(q, [this, key, jid, promise](auto &&result) mutable {
+                    if (auto *info = std::get_if<QXmppDiscoInfo>(&result)) {
+                        info->setNode({});
+                        if (!verifyCapabilities(key, *info)) {
+                            q->warning(u"Entity capabilities of %1 do not match their verification string"_s.arg(jid));
+                            return promise.finish(QXmppError { u"Entity capabilities could not be verified."_s, {} });
+                        }
+
+                        const auto &[hash, ver] = key;
+                        capabilitiesCache.insert(key, new QXmppDiscoInfo { *info });
+                        if (capabilitiesStorage) {
+                            capabilitiesStorage->store(hash, ver, *info);
+                        }
+                    }
+                    promise.finish(std::move(result));
+                });
+            };
+
+            if (capabilitiesStorage) {
+                const auto &[hash, ver] = key;
+                capabilitiesStorage->info(hash, ver).then(q, [this, key, promise, request](std::optional<QXmppDiscoInfo> &&stored) mutable {
+                    // stored capabilities are verified again, the storage may have been modified
+                    if (stored && verifyCapabilities(key, *stored)) {
+                        capabilitiesCache.insert(key, new QXmppDiscoInfo { *stored });
+                        promise.finish(std::move(*stored));
+                    } else {
+                        request();
+                    }
+                });
+            } else {
+                request();
+            }
+            return task;
+        },
+        q);
+}
+
 std::variant<CompatIq<QXmppDiscoInfo>, QXmppStanza::Error> QXmppDiscoveryManagerPrivate::handleIq(GetIq<QXmppDiscoInfo> &&iq)
 {
     if (iq.payload.node().isEmpty() || iq.payload.node().startsWith(clientCapabilitiesNode)) {
@@ -14,6 +14,7 @@
 
 template<typename T>
 class QXmppTask;
+class QXmppCapabilitiesStorage;
 class QXmppDataForm;
 class QXmppDiscoveryIq;
 class QXmppDiscoveryManagerPrivate;
@@ -49,10 +50,14 @@ public:
     QString clientCapabilitiesNode() const;
     void setClientCapabilitiesNode(const QString &);
 
+    QXmppCapabilitiesStorage *capabilitiesStorage() const;
+    void setCapabilitiesStorage(QXmppCapabilitiesStorage *storage);
+
     QXmppDiscoInfo buildClientInfo() const;
 
     /// \cond
     QStringList discoveryFeatures() const override;
+    QList<StanzaFilter> stanzaFilters() const override;
     bool handleStanza(const QDomElement &element) override;
     /// \endcond
 
@@ -6,11 +6,14 @@
 #define QXMPPDISCOVERYMANAGER_P_H
 
 #include "QXmppDiscoveryManager.h"
+#include "QXmppPresence.h"
 #include "QXmppPromise.h"
 
 #include "Iq.h"
 
 #include <QCache>
+#include <QCryptographicHash>
+#include <QHash>
 
 using namespace QXmpp::Private;
 
@@ -85,6 +88,8 @@ class QXmppDiscoveryManagerPrivate
 {
 public:
     using StanzaError = QXmppStanza::Error;
+    // XEP-0115: Entity Capabilities: hash algorithm and verification string
+    using CapabilitiesKey = std::tuple<QString, QByteArray>;
 
     QXmppDiscoveryManager *q = nullptr;
     QString clientCapabilitiesNode;
@@ -94,15 +99,26 @@ public:
     // cached data
     QCache<std::tuple<QString, QString>, QXmppDiscoInfo> infoCache;
     QCache<std::tuple<QString, QString>, QList<QXmppDiscoItem>> itemsCache;
+    // verified capabilities, shared by all entities and kept between sessions
+    QCache<CapabilitiesKey, QXmppDiscoInfo> capabilitiesCache;
+    // full JIDs mapped to the capabilities from their last presence
+    QHash<QString, CapabilitiesKey> entityCapabilities;
+    QXmppCapabilitiesStorage *capabilitiesStorage = nullptr;
 
     // outgoing requests
     AttachableRequests<std::tuple<QString, QString>, QXmpp::Result<QXmppDiscoInfo>> infoRequests;
     AttachableRequests<std::tuple<QString, QString>, QXmpp::Result<QList<QXmppDiscoItem>>> itemsRequests;
+    AttachableRequests<CapabilitiesKey, QXmpp::Result<QXmppDiscoInfo>> capabilitiesRequests;
 
     explicit QXmppDiscoveryManagerPrivate(QXmppDiscoveryManager *q) : q(q) { }
 
     static QString defaultApplicationName();
     static QXmppDiscoIdentity defaultIdentity();
+    static std::optional<QCryptographicHash::Algorithm> capabilitiesHashAlgorithm(const QString &name);
+    static bool verifyCapabilities(const CapabilitiesKey &key, const QXmppDiscoInfo &info);
+
+    void handlePresence(const QXmppPresence &presence);
+    QXmppTask<QXmpp::Result<QXmppDiscoInfo>> requestCapabilities(const CapabilitiesKey &key, const QString &jid, const QString &node);
 
     std::variant<CompatIq<QXmppDiscoInfo>, StanzaError> handleIq(GetIq<QXmppDiscoInfo> &&iq);
     std::variant<CompatIq<QXmppDiscoItems>, StanzaError> handleIq(GetIq<QXmppDiscoItems> &&iq);
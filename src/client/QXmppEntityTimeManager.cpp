@@ -66,6 +66,13 @@ QStringList QXmppEntityTimeManager::discoveryFeatures() const
     return { ns_entity_time.toString() };
 }
 
+QList<QXmppClientExtension::StanzaFilter> QXmppEntityTimeManager::stanzaFilters() const
+{
+    return {
+        { u"iq"_s, u"time"_s, ns_entity_time.toString() },
+    };
+}
+
 bool QXmppEntityTimeManager::handleStanza(const QDomElement &element)
 {
     if (handleIqRequests<QXmppEntityTimeIq>(element, client(), this)) {
@@ -16,11 +16,15 @@
 #include "QXmppUtils_p.h"
 
 #include "Algorithms.h"
+#include "Async.h"
 #include "StringLiterals.h"
 
+#include <deque>
+#include <functional>
 #include <unordered_map>
 
 #include <QDomElement>
+#include <QSet>
 
 using namespace QXmpp;
 using namespace QXmpp::Private;
@@ -49,7 +53,7 @@ QXmppMessage parseMamMessage(const MamMessage &mamMessage, EncryptedType encrypt
     return m;
 }
 
-std::optional<std::tuple<MamMessage, QString>> parseMamMessageResult(const QDomElement &messageEl)
+std::optional<std::tuple<MamMessage, QString, QString>> parseMamMessageResult(const QDomElement &messageEl)
 {
     auto resultElement = firstChildElement(messageEl, u"result", ns_mam);
     if (resultElement.isNull()) {
@@ -76,33 +80,204 @@ std::optional<std::tuple<MamMessage, QString>> parseMamMessageResult(const QDomE
         return {};
     };
 
-    return { { MamMessage { messageElement, parseDelay(forwardedElement) }, queryId } };
+    return { { MamMessage { messageElement, parseDelay(forwardedElement) }, queryId, resultElement.attribute(u"id"_s) } };
 }
 
-struct RetrieveRequestState {
-    QXmppPromise<QXmppMamManager::RetrieveResult> promise;
-    QXmppMamResultIq iq;
-    QVector<MamMessage> messages;
-    QVector<QXmppMessage> processedMessages;
-    uint runningDecryptionJobs = 0;
-
-    void finish()
-    {
-        Q_ASSERT(messages.count() == processedMessages.count());
-        promise.finish(
-            QXmppMamManager::RetrievedMessages {
-                std::move(iq),
-                std::move(processedMessages) });
-    }
+// archived message of a streamed request
+struct StreamedMessage {
+    QXmppMamManager::ArchivedMessage archived;
+    // archived.message is parsed for decryption and still needs to be decrypted
+    bool encrypted = false;
+    // whether archived.message is final and can be delivered
+    bool ready = false;
+};
+
+// Makes a message parsed for decryption usable if it can not be decrypted: like a message parsed
+// with SceAll, it has the fallback body as body.
+static void useFallbackBody(QXmppMessage &message)
+{
+    message.setBody(message.e2eeFallbackBody());
+    message.setE2eeFallbackBody({});
+}
+
+struct StreamRequestState {
+    QXmppPromise<QXmppMamManager::StreamResult> promise;
+    QXmppMamManager::MessageHandler handler;
+    // received messages that have not been delivered yet, in order
+    std::deque<StreamedMessage> queue;
+    // number of messages removed from the queue, converts queue indices to message indices
+    qsizetype delivered = 0;
+    // index of the next message that may need to be decrypted
+    qsizetype nextDecryption = 0;
+    int runningDecryptionJobs = 0;
+    // called when the result IQ has been received, before all messages have been delivered
+    std::function<void(const QXmppMamResultIq &)> resultHandler;
+    // set when the result IQ has been received
+    std::optional<QXmppMamResultIq> iq;
+    // processStream() is running, prevents recursion from synchronous decryption and handlers
+    bool processing = false;
+    bool reprocess = false;
+};
+
+struct CatchUpState {
+    QXmppPromise<QXmppMamManager::CatchUpResult> promise;
+    QXmppMamManager::MessageHandler handler;
+    QXmppMamManager::ProgressHandler progressHandler;
+    QString to;
+    QString jid;
+    QDateTime start;
+    int pageSize = 0;
+    QXmppMamManager::CatchUpProgress progress;
+    // number of pages that have been requested
+    qsizetype requestedPages = 0;
+    // pages that have been received and decrypted, but not completed because an earlier page is
+    // still being processed
+    QSet<qsizetype> finishedPages;
+    // messages of the prefetched page, delivered after the current page has been completed
+    std::vector<QXmppMamManager::ArchivedMessage> buffered;
+    // RSM 'after' of the next page, if it has not been requested yet
+    std::optional<QString> nextPage;
+    // the server has reported the end of the archive
+    bool complete = false;
+    bool finished = false;
 };
 
 class QXmppMamManagerPrivate
 {
 public:
+    QXmppTask<QXmppMamManager::StreamResult> stream(QXmppMamQueryIq &&queryIq,
+                                                    QXmppMamManager::MessageHandler handler,
+                                                    std::function<void(const QXmppMamResultIq &)> resultHandler = {});
+    void processStream(const QString &queryId);
+    void requestCatchUpPage(const std::shared_ptr<CatchUpState> &state, const QString &after);
+    void finishCatchUpPage(const std::shared_ptr<CatchUpState> &state, qsizetype page);
+
+    QXmppMamManager *q = nullptr;
+    int decryptionWindow = 8;
     // std::string because older Qt 5 versions don't add std::hash support for QString
-    std::unordered_map<std::string, RetrieveRequestState> ongoingRequests;
+    std::unordered_map<std::string, StreamRequestState> streamRequests;
 };
 
+QXmppTask<QXmppMamManager::StreamResult> QXmppMamManagerPrivate::stream(QXmppMamQueryIq &&queryIq,
+                                                                        QXmppMamManager::MessageHandler handler,
+                                                                        std::function<void(const QXmppMamResultIq &)> resultHandler)
+{
+    auto queryId = queryIq.queryId();
+
+    auto [itr, inserted] = streamRequests.insert({ queryId.toStdString(), StreamRequestState() });
+    Q_ASSERT(inserted);
+    itr->second.handler = std::move(handler);
+    itr->second.resultHandler = std::move(resultHandler);
+
+    // create task here; promise could finish immediately after client()->sendIq()
+    auto task = itr->second.promise.task();
+
+    q->client()->sendIq(std::move(queryIq)).then(q, [this, queryId](QXmppClient::IqResult result) {
+        auto itr = streamRequests.find(queryId.toStdString());
+        if (itr == streamRequests.end()) {
+            return;
+        }
+        auto &state = itr->second;
+
+        // handle IQ sending errors
+        if (std::holds_alternative<QXmppError>(result)) {
+            auto promise = std::move(state.promise);
+            streamRequests.erase(itr);
+            promise.finish(std::get<QXmppError>(std::move(result)));
+            return;
+        }
+
+        QXmppMamResultIq iq;
+        iq.parse(std::get<QDomElement>(result));
+        state.iq = std::move(iq);
+        if (state.resultHandler) {
+            // copy, the handler may start other requests
+            auto resultHandler = state.resultHandler;
+            resultHandler(*state.iq);
+        }
+        processStream(queryId);
+    });
+
+    return task;
+}
+
+//
+// Starts decryptions within the window and delivers all messages that are ready in order. Finishes
+// the request once the result IQ has been received and all messages have been delivered.
+//
+void QXmppMamManagerPrivate::processStream(const QString &queryId)
+{
+    auto itr = streamRequests.find(queryId.toStdString());
+    if (itr == streamRequests.end()) {
+        return;
+    }
+    auto &state = itr->second;
+
+    if (state.processing) {
+        state.reprocess = true;
+        return;
+    }
+    state.processing = true;
+
+    do {
+        state.reprocess = false;
+
+        // start decryptions in order, but only as many as the window allows
+        auto *e2eeExt = q->client()->encryptionExtension();
+        while (state.nextDecryption - state.delivered < qsizetype(state.queue.size()) &&
+               state.runningDecryptionJobs < decryptionWindow) {
+            const auto index = state.nextDecryption++;
+            auto &entry = state.queue[index - state.delivered];
+            if (!entry.encrypted || !e2eeExt) {
+                if (entry.encrypted) {
+                    useFallbackBody(entry.archived.message);
+                }
+                entry.ready = true;
+                continue;
+            }
+
+            state.runningDecryptionJobs++;
+            // the message is implicitly shared, the copy stays as fallback
+            e2eeExt->decryptMessage(QXmppMessage(entry.archived.message)).then(q, [this, queryId, index](auto result) {
+                auto itr = streamRequests.find(queryId.toStdString());
+                if (itr == streamRequests.end()) {
+                    return;
+                }
+                auto &state = itr->second;
+                auto &entry = state.queue[index - state.delivered];
+
+                if (std::holds_alternative<QXmppMessage>(result)) {
+                    entry.archived.message = std::get<QXmppMessage>(std::move(result));
+                } else {
+                    q->warning(u"Error decrypting message."_s);
+                    useFallbackBody(entry.archived.message);
+                }
+                entry.ready = true;
+                state.runningDecryptionJobs--;
+                processStream(queryId);
+            });
+        }
+
+        // deliver in order
+        while (!state.queue.empty() && state.queue.front().ready) {
+            auto archived = std::move(state.queue.front().archived);
+            state.queue.pop_front();
+            state.delivered++;
+            state.handler(std::move(archived));
+        }
+    } while (state.reprocess);
+
+    state.processing = false;
+
+    if (state.iq && state.queue.empty() && state.runningDecryptionJobs == 0) {
+        auto promise = std::move(state.promise);
+        auto iq = std::move(*state.iq);
+        // the handler may have started other requests, so itr may be invalid
+        streamRequests.erase(queryId.toStdString());
+        promise.finish(std::move(iq));
+    }
+}
+
 ///
 /// \struct QXmppMamManager::RetrievedMessages
 ///
@@ -131,9 +306,94 @@ public:
 /// \since QXmpp 1.5
 ///
 
+///
+/// \struct QXmppMamManager::ArchivedMessage
+///
+/// \brief Message delivered by streamMessages().
+///
+/// \since QXmpp 1.13
+///
+
+///
+/// \var QXmppMamManager::ArchivedMessage::id
+///
+/// ID of the message in the archive, can be used for paging with a QXmppResultSetQuery.
+///
+
+///
+/// \var QXmppMamManager::ArchivedMessage::message
+///
+/// The archived message, decrypted if possible.
+///
+
+///
+/// \typedef QXmppMamManager::MessageHandler
+///
+/// Function that is called with each message of streamMessages().
+///
+/// \since QXmpp 1.13
+///
+
+///
+/// \typedef QXmppMamManager::StreamResult
+///
+/// Contains the result IQ of the query or a QXmppError.
+///
+/// \since QXmpp 1.13
+///
+
+///
+/// \struct QXmppMamManager::CatchUpProgress
+///
+/// \brief Progress of catchUp().
+///
+/// \since QXmpp 1.13
+///
+
+///
+/// \var QXmppMamManager::CatchUpProgress::lastId
+///
+/// Archive ID of the last delivered message. catchUp() can be resumed from here.
+///
+
+///
+/// \var QXmppMamManager::CatchUpProgress::messages
+///
+/// Number of messages that have been delivered.
+///
+
+///
+/// \var QXmppMamManager::CatchUpProgress::pages
+///
+/// Number of pages that have been completed.
+///
+
+///
+/// \var QXmppMamManager::CatchUpProgress::total
+///
+/// Number of messages to catch up with, if reported by the server. This may be an approximation.
+///
+
+///
+/// \typedef QXmppMamManager::ProgressHandler
+///
+/// Function that is called with the progress of catchUp().
+///
+/// \since QXmpp 1.13
+///
+
+///
+/// \typedef QXmppMamManager::CatchUpResult
+///
+/// Contains the final CatchUpProgress or a QXmppError.
+///
+/// \since QXmpp 1.13
+///
+
 QXmppMamManager::QXmppMamManager()
     : d(std::make_unique<QXmppMamManagerPrivate>())
 {
+    d->q = this;
 }
 
 QXmppMamManager::~QXmppMamManager() = default;
@@ -145,16 +405,31 @@ QStringList QXmppMamManager::discoveryFeatures() const
     return { ns_mam.toString() };
 }
 
+QList<QXmppClientExtension::StanzaFilter> QXmppMamManager::stanzaFilters() const
+{
+    return {
+        { u"message"_s, u"result"_s, ns_mam.toString() },
+        { u"iq"_s, u"fin"_s, ns_mam.toString() },
+    };
+}
+
 bool QXmppMamManager::handleStanza(const QDomElement &element)
 {
     if (element.tagName() == u"message") {
         if (auto result = parseMamMessageResult(element)) {
-            auto &[message, queryId] = *result;
-
-            auto itr = d->ongoingRequests.find(queryId.toStdString());
-            if (itr != d->ongoingRequests.end()) {
-                // future-based API
-                itr->second.messages.append(std::move(message));
+            auto &[message, queryId, archiveId] = *result;
+
+            auto itr = d->streamRequests.find(queryId.toStdString());
+            if (itr != d->streamRequests.end()) {
+                // task-based API: parse now, so the DOM is released before the message is delivered
+                StreamedMessage entry;
+                entry.archived.id = archiveId;
+                // encrypted messages are parsed once for the decryption
+                auto *e2eeExt = client()->encryptionExtension();
+                entry.encrypted = e2eeExt && e2eeExt->isEncrypted(message.element);
+                entry.archived.message = parseMamMessage(message, entry.encrypted ? Encrypted : Unencrypted);
+                itr->second.queue.push_back(std::move(entry));
+                d->processStream(queryId);
             } else {
                 // signal-based API
                 Q_EMIT archivedMessageReceived(queryId, parseMamMessage(message, Unencrypted));
@@ -280,91 +555,213 @@ QString QXmppMamManager::retrieveArchivedMessages(const QString &to,
 ///
 QXmppTask<QXmppMamManager::RetrieveResult> QXmppMamManager::retrieveMessages(const QString &to, const QString &node, const QString &jid, const QDateTime &start, const QDateTime &end, const QXmppResultSetQuery &resultSetQuery)
 {
-    auto queryIq = buildRequest(to, node, jid, start, end, resultSetQuery);
-    auto queryId = queryIq.queryId();
+    auto messages = std::make_shared<QVector<QXmppMessage>>();
+    return chain<RetrieveResult>(
+        streamMessages([messages](ArchivedMessage &&archived) { messages->append(std::move(archived.message)); },
+                       to, node, jid, start, end, resultSetQuery),
+        this,
+        [messages](StreamResult &&result) -> RetrieveResult {
+            if (auto *iq = std::get_if<QXmppMamResultIq>(&result)) {
+                return RetrievedMessages { std::move(*iq), std::move(*messages) };
+            }
+            return std::get<QXmppError>(std::move(result));
+        });
+}
 
-    auto [itr, inserted] = d->ongoingRequests.insert({ queryIq.queryId().toStdString(), RetrieveRequestState() });
-    Q_ASSERT(inserted);
+///
+/// Retrieves archived messages and delivers each message to \a handler as soon as it is
+/// available.
+///
+/// The messages are delivered in the order of the archive. Encrypted messages are decrypted, at
+/// most decryptionWindow() at the same time. If the decryption fails, the encrypted message is
+/// delivered. The received XML of a message is released before the message is delivered, so
+/// memory does not grow with the number of messages that have already been delivered.
+///
+/// The returned task finishes after all messages have been delivered.
+///
+/// \param handler Function that is called with each message.
+/// \param to Optional entity that should be queried. Leave this empty to query
+///           the local archive.
+/// \param node Optional node that should be queried. This is used when querying
+///             a pubsub node.
+/// \param jid Optional JID to filter the results.
+/// \param start Optional start time to filter the results.
+/// \param end Optional end time to filter the results.
+/// \param resultSetQuery Optional Result Set Management query. This can be used
+///                       to limit the number of results and to page through the
+///                       archive.
+/// \return result IQ of the query that can be used for pagination
+///
+/// \since QXmpp 1.13
+///
+QXmppTask<QXmppMamManager::StreamResult> QXmppMamManager::streamMessages(MessageHandler handler, const QString &to, const QString &node, const QString &jid, const QDateTime &start, const QDateTime &end, const QXmppResultSetQuery &resultSetQuery)
+{
+    return d->stream(buildRequest(to, node, jid, start, end, resultSetQuery), std::move(handler));
+}
 
-    // create task here; promise could finish immediately after client()->sendIq()
-    auto task = itr->second.promise.task();
+///
+/// Retrieves all messages after the archived message with the ID \a afterId, page by page.
+///
+/// The pages are requested with Result Set Management. The next page is requested as soon as the
+/// server has sent the current one, so the round-trip overlaps with decrypting and handling the
+/// current page. The messages are delivered to \a handler in archive order, see streamMessages().
+///
+/// \a progressHandler is called after each completed page. If the catch-up fails (e.g. because
+/// the connection was lost), it can be resumed by calling catchUp() with
+/// CatchUpProgress::lastId or the ID of the last message passed to \a handler.
+///
+/// \param handler Function that is called with each message.
+/// \param afterId ID of the last message that is known. If empty, the whole archive is retrieved.
+/// \param progressHandler Optional function that is called after each page.
+/// \param to Optional entity that should be queried. Leave this empty to query the local archive.
+/// \param jid Optional JID to filter the results.
+/// \param pageSize Maximum number of messages requested per page.
+///
+/// \since QXmpp 1.13
+///
+QXmppTask<QXmppMamManager::CatchUpResult> QXmppMamManager::catchUp(MessageHandler handler, const QString &afterId, ProgressHandler progressHandler, const QString &to, const QString &jid, int pageSize)
+{
+    auto state = std::make_shared<CatchUpState>();
+    state->handler = std::move(handler);
+    state->progressHandler = std::move(progressHandler);
+    state->to = to;
+    state->jid = jid;
+    state->pageSize = pageSize;
+    state->progress.lastId = afterId;
+
+    auto task = state->promise.task();
+    d->requestCatchUpPage(state, afterId);
+    return task;
+}
 
-    // retrieve messages
-    client()->sendIq(std::move(queryIq)).then(this, [this, queryId](QXmppClient::IqResult result) {
-        auto itr = d->ongoingRequests.find(queryId.toStdString());
-        if (itr == d->ongoingRequests.end()) {
+///
+/// Retrieves all messages since \a since, page by page.
+///
+/// Works like the other overload, but starts at a point in time. This is useful if no archive
+/// ID is known, e.g. on the first start.
+///
+/// \since QXmpp 1.13
+///
+QXmppTask<QXmppMamManager::CatchUpResult> QXmppMamManager::catchUp(MessageHandler handler, const QDateTime &since, ProgressHandler progressHandler, const QString &to, const QString &jid, int pageSize)
+{
+    auto state = std::make_shared<CatchUpState>();
+    state->handler = std::move(handler);
+    state->progressHandler = std::move(progressHandler);
+    state->to = to;
+    state->jid = jid;
+    state->start = since;
+    state->pageSize = pageSize;
+
+    auto task = state->promise.task();
+    d->requestCatchUpPage(state, {});
+    return task;
+}
+
+void QXmppMamManagerPrivate::requestCatchUpPage(const std::shared_ptr<CatchUpState> &state, const QString &after)
+{
+    QXmppResultSetQuery resultSetQuery;
+    resultSetQuery.setMax(state->pageSize);
+    if (!after.isEmpty()) {
+        resultSetQuery.setAfter(after);
+    }
+
+    const auto page = state->requestedPages++;
+    state->nextPage.reset();
+
+    auto deliver = [state, page](QXmppMamManager::ArchivedMessage &&archived) {
+        if (state->finished) {
             return;
         }
-        auto &state = itr->second;
+        // messages of the prefetched page wait for the current page
+        if (page != state->progress.pages) {
+            state->buffered.push_back(std::move(archived));
+            return;
+        }
+        state->progress.lastId = archived.id;
+        state->progress.messages++;
+        state->handler(std::move(archived));
+    };
 
-        // handle IQ sending errors
-        if (std::holds_alternative<QXmppError>(result)) {
-            state.promise.finish(std::get<QXmppError>(result));
-            d->ongoingRequests.erase(itr);
+    auto onResult = [this, state, page](const QXmppMamResultIq &iq) {
+        if (state->finished) {
             return;
         }
+        if (page == 0 && iq.resultSetReply().count() >= 0) {
+            state->progress.total = iq.resultSetReply().count();
+        }
 
-        // parse IQ
-        auto &iq = state.iq;
-        iq.parse(std::get<QDomElement>(result));
+        const auto last = iq.resultSetReply().last();
+        if (iq.complete() || last.isEmpty()) {
+            state->complete = true;
+            return;
+        }
 
-        // decrypt encrypted messages
-        if (auto *e2eeExt = client()->encryptionExtension()) {
-            // initialize processed messages (we need random access because
-            // decryptMessage() may finish in random order)
-            state.processedMessages.resize(state.messages.size());
-            state.runningDecryptionJobs = state.messages.size();
-
-            const auto size = state.messages.size();
-            for (qsizetype i = 0; i < size; i++) {
-                const auto &message = state.messages.at(i);
-
-                // decrypt message if needed
-                if (e2eeExt->isEncrypted(message.element)) {
-                    e2eeExt->decryptMessage(parseMamMessage(state.messages.at(i), Encrypted)).then(this, [this, i, queryId](auto result) {
-                        // find state (again)
-                        auto itr = d->ongoingRequests.find(queryId.toStdString());
-                        Q_ASSERT(itr != d->ongoingRequests.end());
-
-                        auto &state = itr->second;
-
-                        // store decrypted message, fallback to encrypted message
-                        if (std::holds_alternative<QXmppMessage>(result)) {
-                            state.processedMessages[i] = std::get<QXmppMessage>(std::move(result));
-                        } else {
-                            warning(u"Error decrypting message."_s);
-                            state.processedMessages[i] = parseMamMessage(state.messages[i], Unencrypted);
-                        }
-
-                        // finish promise on last job
-                        state.runningDecryptionJobs--;
-                        if (state.runningDecryptionJobs == 0) {
-                            state.finish();
-                            d->ongoingRequests.erase(itr);
-                        }
-                    });
-                } else {
-                    state.processedMessages[i] = parseMamMessage(state.messages.at(i), Unencrypted);
-
-                    // finish promise on last job (may be needed if no messages are encrypted or
-                    // decryption finishes instantly)
-                    state.runningDecryptionJobs--;
-                    if (state.runningDecryptionJobs == 0) {
-                        state.finish();
-                        d->ongoingRequests.erase(itr);
-                    }
-                }
+        // prefetch at most one page
+        state->nextPage = last;
+        if (state->requestedPages - state->progress.pages < 2) {
+            requestCatchUpPage(state, last);
+        }
+    };
+
+    stream(buildRequest(state->to, {}, state->jid, state->start, {}, resultSetQuery), std::move(deliver), std::move(onResult))
+        .then(q, [this, state, page](QXmppMamManager::StreamResult &&result) {
+            if (state->finished) {
+                return;
             }
-        } else {
-            // for the case without decryption
-            state.processedMessages = transform<QVector<QXmppMessage>>(state.messages, [](const auto &m) {
-                return parseMamMessage(m, Unencrypted);
-            });
+            if (auto *error = std::get_if<QXmppError>(&result)) {
+                state->finished = true;
+                state->promise.finish(std::move(*error));
+                return;
+            }
+            finishCatchUpPage(state, page);
+        });
+}
+
+void QXmppMamManagerPrivate::finishCatchUpPage(const std::shared_ptr<CatchUpState> &state, qsizetype page)
+{
+    // complete pages in order
+    state->finishedPages.insert(page);
+    while (state->finishedPages.remove(state->progress.pages)) {
+        state->progress.pages++;
+        if (state->progressHandler) {
+            state->progressHandler(state->progress);
+        }
 
-            state.finish();
-            d->ongoingRequests.erase(itr);
+        // deliver the prefetched page that has been buffered
+        auto buffered = std::exchange(state->buffered, {});
+        for (auto &archived : buffered) {
+            state->progress.lastId = archived.id;
+            state->progress.messages++;
+            state->handler(std::move(archived));
         }
-    });
+    }
 
-    return task;
+    if (state->nextPage && state->requestedPages - state->progress.pages < 2) {
+        requestCatchUpPage(state, *state->nextPage);
+    } else if (state->complete && state->requestedPages == state->progress.pages) {
+        state->finished = true;
+        state->promise.finish(state->progress);
+    }
+}
+
+///
+/// Returns the maximum number of messages that are decrypted at the same time by
+/// streamMessages() and retrieveMessages().
+///
+/// \since QXmpp 1.13
+///
+int QXmppMamManager::decryptionWindow() const
+{
+    return d->decryptionWindow;
+}
+
+///
+/// Sets the maximum number of messages that are decrypted at the same time by
+/// streamMessages() and retrieveMessages(), the default is 8.
+///
+/// \since QXmpp 1.13
+///
+void QXmppMamManager::setDecryptionWindow(int window)
+{
+    d->decryptionWindow = std::max(window, 1);
 }
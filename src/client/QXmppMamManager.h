@@ -8,15 +8,17 @@
 #include "QXmppClientExtension.h"
 #include "QXmppError.h"
 #include "QXmppMamIq.h"
+#include "QXmppMessage.h"
 #include "QXmppResultSet.h"
 
+#include <functional>
+#include <optional>
 #include <variant>
 
 #include <QDateTime>
 
 template<typename T>
 class QXmppTask;
-class QXmppMessage;
 class QXmppMamManagerPrivate;
 
 ///
@@ -31,6 +33,17 @@ class QXmppMamManagerPrivate;
 /// client->addExtension(manager);
 /// \endcode
 ///
+/// To synchronize the history after reconnecting, use catchUp() with the ID of the last
+/// message that has been stored:
+///
+/// \code
+/// manager->catchUp([](QXmppMamManager::ArchivedMessage &&archived) {
+///     // store archived.message and archived.id
+/// }, lastStoredId).then(this, [](QXmppMamManager::CatchUpResult &&result) {
+///     // ...
+/// });
+/// \endcode
+///
 /// \ingroup Managers
 ///
 /// \since QXmpp 1.0
@@ -47,6 +60,24 @@ public:
 
     using RetrieveResult = std::variant<RetrievedMessages, QXmppError>;
 
+    struct QXMPP_EXPORT ArchivedMessage {
+        QString id;
+        QXmppMessage message;
+    };
+
+    using MessageHandler = std::function<void(ArchivedMessage &&)>;
+    using StreamResult = std::variant<QXmppMamResultIq, QXmppError>;
+
+    struct QXMPP_EXPORT CatchUpProgress {
+        QString lastId;
+        qsizetype messages = 0;
+        qsizetype pages = 0;
+        std::optional<int> total;
+    };
+
+    using ProgressHandler = std::function<void(const CatchUpProgress &)>;
+    using CatchUpResult = std::variant<CatchUpProgress, QXmppError>;
+
     QXmppMamManager();
     ~QXmppMamManager();
 
@@ -62,9 +93,33 @@ public:
                                                const QDateTime &start = QDateTime(),
                                                const QDateTime &end = QDateTime(),
                                                const QXmppResultSetQuery &resultSetQuery = QXmppResultSetQuery());
+    QXmppTask<StreamResult> streamMessages(MessageHandler handler,
+                                           const QString &to = QString(),
+                                           const QString &node = QString(),
+                                           const QString &jid = QString(),
+                                           const QDateTime &start = QDateTime(),
+                                           const QDateTime &end = QDateTime(),
+                                           const QXmppResultSetQuery &resultSetQuery = QXmppResultSetQuery());
+
+    QXmppTask<CatchUpResult> catchUp(MessageHandler handler,
+                                     const QString &afterId,
+                                     ProgressHandler progressHandler = {},
+                                     const QString &to = QString(),
+                                     const QString &jid = QString(),
+                                     int pageSize = 100);
+    QXmppTask<CatchUpResult> catchUp(MessageHandler handler,
+                                     const QDateTime &since,
+                                     ProgressHandler progressHandler = {},
+                                     const QString &to = QString(),
+                                     const QString &jid = QString(),
+                                     int pageSize = 100);
+
+    int decryptionWindow() const;
+    void setDecryptionWindow(int window);
 
     /// \cond
     QStringList discoveryFeatures() const override;
+    QList<StanzaFilter> stanzaFilters() const override;
     bool handleStanza(const QDomElement &element) override;
     /// \endcond
 
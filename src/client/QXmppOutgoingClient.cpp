@@ -9,6 +9,7 @@
 #include "QXmppAsync_p.h"
 #include "QXmppConstants_p.h"
 #include "QXmppMessage.h"
+#include "QXmppMetrics_p.h"
 #include "QXmppNonSASLAuth.h"
 #include "QXmppOutgoingClient_p.h"
 #include "QXmppPacket_p.h"
@@ -147,6 +148,16 @@ void QXmppOutgoingClientPrivate::connectToHost(const ServerAddress &address)
     // set the name the SSL certificate should match
     socket.internalSocket()->setPeerVerifyName(config.domain());
 
+    socket.setWriteCoalescingEnabled(config.writeCoalescingEnabled());
+    socket.setFlushThreshold(config.writeCoalescingThreshold());
+    streamAckManager.setAckRequestPolicy({
+        config.ackRequestStanzaThreshold(),
+        config.ackRequestDelay(),
+        config.ackRequestByteThreshold(),
+    });
+    streamAckManager.setQueueLimit(config.streamManagementQueueLimit());
+    iqManager.setDefaultTimeout(config.iqTimeout());
+
     socket.connectToHost(address);
 }
 
@@ -163,6 +174,13 @@ void QXmppOutgoingClientPrivate::connectToNextAddress()
     connectToHost(serverAddresses.at(nextServerAddressIndex++));
 }
 
+void QXmppOutgoingClientPrivate::observeAuthTime(const QElapsedTimer &timer)
+{
+    if (const auto *metrics = socket.metrics()) {
+        observeElapsed(metrics->authTime, timer);
+    }
+}
+
 ///
 /// Constructs an outgoing client stream.
 ///
@@ -321,6 +339,12 @@ bool QXmppOutgoingClient::isConnected() const
     return d->socket.isConnected() && d->sessionStarted;
 }
 
+/// Returns whether the server advertised \xep{0237, Roster Versioning} in its stream features.
+bool QXmppOutgoingClient::rosterVersioningSupported() const
+{
+    return d->rosterVersioningSupported;
+}
+
 ///
 /// Sends an IQ and reports the response asynchronously.
 ///
@@ -330,10 +354,23 @@ bool QXmppOutgoingClient::isConnected() const
 /// \since QXmpp 1.5
 ///
 QXmppTask<IqResult> QXmppOutgoingClient::sendIq(QXmppIq &&iq)
+{
+    return sendIq(std::move(iq), std::nullopt);
+}
+
+///
+/// Sends an IQ and reports the response asynchronously.
+///
+/// If no response has been received after \a timeout, the task finishes with a QXmppError
+/// containing QXmpp::TimeoutError. Without a timeout, QXmppConfiguration::iqTimeout() is used.
+///
+/// \since QXmpp 1.13
+///
+QXmppTask<IqResult> QXmppOutgoingClient::sendIq(QXmppIq &&iq, std::optional<std::chrono::milliseconds> timeout)
 {
     // If 'to' is empty the user's bare JID is meant implicitly (see RFC6120, section 10.3.3.).
     auto to = iq.to();
-    return d->iqManager.sendIq(std::move(iq), to.isEmpty() ? d->config.jidBare() : to);
+    return d->iqManager.sendIq(std::move(iq), to.isEmpty() ? d->config.jidBare() : to, timeout);
 }
 
 void QXmppOutgoingClient::handleSocketDisconnected()
@@ -395,9 +432,12 @@ void QXmppOutgoingClient::startSasl2Auth(const Sasl2::StreamFeature &sasl2Featur
     d->c2sStreamManager.onSasl2Authenticate(sasl2Request, sasl2Feature);
 
     // start authentication
-    d->setListener<Sasl2Manager>(&d->socket).authenticate(std::move(sasl2Request), d->config, sasl2Feature, this).then(this, [this](auto result) {
+    QElapsedTimer authTimer;
+    authTimer.start();
+    d->setListener<Sasl2Manager>(&d->socket).authenticate(std::move(sasl2Request), d->config, sasl2Feature, this).then(this, [this, authTimer](auto result) {
         if (auto success = std::get_if<Sasl2::Success>(&result)) {
             debug(u"Authenticated"_s);
+            d->observeAuthTime(authTimer);
             d->isAuthenticated = true;
             d->authenticationMethod = AuthenticationMethod::Sasl2;
             d->config.setJid(success->authorizationIdentifier);
@@ -741,6 +781,9 @@ HandleElementResult QXmppOutgoingClient::handleElement(const QDomElement &nodeRe
 
 void QXmppOutgoingClient::handleStreamFeatures(const QXmppStreamFeatures &features)
 {
+    // the feature is only advertised to authenticated clients, or before SASL 2 authentication
+    d->rosterVersioningSupported = features.rosterVersioningSupported();
+
     // STARTTLS
     if (handleStarttls(features)) {
         return;
@@ -757,9 +800,12 @@ void QXmppOutgoingClient::handleStreamFeatures(const QXmppStreamFeatures &featur
     }
     // SASL
     if (saslAvailable && configuration().useSASLAuthentication()) {
-        d->setListener<SaslManager>(&d->socket).authenticate(d->config, features.authMechanisms(), this).then(this, [this](auto result) {
+        QElapsedTimer authTimer;
+        authTimer.start();
+        d->setListener<SaslManager>(&d->socket).authenticate(d->config, features.authMechanisms(), this).then(this, [this, authTimer](auto result) {
             if (std::holds_alternative<Success>(result)) {
                 debug(u"Authenticated"_s);
+                d->observeAuthTime(authTimer);
                 d->isAuthenticated = true;
                 d->authenticationMethod = AuthenticationMethod::Sasl;
                 d->socket.resetStream();
@@ -1149,13 +1195,16 @@ void PingManager::sendPing()
 
 OutgoingIqManager::OutgoingIqManager(QXmppLoggable *l, StreamAckManager &streamAckManager)
     : l(l),
-      m_streamAckManager(streamAckManager)
+      m_streamAckManager(streamAckManager),
+      m_timeouts(std::chrono::milliseconds(250), 512, [this](TimerWheelEntry &entry) {
+          handleTimeout(static_cast<IqState &>(entry));
+      })
 {
 }
 
 OutgoingIqManager::~OutgoingIqManager() = default;
 
-QXmppTask<IqResult> OutgoingIqManager::sendIq(QXmppIq &&iq, const QString &to)
+QXmppTask<IqResult> OutgoingIqManager::sendIq(QXmppIq &&iq, const QString &to, std::optional<std::chrono::milliseconds> timeout)
 {
     if (iq.id().isEmpty()) {
         warning(u"QXmpp: sendIq() error: ID is empty. Using random ID."_s);
@@ -1168,12 +1217,12 @@ QXmppTask<IqResult> OutgoingIqManager::sendIq(QXmppIq &&iq, const QString &to)
         iq.setId(QXmppUtils::generateStanzaUuid());
     }
 
-    return sendIq(QXmppPacket(iq), iq.id(), to);
+    return sendIq(QXmppPacket(iq), iq.id(), to, timeout);
 }
 
-QXmppTask<IqResult> OutgoingIqManager::sendIq(QXmppPacket &&packet, const QString &id, const QString &to)
+QXmppTask<IqResult> OutgoingIqManager::sendIq(QXmppPacket &&packet, const QString &id, const QString &to, std::optional<std::chrono::milliseconds> timeout)
 {
-    auto task = start(id, to);
+    auto task = start(id, to, timeout);
 
     // the task only finishes instantly if there was an error
     if (task.isFinished()) {
@@ -1200,7 +1249,7 @@ bool OutgoingIqManager::isIdValid(const QString &id) const
     return !id.isEmpty() && !hasId(id);
 }
 
-QXmppTask<IqResult> OutgoingIqManager::start(const QString &id, const QString &to)
+QXmppTask<IqResult> OutgoingIqManager::start(const QString &id, const QString &to, std::optional<std::chrono::milliseconds> timeout)
 {
     if (!isIdValid(id)) {
         return makeReadyTask<IqResult>(
@@ -1214,8 +1263,18 @@ QXmppTask<IqResult> OutgoingIqManager::start(const QString &id, const QString &t
                          SendError::Disconnected });
     }
 
-    auto [itr, success] = m_requests.emplace(id, IqState { {}, to });
-    return itr->second.interface.task();
+    auto [itr, success] = m_requests.try_emplace(id);
+    auto &state = itr->second;
+    state.id = id;
+    state.jid = to;
+
+    // the state is never moved, so it can be scheduled directly
+    if (const auto duration = timeout.value_or(m_defaultTimeout); duration > std::chrono::milliseconds::zero()) {
+        m_timeouts.schedule(state, duration);
+    }
+
+    updatePendingGauge();
+    return state.interface.task();
 }
 
 void OutgoingIqManager::finish(const QString &id, IqResult &&result)
@@ -1223,6 +1282,7 @@ void OutgoingIqManager::finish(const QString &id, IqResult &&result)
     if (auto itr = m_requests.find(id); itr != m_requests.end()) {
         itr->second.interface.finish(std::move(result));
         m_requests.erase(itr);
+        updatePendingGauge();
     }
 }
 
@@ -1234,6 +1294,7 @@ void OutgoingIqManager::cancelAll()
             QXmpp::SendError::Disconnected });
     }
     m_requests.clear();
+    updatePendingGauge();
 }
 
 void OutgoingIqManager::onSessionOpened(const SessionBegin &session)
@@ -1303,9 +1364,26 @@ bool OutgoingIqManager::handleStanza(const QDomElement &stanza)
     }
 
     m_requests.erase(itr);
+    updatePendingGauge();
     return true;
 }
 
+void OutgoingIqManager::handleTimeout(IqState &state)
+{
+    m_timeoutCount++;
+    Q_EMIT l->updateCounter(u"outgoing-iq.timeouts"_s);
+    warning(u"IQ request '%1' to '%2' timed out."_s.arg(state.id, state.jid));
+
+    // a response that is received later is ignored
+    const auto id = state.id;
+    finish(id, QXmppError { u"IQ request timed out."_s, QXmpp::TimeoutError() });
+}
+
+void OutgoingIqManager::updatePendingGauge()
+{
+    Q_EMIT l->setGauge(u"outgoing-iq.pending"_s, double(m_requests.size()));
+}
+
 void OutgoingIqManager::warning(const QString &message)
 {
     Q_EMIT l->logMessage(QXmppLogger::WarningMessage, message);
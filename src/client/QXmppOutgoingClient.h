@@ -14,6 +14,9 @@
 #include "QXmppStanza.h"
 #include "QXmppStreamError.h"
 
+#include <chrono>
+#include <optional>
+
 #include <QAbstractSocket>
 
 class QDomElement;
@@ -93,7 +96,9 @@ public:
     void disconnectFromHost();
     bool isAuthenticated() const;
     bool isConnected() const;
+    bool rosterVersioningSupported() const;
     QXmppTask<IqResult> sendIq(QXmppIq &&);
+    QXmppTask<IqResult> sendIq(QXmppIq &&, std::optional<std::chrono::milliseconds> timeout);
 
     QXmppStanza::Error::Condition xmppStreamError();
 
@@ -12,6 +12,7 @@
 #include "QXmppStreamManagement_p.h"
 
 #include "StreamError.h"
+#include "TimerWheel.h"
 #include "XmppSocket.h"
 
 #include <QDnsLookup>
@@ -119,8 +120,9 @@ private:
 
 using IqResult = QXmppOutgoingClient::IqResult;
 
-struct IqState {
+struct IqState : TimerWheelEntry {
     QXmppPromise<IqResult> interface;
+    QString id;
     QString jid;
 };
 
@@ -131,13 +133,21 @@ public:
     OutgoingIqManager(QXmppLoggable *l, StreamAckManager &streamAckMananger);
     ~OutgoingIqManager();
 
-    QXmppTask<IqResult> sendIq(QXmppIq &&, const QString &to);
-    QXmppTask<IqResult> sendIq(QXmppPacket &&, const QString &id, const QString &to);
+    QXmppTask<IqResult> sendIq(QXmppIq &&, const QString &to, std::optional<std::chrono::milliseconds> timeout = {});
+    QXmppTask<IqResult> sendIq(QXmppPacket &&, const QString &id, const QString &to, std::optional<std::chrono::milliseconds> timeout = {});
 
     bool hasId(const QString &id) const;
     bool isIdValid(const QString &id) const;
 
-    QXmppTask<IqResult> start(const QString &id, const QString &to);
+    // timeout for requests without explicit timeout, zero means no timeout
+    std::chrono::milliseconds defaultTimeout() const { return m_defaultTimeout; }
+    void setDefaultTimeout(std::chrono::milliseconds timeout) { m_defaultTimeout = timeout; }
+
+    // metrics
+    std::size_t pendingCount() const { return m_requests.size(); }
+    quint64 timeoutCount() const { return m_timeoutCount; }
+
+    QXmppTask<IqResult> start(const QString &id, const QString &to, std::optional<std::chrono::milliseconds> timeout = {});
     void finish(const QString &id, IqResult &&result);
     void cancelAll();
 
@@ -146,10 +156,16 @@ public:
     bool handleStanza(const QDomElement &stanza);
 
 private:
+    void handleTimeout(IqState &state);
+    void updatePendingGauge();
     void warning(const QString &message);
 
     QXmppLoggable *l;
     StreamAckManager &m_streamAckManager;
+    std::chrono::milliseconds m_defaultTimeout = {};
+    quint64 m_timeoutCount = 0;
+    // needs to outlive the requests
+    TimerWheel m_timeouts;
     std::unordered_map<QString, IqState> m_requests;
 };
 
@@ -168,6 +184,7 @@ public:
     void connectToHost(const ServerAddress &);
     void connectToAddressList(std::vector<ServerAddress> &&);
     void connectToNextAddress();
+    void observeAuthTime(const QElapsedTimer &timer);
 
     // This object provides the configuration
     // required for connecting to the XMPP server.
@@ -195,6 +212,7 @@ public:
     // Authentication & Session
     bool isAuthenticated = false;
     bool bindModeAvailable = false;
+    bool rosterVersioningSupported = false;
     bool sessionStarted = false;
     AuthenticationMethod authenticationMethod = AuthenticationMethod::Sasl;
     std::optional<Bind2Bound> bind2Bound;
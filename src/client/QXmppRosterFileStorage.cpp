@@ -0,0 +1,153 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "QXmppRosterFileStorage.h"
+
+#include "QXmppConstants_p.h"
+#include "QXmppTask.h"
+#include "QXmppUtils_p.h"
+
+#include "Async.h"
+#include "StringLiterals.h"
+#include "XmlWriter.h"
+
+#include <QDomDocument>
+#include <QFile>
+#include <QSaveFile>
+
+using namespace QXmpp::Private;
+
+///
+/// \class QXmppRosterFileStorage
+///
+/// \brief The QXmppRosterFileStorage class caches the roster in a file.
+///
+/// The roster is kept in the memory and the file is read on the first access. Every change
+/// rewrites the file atomically, it contains the roster in the format of a roster query:
+///
+/// \code{.xml}
+/// <query xmlns="jabber:iq:roster" ver="ver14">
+///     <item jid="romeo@example.net" subscription="both"/>
+/// </query>
+/// \endcode
+///
+/// \since QXmpp 1.13
+///
+
+class QXmppRosterFileStoragePrivate
+{
+public:
+    QString path;
+    bool fileRead = false;
+};
+
+///
+/// Constructs a roster storage that uses the file at \a path.
+///
+QXmppRosterFileStorage::QXmppRosterFileStorage(const QString &path)
+    : d(std::make_unique<QXmppRosterFileStoragePrivate>())
+{
+    d->path = path;
+}
+
+QXmppRosterFileStorage::~QXmppRosterFileStorage() = default;
+
+///
+/// Returns the path of the file.
+///
+QString QXmppRosterFileStorage::path() const
+{
+    return d->path;
+}
+
+/// \cond
+QXmppTask<QXmppRosterStorage::Roster> QXmppRosterFileStorage::load()
+{
+    readFile();
+    return QXmppRosterMemoryStorage::load();
+}
+
+QXmppTask<void> QXmppRosterFileStorage::store(const Roster &roster)
+{
+    // the file content is replaced completely
+    d->fileRead = true;
+    QXmppRosterMemoryStorage::store(roster);
+    writeFile();
+    return makeReadyTask();
+}
+
+QXmppTask<void> QXmppRosterFileStorage::update(const QString &version, const QList<QXmppRosterIq::Item> &items)
+{
+    readFile();
+    QXmppRosterMemoryStorage::update(version, items);
+    writeFile();
+    return makeReadyTask();
+}
+
+QXmppTask<void> QXmppRosterFileStorage::clear()
+{
+    d->fileRead = true;
+    QXmppRosterMemoryStorage::clear();
+    QFile::remove(d->path);
+    return makeReadyTask();
+}
+/// \endcond
+
+void QXmppRosterFileStorage::readFile()
+{
+    if (d->fileRead) {
+        return;
+    }
+    d->fileRead = true;
+
+    QFile file(d->path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDomDocument document;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    if (!document.setContent(&file, QDomDocument::ParseOption::UseNamespaceProcessing)) {
+#else
+    if (!document.setContent(&file, true)) {
+#endif
+        qWarning("[QXmpp] QXmppRosterFileStorage: Could not parse roster file");
+        return;
+    }
+
+    const auto query = document.documentElement();
+    if (query.tagName() != u"query" || query.namespaceURI() != ns_roster) {
+        qWarning("[QXmpp] QXmppRosterFileStorage: Invalid roster file");
+        return;
+    }
+
+    QXmppRosterMemoryStorage::store(Roster {
+        query.attribute(u"ver"_s),
+        parseChildElements<QList<QXmppRosterIq::Item>>(query),
+    });
+}
+
+void QXmppRosterFileStorage::writeFile()
+{
+    const auto roster = QXmppRosterMemoryStorage::load().takeResult();
+
+    QSaveFile file(d->path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("[QXmpp] QXmppRosterFileStorage: Could not open roster file for writing");
+        return;
+    }
+
+    QXmlStreamWriter writer(&file);
+    writer.writeStartDocument();
+    XmlWriter(&writer).write(Element {
+        { u"query", ns_roster },
+        OptionalAttribute { u"ver", roster.version },
+        roster.items,
+    });
+    writer.writeEndDocument();
+
+    if (writer.hasError() || !file.commit()) {
+        qWarning("[QXmpp] QXmppRosterFileStorage: Could not write roster file");
+    }
+}
@@ -0,0 +1,34 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef QXMPPROSTERFILESTORAGE_H
+#define QXMPPROSTERFILESTORAGE_H
+
+#include "QXmppRosterMemoryStorage.h"
+
+class QXmppRosterFileStoragePrivate;
+
+class QXMPP_EXPORT QXmppRosterFileStorage : public QXmppRosterMemoryStorage
+{
+public:
+    explicit QXmppRosterFileStorage(const QString &path);
+    ~QXmppRosterFileStorage() override;
+
+    QString path() const;
+
+    /// \cond
+    QXmppTask<Roster> load() override;
+    QXmppTask<void> store(const Roster &roster) override;
+    QXmppTask<void> update(const QString &version, const QList<QXmppRosterIq::Item> &items) override;
+    QXmppTask<void> clear() override;
+    /// \endcond
+
+private:
+    void readFile();
+    void writeFile();
+
+    const std::unique_ptr<QXmppRosterFileStoragePrivate> d;
+};
+
+#endif  // QXMPPROSTERFILESTORAGE_H
@@ -11,6 +11,7 @@
 #include "QXmppClient.h"
 #include "QXmppConstants_p.h"
 #include "QXmppMovedManager.h"
+#include "QXmppOutgoingClient.h"
 #include "QXmppPresence.h"
 #include "QXmppRosterIq.h"
 #include "QXmppUtils.h"
@@ -21,11 +22,53 @@
 #include "StringLiterals.h"
 #include "XmlWriter.h"
 
+#include <algorithm>
+#include <span>
+
 #include <QDomElement>
+#include <QHash>
 
 using namespace QXmpp;
 using namespace QXmpp::Private;
 
+using ResourcePresence = QXmppRosterManager::ResourcePresence;
+
+// Shares equal strings between the stored presences, strings are removed when they are not used
+// anymore.
+template<typename String>
+class InternPool
+{
+public:
+    String acquire(const String &string)
+    {
+        if (string.isEmpty()) {
+            return {};
+        }
+        auto itr = m_strings.find(string);
+        if (itr == m_strings.end()) {
+            itr = m_strings.insert(string, 0);
+        }
+        itr.value()++;
+        return itr.key();
+    }
+
+    void release(const String &string)
+    {
+        if (string.isEmpty()) {
+            return;
+        }
+        auto itr = m_strings.find(string);
+        if (itr != m_strings.end() && --itr.value() == 0) {
+            m_strings.erase(itr);
+        }
+    }
+
+    void clear() { m_strings.clear(); }
+
+private:
+    QHash<String, int> m_strings;
+};
+
 namespace QXmpp::Private {
 
 struct RosterData {
@@ -96,11 +139,23 @@ public:
     // map of bareJid and its rosterEntry
     QMap<QString, QXmppRosterIq::Item> entries;
 
-    // map of resources of the jid and map of resources and presences
-    QMap<QString, QMap<QString, QXmppPresence>> presences;
+    void updatePresence(const QString &bareJid, const QString &resource, const QXmppPresence &presence);
+    void removePresence(const QString &bareJid, const QString &resource);
+    void releaseStrings(const ResourcePresence &presence);
+    std::span<const ResourcePresence> resourcePresences(const QString &bareJid) const;
+    const ResourcePresence *resourcePresence(const QString &bareJid, const QString &resource) const;
+
+    // available resources of each bare JID, there are only a few resources per JID
+    QHash<QString, std::vector<ResourcePresence>> presences;
+    InternPool<QString> strings;
+    InternPool<QByteArray> capabilityVers;
+    bool keepFullPresences = true;
 
     // flag to store that the roster has been populated
     bool isRosterReceived;
+
+    // cache of the roster between connections, not owned
+    QXmppRosterStorage *storage = nullptr;
 };
 
 QXmppRosterManagerPrivate::QXmppRosterManagerPrivate()
@@ -112,9 +167,147 @@ void QXmppRosterManagerPrivate::clear()
 {
     entries.clear();
     presences.clear();
+    strings.clear();
+    capabilityVers.clear();
     isRosterReceived = false;
 }
 
+void QXmppRosterManagerPrivate::updatePresence(const QString &bareJid, const QString &resource, const QXmppPresence &presence)
+{
+    auto itr = presences.find(bareJid);
+    if (itr == presences.end()) {
+        // share the key with the roster entry
+        const auto entry = entries.constFind(bareJid);
+        itr = presences.insert(entry != entries.cend() ? entry.key() : bareJid, {});
+    }
+
+    auto &resources = itr.value();
+    auto stored = std::find_if(resources.begin(), resources.end(), [&](const auto &p) {
+        return p.resource == resource;
+    });
+    if (stored == resources.end()) {
+        stored = resources.insert(resources.end(), ResourcePresence { strings.acquire(resource) });
+    } else {
+        releaseStrings(*stored);
+        stored->resource = strings.acquire(resource);
+    }
+
+    stored->availableStatus = presence.availableStatusType();
+    stored->priority = qint8(std::clamp(presence.priority(), -128, 127));
+    stored->statusText = presence.statusText();
+    stored->capabilityHash = strings.acquire(presence.capabilityHash());
+    stored->capabilityNode = strings.acquire(presence.capabilityNode());
+    stored->capabilityVer = capabilityVers.acquire(presence.capabilityVer());
+    if (keepFullPresences) {
+        stored->presence = presence;
+    } else {
+        stored->presence.reset();
+    }
+}
+
+void QXmppRosterManagerPrivate::removePresence(const QString &bareJid, const QString &resource)
+{
+    auto itr = presences.find(bareJid);
+    if (itr == presences.end()) {
+        return;
+    }
+
+    auto &resources = itr.value();
+    auto stored = std::find_if(resources.begin(), resources.end(), [&](const auto &p) {
+        return p.resource == resource;
+    });
+    if (stored != resources.end()) {
+        releaseStrings(*stored);
+        resources.erase(stored);
+    }
+    if (resources.empty()) {
+        presences.erase(itr);
+    }
+}
+
+void QXmppRosterManagerPrivate::releaseStrings(const ResourcePresence &presence)
+{
+    strings.release(presence.resource);
+    strings.release(presence.capabilityHash);
+    strings.release(presence.capabilityNode);
+    capabilityVers.release(presence.capabilityVer);
+}
+
+std::span<const ResourcePresence> QXmppRosterManagerPrivate::resourcePresences(const QString &bareJid) const
+{
+    const auto itr = presences.constFind(bareJid);
+    if (itr == presences.cend()) {
+        return {};
+    }
+    return itr.value();
+}
+
+const ResourcePresence *QXmppRosterManagerPrivate::resourcePresence(const QString &bareJid, const QString &resource) const
+{
+    const auto resources = resourcePresences(bareJid);
+    const auto itr = std::find_if(resources.begin(), resources.end(), [&](const auto &p) {
+        return p.resource == resource;
+    });
+    return itr != resources.end() ? &*itr : nullptr;
+}
+
+///
+/// \struct QXmppRosterManager::ResourcePresence
+///
+/// \brief Presence of an available resource of a contact, as stored by the roster manager.
+///
+/// \since QXmpp 1.13
+///
+
+///
+/// \var QXmppRosterManager::ResourcePresence::resource
+///
+/// Resource of the JID
+///
+
+///
+/// \var QXmppRosterManager::ResourcePresence::availableStatus
+///
+/// Availability of the resource (e.g. away)
+///
+
+///
+/// \var QXmppRosterManager::ResourcePresence::priority
+///
+/// Priority of the resource
+///
+
+///
+/// \var QXmppRosterManager::ResourcePresence::statusText
+///
+/// Status text of the presence
+///
+
+///
+/// \var QXmppRosterManager::ResourcePresence::capabilityHash
+///
+/// Hash algorithm of the \xep{0115, Entity Capabilities}
+///
+
+///
+/// \var QXmppRosterManager::ResourcePresence::capabilityNode
+///
+/// Node of the \xep{0115, Entity Capabilities}
+///
+
+///
+/// \var QXmppRosterManager::ResourcePresence::capabilityVer
+///
+/// Verification string of the \xep{0115, Entity Capabilities}
+///
+
+///
+/// \var QXmppRosterManager::ResourcePresence::presence
+///
+/// The full presence, only set if QXmppRosterManager::keepsFullPresences() was enabled when it
+/// was received.
+///
+
 ///
 /// Constructs a roster manager.
 ///
@@ -168,21 +361,51 @@ void QXmppRosterManager::_q_connected()
     }
 
     if (!d->isRosterReceived && client()->isAuthenticated()) {
-        requestRoster().then(this, [this](auto &&result) {
-            if (auto *rosterIq = std::get_if<QXmppRosterIq>(&result)) {
-                // reset entries
-                d->entries.clear();
-                const auto items = rosterIq->items();
-                for (const auto &item : items) {
-                    d->entries.insert(item.bareJid(), item);
-                }
+        if (d->storage && client()->stream()->rosterVersioningSupported()) {
+            d->storage->load().then(this, [this](QXmppRosterStorage::Roster &&cached) {
+                fetchRoster(std::move(cached));
+            });
+        } else {
+            fetchRoster({});
+        }
+    }
+}
+
+///
+/// Requests the roster, with the version of the \a cached roster if roster versioning is used.
+///
+void QXmppRosterManager::fetchRoster(std::optional<QXmppRosterStorage::Roster> &&cached)
+{
+    // XEP-0237: Roster Versioning: an empty version requests versioning without a cached roster
+    const auto version = cached ? (cached->version.isEmpty() ? u""_s : cached->version) : QString();
 
-                // notify
-                d->isRosterReceived = true;
-                Q_EMIT rosterReceived();
+    requestRoster(version).then(this, [this, cached = std::move(cached)](auto &&result) mutable {
+        auto *rosterIq = std::get_if<QXmppRosterIq>(&result);
+        if (!rosterIq) {
+            return;
+        }
+
+        QList<QXmppRosterIq::Item> items;
+        if (cached && rosterIq->version().isNull() && rosterIq->items().isEmpty()) {
+            // the cached roster is up to date, changes are sent as roster pushes
+            items = std::move(cached->items);
+        } else {
+            items = rosterIq->items();
+            if (d->storage) {
+                d->storage->store({ rosterIq->version(), items });
             }
-        });
-    }
+        }
+
+        // reset entries
+        d->entries.clear();
+        for (const auto &item : std::as_const(items)) {
+            d->entries.insert(item.bareJid(), item);
+        }
+
+        // notify
+        d->isRosterReceived = true;
+        Q_EMIT rosterReceived();
+    });
 }
 
 void QXmppRosterManager::_q_disconnected()
@@ -194,6 +417,13 @@ void QXmppRosterManager::_q_disconnected()
 }
 
 /// \cond
+QList<QXmppClientExtension::StanzaFilter> QXmppRosterManager::stanzaFilters() const
+{
+    return {
+        { u"iq"_s, u"query"_s, ns_roster.toString() },
+    };
+}
+
 bool QXmppRosterManager::handleStanza(const QDomElement &element)
 {
     if (!isIqElement<QXmppRosterIq>(element)) {
@@ -238,6 +468,10 @@ bool QXmppRosterManager::handleStanza(const QDomElement &element)
                 }
             }
         }
+
+        if (d->storage) {
+            d->storage->update(rosterIq.version(), items);
+        }
         break;
     }
     default:
@@ -260,11 +494,11 @@ void QXmppRosterManager::_q_presenceReceived(const QXmppPresence &presence)
 
     switch (presence.type()) {
     case QXmppPresence::Available:
-        d->presences[bareJid][resource] = presence;
+        d->updatePresence(bareJid, resource, presence);
         Q_EMIT presenceChanged(bareJid, resource);
         break;
     case QXmppPresence::Unavailable:
-        d->presences[bareJid].remove(resource);
+        d->removePresence(bareJid, resource);
         Q_EMIT presenceChanged(bareJid, resource);
         break;
     case QXmppPresence::Subscribe: {
@@ -306,11 +540,12 @@ void QXmppRosterManager::handleSubscriptionRequest(const QString &bareJid, const
     }
 }
 
-QXmppTask<QXmppRosterManager::RosterResult> QXmppRosterManager::requestRoster()
+QXmppTask<QXmppRosterManager::RosterResult> QXmppRosterManager::requestRoster(const QString &version)
 {
     QXmppRosterIq iq;
     iq.setType(QXmppIq::Get);
     iq.setFrom(client()->configuration().jid());
+    iq.setVersion(version);
 
     // TODO: Request MIX annotations only when the server supports MIX-PAM.
     iq.setMixAnnotate(true);
@@ -651,10 +886,26 @@ QXmppRosterIq::Item QXmppRosterManager::getRosterEntry(
 ///
 QStringList QXmppRosterManager::getResources(const QString &bareJid) const
 {
-    if (d->presences.contains(bareJid)) {
-        return d->presences[bareJid].keys();
+    const auto resources = d->resourcePresences(bareJid);
+    return transform<QStringList>(resources, [](const auto &p) { return p.resource; });
+}
+
+// Creates a presence from the stored fields if the full presence has not been kept.
+static QXmppPresence toPresence(const QString &bareJid, const ResourcePresence &stored)
+{
+    if (stored.presence) {
+        return *stored.presence;
     }
-    return {};
+
+    QXmppPresence presence;
+    presence.setFrom(stored.resource.isEmpty() ? bareJid : bareJid + u'/' + stored.resource);
+    presence.setAvailableStatusType(stored.availableStatus);
+    presence.setPriority(stored.priority);
+    presence.setStatusText(stored.statusText);
+    presence.setCapabilityHash(stored.capabilityHash);
+    presence.setCapabilityNode(stored.capabilityNode);
+    presence.setCapabilityVer(stored.capabilityVer);
+    return presence;
 }
 
 ///
@@ -668,15 +919,19 @@ QStringList QXmppRosterManager::getResources(const QString &bareJid) const
 QMap<QString, QXmppPresence> QXmppRosterManager::getAllPresencesForBareJid(
     const QString &bareJid) const
 {
-    if (d->presences.contains(bareJid)) {
-        return d->presences.value(bareJid);
+    QMap<QString, QXmppPresence> presences;
+    for (const auto &stored : d->resourcePresences(bareJid)) {
+        presences.insert(stored.resource, toPresence(bareJid, stored));
     }
-    return {};
+    return presences;
 }
 
 ///
 /// Get the presence of the given resource of the given bareJid.
 ///
+/// If setKeepFullPresences() is disabled, the presence only contains the fields of
+/// ResourcePresence.
+///
 /// \param bareJid as a QString
 /// \param resource as a QString
 /// \return QXmppPresence
@@ -684,8 +939,8 @@ QMap<QString, QXmppPresence> QXmppRosterManager::getAllPresencesForBareJid(
 QXmppPresence QXmppRosterManager::getPresence(const QString &bareJid,
                                               const QString &resource) const
 {
-    if (d->presences.contains(bareJid) && d->presences[bareJid].contains(resource)) {
-        return d->presences[bareJid][resource];
+    if (const auto *stored = d->resourcePresence(bareJid, resource)) {
+        return toPresence(bareJid, *stored);
     }
 
     QXmppPresence presence;
@@ -693,6 +948,81 @@ QXmppPresence QXmppRosterManager::getPresence(const QString &bareJid,
     return presence;
 }
 
+///
+/// Returns the presences of all available resources of \a bareJid.
+///
+/// \since QXmpp 1.13
+///
+QList<QXmppRosterManager::ResourcePresence> QXmppRosterManager::presences(const QString &bareJid) const
+{
+    const auto resources = d->resourcePresences(bareJid);
+    return QList<ResourcePresence>(resources.begin(), resources.end());
+}
+
+///
+/// Returns the presence of \a resource of \a bareJid, or nothing if the resource is not
+/// available.
+///
+/// \since QXmpp 1.13
+///
+std::optional<QXmppRosterManager::ResourcePresence> QXmppRosterManager::presence(const QString &bareJid, const QString &resource) const
+{
+    if (const auto *stored = d->resourcePresence(bareJid, resource)) {
+        return *stored;
+    }
+    return {};
+}
+
+///
+/// Returns whether the full QXmppPresence is kept for each available resource in addition to
+/// the fields of ResourcePresence.
+///
+/// \since QXmpp 1.13
+///
+bool QXmppRosterManager::keepsFullPresences() const
+{
+    return d->keepFullPresences;
+}
+
+///
+/// Sets whether the full QXmppPresence is kept for each available resource in addition to the
+/// fields of ResourcePresence. The default is true.
+///
+/// Disabling this saves memory with large rosters, but getPresence() and
+/// getAllPresencesForBareJid() only return the fields of ResourcePresence then. Presences that
+/// have already been received are not changed.
+///
+/// \since QXmpp 1.13
+///
+void QXmppRosterManager::setKeepFullPresences(bool keep)
+{
+    d->keepFullPresences = keep;
+}
+
+///
+/// Returns the storage that caches the roster between connections, nullptr by default.
+///
+/// \since QXmpp 1.13
+///
+QXmppRosterStorage *QXmppRosterManager::storage() const
+{
+    return d->storage;
+}
+
+///
+/// Sets the storage that caches the roster between connections.
+///
+/// The storage is not owned by the manager and must outlive it. It is used for
+/// \xep{0237, Roster Versioning} if the server supports it, see
+/// \ref rostermanager_versioning "above".
+///
+/// \since QXmpp 1.13
+///
+void QXmppRosterManager::setStorage(QXmppRosterStorage *storage)
+{
+    d->storage = storage;
+}
+
 ///
 /// Function to check whether the roster has been received or not.
 ///
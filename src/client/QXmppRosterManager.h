@@ -11,8 +11,10 @@
 #include "QXmppClientExtension.h"
 #include "QXmppPresence.h"
 #include "QXmppRosterIq.h"
+#include "QXmppRosterStorage.h"
 #include "QXmppSendResult.h"
 
+#include <optional>
 #include <variant>
 
 #include <QMap>
@@ -78,6 +80,30 @@ class QXmppRosterManagerPrivate;
 /// are verified and automatically accepted without emitting subscriptionRequestReceived(). If
 /// verification fails, the **invalid** old JID is passed in subscriptionRequestReceived()!
 ///
+/// \anchor rostermanager_versioning
+/// ## XEP-0237: Roster Versioning
+///
+/// With a QXmppRosterStorage set via setStorage(), the roster is cached between connections. If the
+/// server supports \xep{0237, Roster Versioning}, the version of the cached roster is sent with the
+/// roster request and the server only sends the changes since that version as roster pushes or
+/// an empty result if nothing changed. The cached roster is kept up to date with the roster pushes.
+///
+/// \code
+/// auto *storage = new QXmppRosterFileStorage(u"roster.xml"_s);
+/// client->findExtension<QXmppRosterManager>()->setStorage(storage);
+/// \endcode
+///
+/// \anchor rostermanager_presences
+/// ## Presences of large rosters
+///
+/// For each available resource, the manager keeps the fields of the presence that most
+/// applications need as a ResourcePresence. Resources and entity capabilities are shared between
+/// contacts. By default the full QXmppPresence is kept as well. Clients with many contacts that
+/// do not need the extensions of the presences can save memory with setKeepFullPresences().
+///
+/// presences() and presence() return the stored presences. Their strings and the full presences
+/// are implicitly shared, so copying them is cheap.
+///
 /// \ingroup Managers
 ///
 class QXMPP_EXPORT QXmppRosterManager : public QXmppClientExtension
@@ -88,6 +114,17 @@ public:
     /// Empty result containing QXmpp::Success or a QXmppError
     using Result = std::variant<QXmpp::Success, QXmppError>;
 
+    struct QXMPP_EXPORT ResourcePresence {
+        QString resource;
+        QXmppPresence::AvailableStatusType availableStatus = QXmppPresence::Online;
+        qint8 priority = 0;
+        QString statusText;
+        QString capabilityHash;
+        QString capabilityNode;
+        QByteArray capabilityVer;
+        std::optional<QXmppPresence> presence;
+    };
+
     explicit QXmppRosterManager(QXmppClient *stream);
     ~QXmppRosterManager() override;
 
@@ -100,6 +137,14 @@ public:
         const QString &bareJid) const;
     QXmppPresence getPresence(const QString &bareJid,
                               const QString &resource) const;
+    QList<ResourcePresence> presences(const QString &bareJid) const;
+    std::optional<ResourcePresence> presence(const QString &bareJid, const QString &resource) const;
+
+    bool keepsFullPresences() const;
+    void setKeepFullPresences(bool keep);
+
+    QXmppRosterStorage *storage() const;
+    void setStorage(QXmppRosterStorage *storage);
 
     QXmppTask<Result> addRosterItem(const QString &bareJid, const QString &name = {}, const QSet<QString> &groups = {});
     QXmppTask<Result> removeRosterItem(const QString &bareJid);
@@ -108,6 +153,7 @@ public:
     QXmppTask<QXmpp::SendResult> unsubscribeFrom(const QString &bareJid, const QString &reason = {});
 
     /// \cond
+    QList<StanzaFilter> stanzaFilters() const override;
     bool handleStanza(const QDomElement &element) override;
     /// \endcond
 
@@ -175,7 +221,8 @@ private:
     using RosterResult = std::variant<QXmppRosterIq, QXmppError>;
 
     void handleSubscriptionRequest(const QString &bareJid, const QXmppPresence &presence);
-    QXmppTask<RosterResult> requestRoster();
+    void fetchRoster(std::optional<QXmppRosterStorage::Roster> &&cached);
+    QXmppTask<RosterResult> requestRoster(const QString &version = {});
 
     const std::unique_ptr<QXmppRosterManagerPrivate> d;
 
@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "QXmppRosterMemoryStorage.h"
+
+#include "Async.h"
+
+#include <QMap>
+
+using namespace QXmpp::Private;
+
+///
+/// \class QXmppRosterMemoryStorage
+///
+/// \brief The QXmppRosterMemoryStorage class caches the roster in the memory.
+///
+/// The roster is kept as long as the storage exists, so only reconnects of the same process
+/// benefit from it.
+///
+/// \since QXmpp 1.13
+///
+
+class QXmppRosterMemoryStoragePrivate
+{
+public:
+    QString version;
+    // bare JIDs mapped to items
+    QMap<QString, QXmppRosterIq::Item> items;
+};
+
+///
+/// Constructs a roster memory storage.
+///
+QXmppRosterMemoryStorage::QXmppRosterMemoryStorage()
+    : d(std::make_unique<QXmppRosterMemoryStoragePrivate>())
+{
+}
+
+QXmppRosterMemoryStorage::~QXmppRosterMemoryStorage() = default;
+
+/// \cond
+QXmppTask<QXmppRosterStorage::Roster> QXmppRosterMemoryStorage::load()
+{
+    return makeReadyTask(Roster { d->version, d->items.values() });
+}
+
+QXmppTask<void> QXmppRosterMemoryStorage::store(const Roster &roster)
+{
+    d->version = roster.version;
+    d->items.clear();
+    for (const auto &item : roster.items) {
+        d->items.insert(item.bareJid(), item);
+    }
+    return makeReadyTask();
+}
+
+QXmppTask<void> QXmppRosterMemoryStorage::update(const QString &version, const QList<QXmppRosterIq::Item> &items)
+{
+    d->version = version;
+    for (const auto &item : items) {
+        if (item.subscriptionType() == QXmppRosterIq::Item::Remove) {
+            d->items.remove(item.bareJid());
+        } else {
+            d->items.insert(item.bareJid(), item);
+        }
+    }
+    return makeReadyTask();
+}
+
+QXmppTask<void> QXmppRosterMemoryStorage::clear()
+{
+    d->version.clear();
+    d->items.clear();
+    return makeReadyTask();
+}
+/// \endcond
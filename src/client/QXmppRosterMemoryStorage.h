@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef QXMPPROSTERMEMORYSTORAGE_H
+#define QXMPPROSTERMEMORYSTORAGE_H
+
+#include "QXmppRosterStorage.h"
+
+#include <memory>
+
+class QXmppRosterMemoryStoragePrivate;
+
+class QXMPP_EXPORT QXmppRosterMemoryStorage : public QXmppRosterStorage
+{
+public:
+    QXmppRosterMemoryStorage();
+    ~QXmppRosterMemoryStorage() override;
+
+    /// \cond
+    QXmppTask<Roster> load() override;
+    QXmppTask<void> store(const Roster &roster) override;
+    QXmppTask<void> update(const QString &version, const QList<QXmppRosterIq::Item> &items) override;
+    QXmppTask<void> clear() override;
+    /// \endcond
+
+private:
+    const std::unique_ptr<QXmppRosterMemoryStoragePrivate> d;
+};
+
+#endif  // QXMPPROSTERMEMORYSTORAGE_H
@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+///
+/// \class QXmppRosterStorage
+///
+/// \brief The QXmppRosterStorage class caches the roster of an account between connections.
+///
+/// It is used by the QXmppRosterManager for \xep{0237, Roster Versioning}: the version of the
+/// cached roster is sent to the server on login and the server only sends the changes since then.
+///
+/// A storage holds the roster of one account only.
+///
+/// \sa QXmppRosterManager::setStorage()
+///
+/// \since QXmpp 1.13
+///
+
+///
+/// \fn QXmppRosterStorage::load()
+///
+/// Returns the cached roster, its version is empty if no roster has been stored.
+///
+
+///
+/// \fn QXmppRosterStorage::store(const Roster &roster)
+///
+/// Replaces the cached roster.
+///
+/// \param roster the complete roster as received from the server
+///
+
+///
+/// \fn QXmppRosterStorage::update(const QString &version, const QList<QXmppRosterIq::Item> &items)
+///
+/// Applies a roster push to the cached roster.
+///
+/// Items with the subscription type QXmppRosterIq::Item::Remove are removed, all other items are
+/// added or replace the item with the same bare JID.
+///
+/// \param version new version of the roster
+/// \param items changed items
+///
+
+///
+/// \fn QXmppRosterStorage::clear()
+///
+/// Removes the cached roster.
+///
@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef QXMPPROSTERSTORAGE_H
+#define QXMPPROSTERSTORAGE_H
+
+#include "QXmppRosterIq.h"
+
+template<typename T>
+class QXmppTask;
+
+class QXMPP_EXPORT QXmppRosterStorage
+{
+public:
+    /// Cached roster of an account
+    struct Roster {
+        /// \xep{0237, Roster Versioning} version of the roster, empty if it is unknown
+        QString version;
+        /// Items of the roster
+        QList<QXmppRosterIq::Item> items;
+    };
+
+    virtual ~QXmppRosterStorage() = default;
+
+    virtual QXmppTask<Roster> load() = 0;
+    virtual QXmppTask<void> store(const Roster &roster) = 0;
+    virtual QXmppTask<void> update(const QString &version, const QList<QXmppRosterIq::Item> &items) = 0;
+    virtual QXmppTask<void> clear() = 0;
+};
+
+#endif  // QXMPPROSTERSTORAGE_H
@@ -21,6 +21,7 @@ class QXmppSendStanzaParamsPrivate : public QSharedData
 public:
     TrustLevels acceptedTrustLevels;
     QVector<QString> encryptionJids;
+    std::optional<std::chrono::milliseconds> iqTimeout;
 };
 
 QXmppSendStanzaParams::QXmppSendStanzaParams()
@@ -86,3 +87,29 @@ void QXmppSendStanzaParams::setAcceptedTrustLevels(std::optional<TrustLevels> tr
 {
     d->acceptedTrustLevels = trustLevels.value_or(QXmpp::TrustLevels());
 }
+
+///
+/// Returns the time to wait for the response to an IQ request.
+///
+/// If no timeout is set, QXmppConfiguration::iqTimeout() is used.
+///
+/// \since QXmpp 1.13
+///
+std::optional<std::chrono::milliseconds> QXmppSendStanzaParams::iqTimeout() const
+{
+    return d->iqTimeout;
+}
+
+///
+/// Sets the time to wait for the response to an IQ request.
+///
+/// When no response has been received in time, the request finishes with a QXmppError
+/// containing QXmpp::TimeoutError. A timeout of zero means no timeout. If no timeout is set,
+/// QXmppConfiguration::iqTimeout() is used.
+///
+/// \since QXmpp 1.13
+///
+void QXmppSendStanzaParams::setIqTimeout(std::optional<std::chrono::milliseconds> timeout)
+{
+    d->iqTimeout = timeout;
+}
@@ -146,6 +146,13 @@ QStringList QXmppVCardManager::discoveryFeatures() const
     };
 }
 
+QList<QXmppClientExtension::StanzaFilter> QXmppVCardManager::stanzaFilters() const
+{
+    return {
+        { u"iq"_s, u"vCard"_s, ns_vcard.toString() },
+    };
+}
+
 bool QXmppVCardManager::handleStanza(const QDomElement &element)
 {
     if (isIqElement<QXmppVCardIq>(element)) {
@@ -113,6 +113,13 @@ QStringList QXmppVersionManager::discoveryFeatures() const
     };
 }
 
+QList<QXmppClientExtension::StanzaFilter> QXmppVersionManager::stanzaFilters() const
+{
+    return {
+        { u"iq"_s, u"query"_s, ns_version.toString() },
+    };
+}
+
 bool QXmppVersionManager::handleStanza(const QDomElement &element)
 {
     if (QXmpp::handleIqRequests<QXmppVersionIq>(element, client(), this)) {
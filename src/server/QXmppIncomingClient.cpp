@@ -6,19 +6,24 @@
 
 #include "QXmppBindIq.h"
 #include "QXmppConstants_p.h"
+#include "QXmppIncomingClient_p.h"
+#include "QXmppMetrics_p.h"
 #include "QXmppPasswordChecker.h"
 #include "QXmppSasl_p.h"
 #include "QXmppStreamFeatures.h"
+#include "QXmppStreamManagement_p.h"
 #include "QXmppUtils.h"
 #include "QXmppUtils_p.h"
 
 #include "Iq.h"
 #include "Stream.h"
 #include "StringLiterals.h"
+#include "TimerWheel.h"
 #include "XmppSocket.h"
 
 #include <QDomElement>
 #include <QHostAddress>
+#include <QPointer>
 #include <QSslKey>
 #include <QSslSocket>
 #include <QTimer>
@@ -28,12 +33,29 @@ using namespace QXmpp::Private;
 
 constexpr uint RESOURCE_RANDOM_SUFFIX_LENGTH = 8;
 constexpr std::tuple SessionIqXmlTag = { u"session", ns_session };
+// number of stanzas sent before an ack is requested
+constexpr int SM_ACK_REQUEST_THRESHOLD = 5;
+
+class QXmppIncomingClientPrivate;
+
+// Entry of a client in a shared timer wheel. The entry is only rescheduled when it expires, so
+// activity on the stream only updates lastActivity.
+struct IdleTimeout : TimerWheelEntry {
+    QXmppIncomingClientPrivate *d = nullptr;
+    std::chrono::milliseconds timeout {};
+    // coarse time of the wheel
+    qint64 lastActivity = 0;
+};
 
 class QXmppIncomingClientPrivate
 {
 public:
     QXmppIncomingClientPrivate(QSslSocket *socket, QXmppIncomingClient *qq);
 
+    // inactivity and resumption timeout, either in a timer wheel shared with other streams or
+    // in an own timer
+    TimerWheel *idleTimerWheel = nullptr;
+    IdleTimeout idleTimeout;
     QTimer *idleTimer = nullptr;
     XmppSocket socket;
 
@@ -47,20 +69,124 @@ public:
         Sasl2
     } saslVersion = Sasl;
     std::optional<Sasl2::Authenticate> sasl2AuthRequest;
+    // started when the client starts to authenticate
+    QElapsedTimer authTimer;
+
+    // stream management
+    StreamManagementSession sm;
+    bool smEnabled = false;
+    qsizetype smQueueLimit = 256 * 1024;
+    int resumptionTimeout = 0;
+    int unrequestedStanzas = 0;
+    // the connection is lost, the session waits for resumption
+    bool detached = false;
+    // a resumption has been requested, stanzas are buffered until it is done
+    bool resuming = false;
+    quint32 resumeAcknowledged = 0;
+    QList<QByteArray> resumeBuffer;
+    // stream that took over the session, stanzas are forwarded to it
+    QPointer<QXmppIncomingClient> successor;
 
     void checkCredentials(const QByteArray &response);
+    void observeAuthTime();
     QString origin() const;
 
+    void startIdleTimer(std::chrono::milliseconds timeout);
+    void restartIdleTimer();
+    void stopIdleTimer();
+    void onIdleTimeoutExpired();
+
+    bool isResumable() const { return smEnabled && !sm.id.isEmpty() && resumptionTimeout > 0; }
+    void handleStreamManagement(const QDomElement &element);
+    bool sendStanzaData(const QByteArray &data);
+    void acknowledge(quint32 sequenceNumber);
+    void requestAcknowledgement();
+    void detach();
+
 private:
     QXmppIncomingClient *q;
 };
 
+// Adds an attribute to the start tag of the serialized element.
+static void insertAttribute(QByteArray &data, const QString &tagName, QStringView name, const QString &value)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+    // the data starts with '<' and the tag name
+    data.insert(tagName.size() + 1, u" %1=\"%2\""_s.arg(name, value.toHtmlEscaped()).toUtf8());
+}
+
 QXmppIncomingClientPrivate::QXmppIncomingClientPrivate(QSslSocket *socket, QXmppIncomingClient *qq)
     : socket(socket, qq),
       q(qq)
 {
+    idleTimeout.d = this;
+}
+
+// Starts the inactivity timer with a new timeout, 0 stops it.
+void QXmppIncomingClientPrivate::startIdleTimer(std::chrono::milliseconds timeout)
+{
+    stopIdleTimer();
+    idleTimeout.timeout = std::max(timeout, std::chrono::milliseconds::zero());
+    if (timeout <= std::chrono::milliseconds::zero()) {
+        return;
+    }
+
+    if (idleTimerWheel) {
+        idleTimerWheel->schedule(idleTimeout, idleTimeout.timeout);
+        idleTimeout.lastActivity = idleTimerWheel->coarseTime();
+    } else {
+        if (!idleTimer) {
+            idleTimer = new QTimer(q);
+            idleTimer->setSingleShot(true);
+            QObject::connect(idleTimer, &QTimer::timeout, q, &QXmppIncomingClient::onTimeout);
+        }
+        idleTimer->start(idleTimeout.timeout);
+    }
+}
+
+// Restarts the inactivity timer after activity on the stream.
+void QXmppIncomingClientPrivate::restartIdleTimer()
+{
+    if (idleTimerWheel) {
+        idleTimeout.lastActivity = idleTimerWheel->coarseTime();
+    } else if (idleTimer && idleTimer->interval()) {
+        idleTimer->start();
+    }
+}
+
+void QXmppIncomingClientPrivate::stopIdleTimer()
+{
+    idleTimeout.cancel();
+    if (idleTimer) {
+        idleTimer->stop();
+    }
 }
 
+void QXmppIncomingClientPrivate::onIdleTimeoutExpired()
+{
+    // reschedule for the rest of the timeout if there was activity in the meantime
+    const auto remaining = idleTimeout.lastActivity + idleTimeout.timeout.count() - idleTimerWheel->coarseTime();
+    if (remaining > 0) {
+        idleTimerWheel->schedule(idleTimeout, std::chrono::milliseconds(remaining));
+        return;
+    }
+    q->onTimeout();
+}
+
+namespace QXmpp::Private {
+
+// The wheel needs to live in the thread of its clients.
+std::unique_ptr<TimerWheel> createIdleTimerWheel(std::chrono::milliseconds resolution)
+{
+    return std::make_unique<TimerWheel>(resolution, 512, [](TimerWheelEntry &entry) {
+        static_cast<IdleTimeout &>(entry).d->onIdleTimeoutExpired();
+    });
+}
+
+}  // namespace QXmpp::Private
+
 void QXmppIncomingClientPrivate::checkCredentials(const QByteArray &response)
 {
     QXmppPasswordRequest request;
@@ -81,6 +207,135 @@ void QXmppIncomingClientPrivate::checkCredentials(const QByteArray &response)
         reply->setProperty("__sasl_raw", response);
         QObject::connect(reply, &QXmppPasswordReply::finished,
                          q, &QXmppIncomingClient::onDigestReply);
+    } else if (auto *scramServer = qobject_cast<QXmppSaslServerScram *>(saslServer.get())) {
+        // the stored keys are handled like the digest
+        QXmppScramCredentialsReply *reply = passwordChecker->getScramCredentials(request, scramServer->scramMechanism().qtAlgorithm());
+        reply->setParent(q);
+        reply->setProperty("__sasl_raw", response);
+        QObject::connect(reply, &QXmppPasswordReply::finished,
+                         q, &QXmppIncomingClient::onDigestReply);
+    }
+}
+
+void QXmppIncomingClientPrivate::handleStreamManagement(const QDomElement &element)
+{
+    if (auto enable = SmEnable::fromDom(element)) {
+        // stream management can only be enabled once a resource is bound
+        if (jid.isEmpty() || resource.isEmpty() || smEnabled) {
+            socket.sendData(serializeXml(SmFailed { QXmppStanza::Error::UnexpectedRequest }));
+            return;
+        }
+        smEnabled = true;
+        sm.inboundCount = 0;
+        sm.outboundCount = 0;
+
+        SmEnabled enabled;
+        if (enable->resume && resumptionTimeout > 0) {
+            sm.id = QXmppUtils::generateStanzaHash(32);
+            enabled.resume = true;
+            enabled.id = sm.id;
+            enabled.max = resumptionTimeout;
+        }
+        socket.sendData(serializeXml(enabled));
+    } else if (auto resume = SmResume::fromDom(element)) {
+        // sessions can only be resumed after authentication, instead of binding a resource
+        if (jid.isEmpty() || !resource.isEmpty() || smEnabled || resuming) {
+            socket.sendData(serializeXml(SmFailed { QXmppStanza::Error::UnexpectedRequest }));
+            return;
+        }
+        if (resumptionTimeout <= 0) {
+            socket.sendData(serializeXml(SmFailed { QXmppStanza::Error::ItemNotFound }));
+            return;
+        }
+        resuming = true;
+        resumeAcknowledged = resume->h;
+        Q_EMIT q->sessionResumeRequested(resume->previd);
+    } else if (SmRequest::fromDom(element)) {
+        if (smEnabled) {
+            socket.sendData(serializeXml(SmAck { sm.inboundCount }));
+        }
+    } else if (auto ack = SmAck::fromDom(element)) {
+        if (smEnabled) {
+            acknowledge(ack->seqNo);
+        }
+    }
+}
+
+// Sends a stanza and keeps it until the client has acknowledged it.
+bool QXmppIncomingClientPrivate::sendStanzaData(const QByteArray &data)
+{
+    const auto previousBytes = sm.unacknowledgedBytes;
+    sm.unacknowledged.push_back(QByteArray(data));
+    sm.unacknowledgedBytes += data.size();
+    sm.outboundCount++;
+
+    if (sm.unacknowledgedBytes > smQueueLimit) {
+        q->warning(u"Stream management queue limit reached for '%1' from %2"_s.arg(jid, origin()));
+        Q_EMIT q->updateCounter(u"incoming-client.sm.queue-limit-reached"_s);
+        if (detached) {
+            // drop the session
+            detached = false;
+            stopIdleTimer();
+            Q_EMIT q->disconnected();
+        } else {
+            socket.sendData(QByteArrayLiteral("<stream:error><resource-constraint xmlns='urn:ietf:params:xml:ns:xmpp-streams'/></stream:error>"));
+            q->disconnectFromHost();
+        }
+        return false;
+    }
+
+    // the stanza is sent when the session is resumed
+    if (detached) {
+        return true;
+    }
+
+    const auto written = socket.sendData(data);
+    const auto halfLimit = smQueueLimit / 2;
+    if (++unrequestedStanzas >= SM_ACK_REQUEST_THRESHOLD ||
+        (previousBytes < halfLimit && sm.unacknowledgedBytes >= halfLimit)) {
+        requestAcknowledgement();
+    }
+    return written;
+}
+
+void QXmppIncomingClientPrivate::acknowledge(quint32 sequenceNumber)
+{
+    // sequence numbers wrap around at 2^32
+    const auto firstSequenceNumber = sm.outboundCount - quint32(sm.unacknowledged.size()) + 1;
+    const auto acknowledged = qint32(sequenceNumber - firstSequenceNumber + 1);
+
+    for (qint32 i = 0; i < acknowledged && !sm.unacknowledged.empty(); i++) {
+        sm.unacknowledgedBytes -= sm.unacknowledged.front().size();
+        sm.unacknowledged.pop_front();
+    }
+}
+
+void QXmppIncomingClientPrivate::requestAcknowledgement()
+{
+    unrequestedStanzas = 0;
+    socket.sendData(serializeXml(SmRequest {}));
+}
+
+// Keeps the session after the connection has been lost, so it can be resumed.
+void QXmppIncomingClientPrivate::detach()
+{
+    if (detached) {
+        return;
+    }
+    detached = true;
+    unrequestedStanzas = 0;
+
+    // the inactivity timer is reused for the resumption timeout
+    startIdleTimer(std::chrono::seconds(resumptionTimeout));
+
+    q->info(u"Session of '%1' detached, it can be resumed within %2 seconds"_s.arg(jid, QString::number(resumptionTimeout)));
+    Q_EMIT q->sessionDetached(sm.id, sm.unacknowledgedBytes);
+}
+
+void QXmppIncomingClientPrivate::observeAuthTime()
+{
+    if (const auto *metrics = socket.metrics()) {
+        observeElapsed(metrics->authTime, authTimer);
     }
 }
 
@@ -110,16 +365,12 @@ QXmppIncomingClient::QXmppIncomingClient(QSslSocket *socket, const QString &doma
     connect(&d->socket, &XmppSocket::streamReceived, this, &QXmppIncomingClient::handleStream);
     connect(&d->socket, &XmppSocket::streamClosed, this, &QXmppIncomingClient::disconnectFromHost);
     connect(&d->socket, &XmppSocket::disconnected, this, &QXmppIncomingClient::onSocketDisconnected);
+    // allows the server to route stanzas without serializing them again
+    d->socket.setStanzaDataCaptureEnabled(true);
 
     d->domain = domain;
 
     info(u"Incoming client connection from %1"_s.arg(d->origin()));
-
-    // create inactivity timer
-    d->idleTimer = new QTimer(this);
-    d->idleTimer->setSingleShot(true);
-    connect(d->idleTimer, &QTimer::timeout,
-            this, &QXmppIncomingClient::onTimeout);
 }
 
 QXmppIncomingClient::~QXmppIncomingClient() = default;
@@ -145,18 +396,40 @@ QString QXmppIncomingClient::jid() const
 /// Sends an XMPP packet to the peer.
 bool QXmppIncomingClient::sendPacket(const QXmppNonza &packet)
 {
-    return d->socket.sendData(serializeXml(packet));
+    return sendData(serializeXml(packet));
 }
 
 /// Sends raw data to the peer.
 bool QXmppIncomingClient::sendData(const QByteArray &data)
 {
+    if (d->successor) {
+        // the session has been resumed by another stream
+        QMetaObject::invokeMethod(d->successor, [successor = d->successor, data] {
+            successor->sendData(data);
+        }, Qt::QueuedConnection);
+        return true;
+    }
+    if ((d->smEnabled || d->resuming) && isStanzaData(data)) {
+        if (d->resuming) {
+            d->resumeBuffer.append(data);
+            return true;
+        }
+        return d->sendStanzaData(data);
+    }
     return d->socket.sendData(data);
 }
 
 /// Disconnects from the remote host.
 void QXmppIncomingClient::disconnectFromHost()
 {
+    // the session ends and can not be resumed
+    d->sm.id.clear();
+    if (d->detached) {
+        d->detached = false;
+        d->stopIdleTimer();
+        Q_EMIT disconnected();
+        return;
+    }
     d->socket.disconnectFromHost();
 }
 
@@ -164,11 +437,15 @@ void QXmppIncomingClient::disconnectFromHost()
 /// for inactivity.
 void QXmppIncomingClient::setInactivityTimeout(int secs)
 {
-    d->idleTimer->stop();
-    d->idleTimer->setInterval(secs * 1000);
-    if (d->idleTimer->interval()) {
-        d->idleTimer->start();
-    }
+    d->startIdleTimer(std::chrono::seconds(secs));
+}
+
+///
+/// Sets the inactivity timeout with a precision below one second.
+///
+void QXmppIncomingClient::setInactivityTimeout(std::chrono::milliseconds timeout)
+{
+    d->startIdleTimer(timeout);
 }
 
 ///
@@ -181,6 +458,43 @@ void QXmppIncomingClient::setPasswordChecker(QXmppPasswordChecker *checker)
     d->passwordChecker = checker;
 }
 
+/// \cond
+///
+/// Sets the maximum size of the stanzas that have not been acknowledged by the client. The
+/// stream is closed (or a detached session is dropped) when the limit is exceeded.
+///
+void QXmppIncomingClient::setStreamManagementQueueLimit(qsizetype bytes)
+{
+    d->smQueueLimit = bytes;
+}
+
+///
+/// Sets the number of seconds a session is kept for resumption after the connection has been
+/// lost. 0 disables resumption.
+///
+void QXmppIncomingClient::setStreamResumptionTimeout(int secs)
+{
+    d->resumptionTimeout = secs;
+}
+
+///
+/// Sets a timer wheel that is used for the inactivity timeout instead of an own timer.
+///
+/// The wheel must live in the thread of the stream and outlive it. This needs to be called before
+/// setInactivityTimeout().
+///
+void QXmppIncomingClient::setIdleTimerWheel(TimerWheel *wheel)
+{
+    d->stopIdleTimer();
+    d->idleTimerWheel = wheel;
+}
+
+void QXmppIncomingClient::setMetrics(std::shared_ptr<StreamMetrics> metrics)
+{
+    d->socket.setMetrics(std::move(metrics));
+}
+/// \endcond
+
 /// \cond
 void QXmppIncomingClient::handleStart()
 {
@@ -188,9 +502,7 @@ void QXmppIncomingClient::handleStart()
 
 void QXmppIncomingClient::handleStream(const StreamOpen &stream)
 {
-    if (d->idleTimer->interval()) {
-        d->idleTimer->start();
-    }
+    d->restartIdleTimer();
     d->saslServer.reset();
 
     // start stream
@@ -232,8 +544,19 @@ void QXmppIncomingClient::sendStreamFeatures()
             features.setBindMode(QXmppStreamFeatures::Required);
         }
         features.setSessionMode(QXmppStreamFeatures::Enabled);
+        if (!d->smEnabled) {
+            features.setStreamManagementMode(QXmppStreamFeatures::Enabled);
+        }
     } else if (d->passwordChecker) {
         QStringList mechanisms;
+        // strongest SCRAM mechanism first
+        const auto scramAlgorithms = d->passwordChecker->scramAlgorithms();
+        for (auto algorithm : { SaslScramMechanism::Sha512, SaslScramMechanism::Sha256, SaslScramMechanism::Sha1 }) {
+            const SaslScramMechanism scram { algorithm };
+            if (scramAlgorithms.contains(scram.qtAlgorithm())) {
+                mechanisms << scram.toString();
+            }
+        }
         mechanisms << u"PLAIN"_s;
         if (d->passwordChecker->hasGetPassword()) {
             mechanisms << u"DIGEST-MD5"_s;
@@ -253,13 +576,11 @@ void QXmppIncomingClient::handleStanza(const QDomElement &nodeRecv)
 {
     const QString ns = nodeRecv.namespaceURI();
 
-    if (d->idleTimer->interval()) {
-        d->idleTimer->start();
-    }
+    d->restartIdleTimer();
 
     if (StarttlsRequest::fromDom(nodeRecv)) {
         sendData(serializeXml(StarttlsProceed()));
-        d->socket.internalSocket()->flush();
+        d->socket.flush();
         d->socket.internalSocket()->startServerEncryption();
         return;
     } else if (ns == ns_sasl_2) {
@@ -271,6 +592,7 @@ void QXmppIncomingClient::handleStanza(const QDomElement &nodeRecv)
         }
 
         if (auto auth = Sasl2::Authenticate::fromDom(nodeRecv)) {
+            d->authTimer.start();
             d->saslVersion = QXmppIncomingClientPrivate::Sasl2;
             d->sasl2AuthRequest = std::move(auth);
             d->saslServer = QXmppSaslServer::create(d->sasl2AuthRequest->mechanism, this);
@@ -309,11 +631,14 @@ void QXmppIncomingClient::handleStanza(const QDomElement &nodeRecv)
             if (result == QXmppSaslServer::InputNeeded) {
                 // check credentials
                 d->checkCredentials(response->data);
+            } else if (result == QXmppSaslServer::Challenge) {
+                sendData(serializeXml(Sasl2::Challenge { challenge }));
             } else if (result == QXmppSaslServer::Succeeded) {
                 // authentication succeeded
                 d->jid = u"%1@%2"_s.arg(d->saslServer->username(), d->domain);
                 info(u"Authentication succeeded for '%1' from %2"_s.arg(d->jid, d->origin()));
                 Q_EMIT updateCounter(u"incoming-client.auth.success"_s);
+                d->observeAuthTime();
                 onSasl2Authenticated();
             } else {
                 d->sasl2AuthRequest.reset();
@@ -333,6 +658,7 @@ void QXmppIncomingClient::handleStanza(const QDomElement &nodeRecv)
         }
 
         if (auto auth = Sasl::Auth::fromDom(nodeRecv)) {
+            d->authTimer.start();
             d->saslVersion = QXmppIncomingClientPrivate::Sasl;
             d->sasl2AuthRequest.reset();
             d->saslServer = QXmppSaslServer::create(auth->mechanism, this);
@@ -371,11 +697,14 @@ void QXmppIncomingClient::handleStanza(const QDomElement &nodeRecv)
             if (result == QXmppSaslServer::InputNeeded) {
                 // check credentials
                 d->checkCredentials(response->value);
+            } else if (result == QXmppSaslServer::Challenge) {
+                sendData(serializeXml(Sasl::Challenge { challenge }));
             } else if (result == QXmppSaslServer::Succeeded) {
                 // authentication succeeded
                 d->jid = u"%1@%2"_s.arg(d->saslServer->username(), d->domain);
                 info(u"Authentication succeeded for '%1' from %2"_s.arg(d->jid, d->origin()));
                 Q_EMIT updateCounter(u"incoming-client.auth.success"_s);
+                d->observeAuthTime();
                 sendData(serializeXml(Sasl::Success()));
                 handleStart();
             } else {
@@ -384,7 +713,16 @@ void QXmppIncomingClient::handleStanza(const QDomElement &nodeRecv)
                 disconnectFromHost();
             }
         }
+    } else if (ns == ns_stream_management) {
+        d->handleStreamManagement(nodeRecv);
     } else if (ns == ns_client) {
+        if (d->smEnabled) {
+            const auto tagName = nodeRecv.tagName();
+            if (tagName == u"iq" || tagName == u"message" || tagName == u"presence") {
+                d->sm.inboundCount++;
+            }
+        }
+
         if (nodeRecv.tagName() == u"iq") {
             const QString type = nodeRecv.attribute(u"type"_s);
             const auto id = nodeRecv.attribute(u"id"_s);
@@ -430,25 +768,36 @@ void QXmppIncomingClient::handleStanza(const QDomElement &nodeRecv)
         auto tagName = nodeRecv.tagName();
         if (tagName == u"iq" || tagName == u"message" || tagName == u"presence") {
             QDomElement nodeFull(nodeRecv);
+            // the received XML is updated with the DOM, so it can be routed as is
+            auto data = d->socket.receivedStanzaData();
 
             // if the sender is empty, set it to the appropriate JID
             if (nodeFull.attribute(u"from"_s).isEmpty()) {
-                if (nodeFull.tagName() == u"presence" &&
-                    (nodeFull.attribute(u"type"_s) == u"subscribe" ||
-                     nodeFull.attribute(u"type"_s) == u"subscribed")) {
-                    nodeFull.setAttribute(u"from"_s, QXmppUtils::jidToBareJid(d->jid));
-                } else {
-                    nodeFull.setAttribute(u"from"_s, d->jid);
+                // an empty attribute can not be replaced in the received XML
+                if (nodeFull.hasAttribute(u"from"_s)) {
+                    data.clear();
                 }
+                const auto sender = nodeFull.tagName() == u"presence" &&
+                        (nodeFull.attribute(u"type"_s) == u"subscribe" ||
+                         nodeFull.attribute(u"type"_s) == u"subscribed")
+                    ? QXmppUtils::jidToBareJid(d->jid)
+                    : d->jid;
+                nodeFull.setAttribute(u"from"_s, sender);
+                insertAttribute(data, tagName, u"from", sender);
             }
 
             // if the recipient is empty, set it to the local domain
             if (nodeFull.attribute(u"to"_s).isEmpty()) {
+                if (nodeFull.hasAttribute(u"to"_s)) {
+                    data.clear();
+                }
                 nodeFull.setAttribute(u"to"_s, d->domain);
+                insertAttribute(data, tagName, u"to", d->domain);
             }
 
             // emit stanza for processing by server
             Q_EMIT elementReceived(nodeFull);
+            Q_EMIT elementDataReceived(nodeFull, data);
         }
     }
 }
@@ -477,6 +826,12 @@ void QXmppIncomingClient::onDigestReply()
 
     QByteArray challenge;
     d->saslServer->setPasswordDigest(reply->digest());
+    auto *scramServer = qobject_cast<QXmppSaslServerScram *>(d->saslServer.get());
+    auto *scramReply = qobject_cast<QXmppScramCredentialsReply *>(reply);
+    if (scramServer && scramReply) {
+        const auto credentials = scramReply->scramCredentials();
+        scramServer->setCredentials(credentials.salt(), credentials.iterations(), credentials.storedKey(), credentials.serverKey());
+    }
 
     QXmppSaslServer::Response result = d->saslServer->respond(reply->property("__sasl_raw").toByteArray(), challenge);
     if (result != QXmppSaslServer::Challenge) {
@@ -514,6 +869,7 @@ void QXmppIncomingClient::onPasswordReply()
         d->jid = jid;
         info(u"Authentication succeeded for '%1' from %2"_s.arg(d->jid, d->origin()));
         Q_EMIT updateCounter(u"incoming-client.auth.success"_s);
+        d->observeAuthTime();
         if (d->saslVersion == QXmppIncomingClientPrivate::Sasl) {
             sendData(serializeXml(Sasl::Success {}));
             handleStart();
@@ -549,12 +905,31 @@ void QXmppIncomingClient::onPasswordReply()
 void QXmppIncomingClient::onSocketDisconnected()
 {
     info(u"Socket disconnected for '%1' from %2"_s.arg(d->jid, d->origin()));
-    Q_EMIT disconnected();
+    if (d->detached || d->successor) {
+        return;
+    }
+    if (d->isResumable()) {
+        d->detach();
+    } else {
+        Q_EMIT disconnected();
+    }
 }
 
 void QXmppIncomingClient::onTimeout()
 {
+    if (d->detached) {
+        info(u"Resumption timeout for '%1'"_s.arg(d->jid));
+        d->detached = false;
+        Q_EMIT disconnected();
+        return;
+    }
+
     warning(u"Idle timeout for '%1' from %2"_s.arg(d->jid, d->origin()));
+    if (d->isResumable()) {
+        d->detach();
+        d->socket.disconnectFromHost();
+        return;
+    }
     disconnectFromHost();
 
     // make sure disconnected() gets emitted no matter what
@@ -588,3 +963,55 @@ void QXmppIncomingClient::onSasl2Authenticated()
     sendStreamFeatures();
     handleStart();
 }
+
+std::shared_ptr<StreamManagementSession> QXmppIncomingClient::takeSession(QXmppIncomingClient *successor)
+{
+    // the session may have timed out in the meantime
+    if (!d->detached) {
+        return {};
+    }
+    d->detached = false;
+    d->stopIdleTimer();
+    d->smEnabled = false;
+    d->successor = successor;
+
+    auto session = std::make_shared<StreamManagementSession>(std::exchange(d->sm, {}));
+    session->jid = d->jid;
+    return session;
+}
+
+void QXmppIncomingClient::resumeSession(std::shared_ptr<StreamManagementSession> session)
+{
+    d->resuming = false;
+    d->sm = std::move(*session);
+    d->smEnabled = true;
+    d->jid = d->sm.jid;
+    d->resource = QXmppUtils::jidToResource(d->jid);
+
+    // drop the stanzas the client has received before the connection was lost and resend the rest
+    d->acknowledge(d->resumeAcknowledged);
+    d->socket.sendData(serializeXml(SmResumed { d->sm.inboundCount, d->sm.id }));
+    d->sm.unacknowledged.forEach([this](const QByteArray &data) {
+        d->socket.sendData(data);
+    });
+
+    // stanzas that have been routed to this stream during the resumption
+    const auto buffered = std::exchange(d->resumeBuffer, {});
+    for (const auto &data : buffered) {
+        d->sendStanzaData(data);
+    }
+    if (!d->sm.unacknowledged.empty()) {
+        d->requestAcknowledgement();
+    }
+
+    info(u"Session of '%1' resumed from %2"_s.arg(d->jid, d->origin()));
+    Q_EMIT updateCounter(u"incoming-client.sm.resumed"_s);
+}
+
+void QXmppIncomingClient::failResumption()
+{
+    d->resuming = false;
+    d->resumeBuffer.clear();
+    d->socket.sendData(serializeXml(SmFailed { QXmppStanza::Error::ItemNotFound }));
+    Q_EMIT updateCounter(u"incoming-client.sm.resume-failed"_s);
+}
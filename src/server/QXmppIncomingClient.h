@@ -7,6 +7,7 @@
 
 #include "QXmppLogger.h"
 
+#include <chrono>
 #include <memory>
 
 class QDomElement;
@@ -14,9 +15,14 @@ class QSslSocket;
 class QXmppNonza;
 class QXmppIncomingClientPrivate;
 class QXmppPasswordChecker;
+class tst_QXmppBenchmark;
+class tst_QXmppServer;
 
 namespace QXmpp::Private {
+struct StreamManagementSession;
+struct StreamMetrics;
 struct StreamOpen;
+class TimerWheel;
 }
 
 ///
@@ -42,6 +48,24 @@ public:
 
     /// This signal is emitted when an element is received.
     Q_SIGNAL void elementReceived(const QDomElement &element);
+    /// \cond
+    // Emitted together with elementReceived() with the received XML of the element, which is
+    // empty if it can not be forwarded as is.
+    Q_SIGNAL void elementDataReceived(const QDomElement &element, const QByteArray &data);
+
+    void setInactivityTimeout(std::chrono::milliseconds timeout);
+
+    // Stream management (XEP-0198): a resumption timeout of 0 disables resumption.
+    void setStreamManagementQueueLimit(qsizetype bytes);
+    void setStreamResumptionTimeout(int secs);
+    // Emitted instead of disconnected() when the connection of a resumable session is lost.
+    Q_SIGNAL void sessionDetached(const QString &resumptionId, qsizetype queuedBytes);
+    // Emitted when the client requests to resume the session with the given id.
+    Q_SIGNAL void sessionResumeRequested(const QString &resumptionId);
+
+    void setIdleTimerWheel(QXmpp::Private::TimerWheel *wheel);
+    void setMetrics(std::shared_ptr<QXmpp::Private::StreamMetrics> metrics);
+    /// \endcond
 
     /// This signal is emitted when the stream is connected.
     Q_SIGNAL void connected();
@@ -66,8 +90,16 @@ private:
     void onSasl2Authenticated();
     void sendStreamFeatures();
 
+    // used by the server to hand over a detached session to a new stream
+    std::shared_ptr<QXmpp::Private::StreamManagementSession> takeSession(QXmppIncomingClient *successor);
+    void resumeSession(std::shared_ptr<QXmpp::Private::StreamManagementSession> session);
+    void failResumption();
+
     const std::unique_ptr<QXmppIncomingClientPrivate> d;
     friend class QXmppIncomingClientPrivate;
+    friend class QXmppServerPrivate;
+    friend class ::tst_QXmppBenchmark;
+    friend class ::tst_QXmppServer;
 };
 
 #endif
@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QXmpp API.
+//
+// This header file may change from version to version without notice,
+// or even be removed.
+//
+// We mean it.
+//
+
+#ifndef QXMPPINCOMINGCLIENT_P_H
+#define QXMPPINCOMINGCLIENT_P_H
+
+#include "QXmppGlobal.h"
+
+#include "RingBuffer.h"
+
+#include <chrono>
+#include <memory>
+
+#include <QByteArray>
+#include <QString>
+
+namespace QXmpp::Private {
+
+class TimerWheel;
+
+// Creates the wheel for the inactivity timeouts of the incoming clients of one thread.
+QXMPP_EXPORT std::unique_ptr<TimerWheel> createIdleTimerWheel(std::chrono::milliseconds resolution = std::chrono::seconds(1));
+
+//
+// Stream management session of an incoming client (XEP-0198).
+//
+// This is the state that is handed over to the new stream when a session is resumed.
+//
+struct StreamManagementSession {
+    // resumption id, empty if the session can not be resumed
+    QString id;
+    // full JID of the session, set when the session is handed over
+    QString jid;
+    // number of stanzas received from the client
+    quint32 inboundCount = 0;
+    // sequence number of the last stanza sent to the client
+    quint32 outboundCount = 0;
+    // sent stanzas that have not been acknowledged by the client, up to outboundCount
+    RingBuffer<QByteArray> unacknowledged;
+    qsizetype unacknowledgedBytes = 0;
+};
+
+}  // namespace QXmpp::Private
+
+#endif  // QXMPPINCOMINGCLIENT_P_H
@@ -69,6 +69,8 @@ QXmppIncomingServer::QXmppIncomingServer(QSslSocket *socket, const QString &doma
     connect(&d->socket, &XmppSocket::streamReceived, this, &QXmppIncomingServer::handleStream);
     connect(&d->socket, &XmppSocket::streamClosed, this, &QXmppIncomingServer::disconnectFromHost);
     connect(&d->socket, &XmppSocket::disconnected, this, &QXmppIncomingServer::slotSocketDisconnected);
+    // allows the server to route stanzas without serializing them again
+    d->socket.setStanzaDataCaptureEnabled(true);
 
     d->domain = domain;
 
@@ -145,7 +147,7 @@ void QXmppIncomingServer::handleStanza(const QDomElement &stanza)
 {
     if (StarttlsRequest::fromDom(stanza)) {
         sendData(serializeXml(StarttlsProceed()));
-        d->socket.internalSocket()->flush();
+        d->socket.flush();
         d->socket.internalSocket()->startServerEncryption();
         return;
     } else if (QXmppDialback::isDialback(stanza)) {
@@ -178,6 +180,7 @@ void QXmppIncomingServer::handleStanza(const QDomElement &stanza)
     } else if (d->authenticated.contains(QXmppUtils::jidToDomain(stanza.attribute(u"from"_s)))) {
         // relay stanza if the remote party is authenticated
         Q_EMIT elementReceived(stanza);
+        Q_EMIT elementDataReceived(stanza, d->socket.receivedStanzaData());
     } else {
         warning(u"Received an element from unverified domain '%1' on %2"_s.arg(QXmppUtils::jidToDomain(stanza.attribute(u"from"_s)), d->origin()));
         disconnectFromHost();
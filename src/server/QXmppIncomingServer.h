@@ -47,6 +47,11 @@ public:
     Q_SIGNAL void dialbackRequestReceived(const QXmppDialback &result);
     /// This signal is emitted when an element is received.
     Q_SIGNAL void elementReceived(const QDomElement &element);
+    /// \cond
+    // Emitted together with elementReceived() with the received XML of the element, which is
+    // empty if it can not be forwarded as is.
+    Q_SIGNAL void elementDataReceived(const QDomElement &element, const QByteArray &data);
+    /// \endcond
 
 private:
     void handleStart();
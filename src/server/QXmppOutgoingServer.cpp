@@ -15,6 +15,7 @@
 #include "XmppSocket.h"
 
 #include <chrono>
+#include <utility>
 
 #include <QDnsLookup>
 #include <QDomElement>
@@ -34,7 +35,13 @@ public:
     explicit QXmppOutgoingServerPrivate(QObject *q);
 
     XmppSocket socket;
+    // stanzas waiting for the dialback, the oldest are dropped first
     QList<QByteArray> dataQueue;
+    qsizetype queuedBytes = 0;
+    qsizetype queueLimit = 1024 * 1024;
+    // queue size last reported with queueSizeChanged()
+    qsizetype reportedStanzas = 0;
+    qsizetype reportedBytes = 0;
     QDnsLookup dns;
     QString localDomain;
     QString localStreamKey;
@@ -125,6 +132,7 @@ void QXmppOutgoingServer::onDnsLookupFinished()
 void QXmppOutgoingServer::onSocketDisconnected()
 {
     debug(u"Socket disconnected"_s);
+    dropQueuedData();
     Q_EMIT disconnected();
 }
 
@@ -195,11 +203,18 @@ void QXmppOutgoingServer::handleStanza(const QDomElement &stanza)
                 info(u"Outgoing server stream to %1 is ready"_s.arg(response.from()));
                 d->ready = true;
 
-                // send queued data
-                for (const auto &data : std::as_const(d->dataQueue)) {
+                // send queued data in one write
+                if (!d->dataQueue.isEmpty()) {
+                    QByteArray data;
+                    data.reserve(d->queuedBytes);
+                    for (const auto &stanza : std::as_const(d->dataQueue)) {
+                        data.append(stanza);
+                    }
+                    d->dataQueue.clear();
+                    d->queuedBytes = 0;
+                    reportQueueSize();
                     sendData(data);
                 }
-                d->dataQueue.clear();
 
                 // emit signal
                 Q_EMIT connected();
@@ -253,13 +268,83 @@ void QXmppOutgoingServer::setVerify(const QString &id, const QString &key)
     d->verifyKey = key;
 }
 
+///
 /// Sends or queues data until connected.
+///
+/// If the queued data exceeds queueLimit(), the oldest stanzas are dropped and dataDropped() is
+/// emitted for them.
+///
 void QXmppOutgoingServer::queueData(const QByteArray &data)
 {
     if (isConnected()) {
         sendData(data);
-    } else {
-        d->dataQueue.append(data);
+        return;
+    }
+
+    d->dataQueue.append(data);
+    d->queuedBytes += data.size();
+    while (d->queuedBytes > d->queueLimit && !d->dataQueue.isEmpty()) {
+        const auto dropped = d->dataQueue.takeFirst();
+        d->queuedBytes -= dropped.size();
+        Q_EMIT updateCounter(u"outgoing-server.dropped-stanzas"_s);
+        Q_EMIT dataDropped(dropped);
+    }
+    reportQueueSize();
+}
+
+///
+/// Returns the maximum size in bytes of the data queued until the stream is connected.
+///
+/// \since QXmpp 1.13
+///
+qsizetype QXmppOutgoingServer::queueLimit() const
+{
+    return d->queueLimit;
+}
+
+///
+/// Sets the maximum size in bytes of the data queued until the stream is connected, the default
+/// is 1 MiB.
+///
+/// \since QXmpp 1.13
+///
+void QXmppOutgoingServer::setQueueLimit(qsizetype bytes)
+{
+    d->queueLimit = bytes;
+}
+
+///
+/// Returns the size in bytes of the data queued until the stream is connected.
+///
+/// \since QXmpp 1.13
+///
+qsizetype QXmppOutgoingServer::queuedBytes() const
+{
+    return d->queuedBytes;
+}
+
+void QXmppOutgoingServer::dropQueuedData()
+{
+    if (d->dataQueue.isEmpty()) {
+        return;
+    }
+
+    warning(u"Dropping %1 queued stanzas for %2"_s.arg(QString::number(d->dataQueue.size()), d->remoteDomain));
+    const auto queue = std::exchange(d->dataQueue, {});
+    d->queuedBytes = 0;
+    reportQueueSize();
+    for (const auto &data : queue) {
+        Q_EMIT updateCounter(u"outgoing-server.dropped-stanzas"_s);
+        Q_EMIT dataDropped(data);
+    }
+}
+
+void QXmppOutgoingServer::reportQueueSize()
+{
+    const auto stanzaDelta = d->dataQueue.size() - std::exchange(d->reportedStanzas, d->dataQueue.size());
+    const auto byteDelta = d->queuedBytes - std::exchange(d->reportedBytes, d->queuedBytes);
+    if (stanzaDelta || byteDelta) {
+        Q_EMIT queueSizeChanged(stanzaDelta, byteDelta);
     }
 }
 
@@ -304,5 +389,6 @@ void QXmppOutgoingServer::slotSslErrors(const QList<QSslError> &errors)
 
 void QXmppOutgoingServer::onSocketError(const QString &, std::variant<QXmpp::StreamError, QAbstractSocket::SocketError>)
 {
+    dropQueuedData();
     Q_EMIT disconnected();
 }
@@ -37,6 +37,19 @@ public:
     Q_SLOT void connectToHost(const QString &domain);
     void disconnectFromHost();
     Q_SLOT void queueData(const QByteArray &data);
+    qsizetype queueLimit() const;
+    void setQueueLimit(qsizetype bytes);
+    qsizetype queuedBytes() const;
+    /// This signal is emitted for each queued stanza that is dropped, because the queue limit was
+    /// exceeded or the stream was disconnected before it was ready.
+    ///
+    /// \since QXmpp 1.13
+    Q_SIGNAL void dataDropped(const QByteArray &data);
+    /// \cond
+    // Emitted with the change of the number of queued stanzas and bytes, the server exports the
+    // totals of all streams.
+    Q_SIGNAL void queueSizeChanged(qsizetype stanzaDelta, qsizetype byteDelta);
+    /// \endcond
 
     /// This signal is emitted when the stream is connected.
     Q_SIGNAL void connected();
@@ -63,6 +76,8 @@ private:
     void onDnsLookupFinished();
     void onSocketDisconnected();
     void sendDialback();
+    void dropQueuedData();
+    void reportQueueSize();
     void slotSslErrors(const QList<QSslError> &errors);
     void onSocketError(const QString &text, std::variant<QXmpp::StreamError, QAbstractSocket::SocketError> error);
 
@@ -4,9 +4,13 @@
 
 #include "QXmppPasswordChecker.h"
 
+#include "QXmppUtils.h"
+
 #include "Async.h"
 
 #include <QCryptographicHash>
+#include <QMessageAuthenticationCode>
+#include <QPasswordDigestor>
 #include <QTimer>
 
 using namespace QXmpp::Private;
@@ -47,6 +51,87 @@ void QXmppPasswordRequest::setUsername(const QString &username)
     m_username = username;
 }
 
+/// Constructs null credentials.
+QXmppScramCredentials::QXmppScramCredentials() = default;
+
+/// Constructs credentials from the given \a salt, \a iterations, \a storedKey and \a serverKey.
+QXmppScramCredentials::QXmppScramCredentials(const QByteArray &salt, int iterations, const QByteArray &storedKey, const QByteArray &serverKey)
+    : m_salt(salt),
+      m_iterations(iterations),
+      m_storedKey(storedKey),
+      m_serverKey(serverKey)
+{
+}
+
+///
+/// Derives the credentials for the given \a password.
+///
+/// The \a algorithm must be the hash algorithm of the SCRAM mechanism the credentials are used
+/// for, e.g. QCryptographicHash::Sha256 for SCRAM-SHA-256.
+///
+QXmppScramCredentials QXmppScramCredentials::fromPassword(QCryptographicHash::Algorithm algorithm, const QString &password, const QByteArray &salt, int iterations)
+{
+    const auto dkLen = QCryptographicHash::hashLength(algorithm);
+    const auto saltedPassword = QPasswordDigestor::deriveKeyPbkdf2(algorithm, password.toUtf8(), salt, iterations, dkLen);
+    const auto clientKey = QMessageAuthenticationCode::hash(QByteArrayLiteral("Client Key"), saltedPassword, algorithm);
+    const auto serverKey = QMessageAuthenticationCode::hash(QByteArrayLiteral("Server Key"), saltedPassword, algorithm);
+    return { salt, iterations, QCryptographicHash::hash(clientKey, algorithm), serverKey };
+}
+
+/// Returns true if no keys are set.
+bool QXmppScramCredentials::isNull() const
+{
+    return m_storedKey.isEmpty() || m_serverKey.isEmpty();
+}
+
+/// Returns the salt used to derive the salted password.
+QByteArray QXmppScramCredentials::salt() const
+{
+    return m_salt;
+}
+
+/// Sets the salt used to derive the salted password.
+void QXmppScramCredentials::setSalt(const QByteArray &salt)
+{
+    m_salt = salt;
+}
+
+/// Returns the iteration count used to derive the salted password.
+int QXmppScramCredentials::iterations() const
+{
+    return m_iterations;
+}
+
+/// Sets the iteration count used to derive the salted password.
+void QXmppScramCredentials::setIterations(int iterations)
+{
+    m_iterations = iterations;
+}
+
+/// Returns the StoredKey, the hash of the ClientKey.
+QByteArray QXmppScramCredentials::storedKey() const
+{
+    return m_storedKey;
+}
+
+/// Sets the StoredKey, the hash of the ClientKey.
+void QXmppScramCredentials::setStoredKey(const QByteArray &storedKey)
+{
+    m_storedKey = storedKey;
+}
+
+/// Returns the ServerKey used to sign the server's final message.
+QByteArray QXmppScramCredentials::serverKey() const
+{
+    return m_serverKey;
+}
+
+/// Sets the ServerKey used to sign the server's final message.
+void QXmppScramCredentials::setServerKey(const QByteArray &serverKey)
+{
+    m_serverKey = serverKey;
+}
+
 /// Constructs a new QXmppPasswordReply.
 QXmppPasswordReply::QXmppPasswordReply(QObject *parent)
     : QObject(parent),
@@ -115,6 +200,39 @@ void QXmppPasswordReply::setPassword(const QString &password)
     m_password = password;
 }
 
+class QXmppScramCredentialsReplyPrivate
+{
+public:
+    QXmppScramCredentials credentials;
+};
+
+///
+/// Constructs a new QXmppScramCredentialsReply.
+///
+QXmppScramCredentialsReply::QXmppScramCredentialsReply(QObject *parent)
+    : QXmppPasswordReply(parent),
+      d(std::make_unique<QXmppScramCredentialsReplyPrivate>())
+{
+}
+
+QXmppScramCredentialsReply::~QXmppScramCredentialsReply() = default;
+
+///
+/// Returns the SCRAM credentials.
+///
+QXmppScramCredentials QXmppScramCredentialsReply::scramCredentials() const
+{
+    return d->credentials;
+}
+
+///
+/// Sets the SCRAM credentials.
+///
+void QXmppScramCredentialsReply::setScramCredentials(const QXmppScramCredentials &credentials)
+{
+    d->credentials = credentials;
+}
+
 ///
 /// Checks that the given credentials are valid.
 ///
@@ -181,3 +299,46 @@ bool QXmppPasswordChecker::hasGetPassword() const
 {
     return false;
 }
+
+///
+/// Retrieves the SCRAM credentials for the given username and hash \a algorithm.
+///
+/// Reimplement this method if your backend stores SCRAM credentials (see
+/// QXmppScramCredentials::fromPassword()), so the password is never needed by the server. The
+/// base implementation derives the credentials from getPassword() with a random salt, which
+/// costs a key derivation per login.
+///
+/// \since QXmpp 1.13
+///
+QXmppScramCredentialsReply *QXmppPasswordChecker::getScramCredentials(const QXmppPasswordRequest &request, QCryptographicHash::Algorithm algorithm)
+{
+    auto *reply = new QXmppScramCredentialsReply;
+
+    QString secret;
+    QXmppPasswordReply::Error error = getPassword(request, secret);
+    if (error == QXmppPasswordReply::NoError) {
+        reply->setScramCredentials(QXmppScramCredentials::fromPassword(algorithm, secret, QXmppUtils::generateRandomBytes(16), 4096));
+    } else {
+        reply->setError(error);
+    }
+
+    // reply is finished
+    reply->finishLater();
+    return reply;
+}
+
+///
+/// Returns the hash algorithms of the SCRAM mechanisms for which getScramCredentials() can
+/// return credentials.
+///
+/// The base implementation returns SHA-1, SHA-256 and SHA-512 if getPassword() is implemented.
+///
+/// \since QXmpp 1.13
+///
+QList<QCryptographicHash::Algorithm> QXmppPasswordChecker::scramAlgorithms() const
+{
+    if (hasGetPassword()) {
+        return { QCryptographicHash::Sha1, QCryptographicHash::Sha256, QCryptographicHash::Sha512 };
+    }
+    return {};
+}
@@ -7,8 +7,13 @@
 
 #include "QXmppGlobal.h"
 
+#include <memory>
+
+#include <QCryptographicHash>
 #include <QObject>
 
+class QXmppScramCredentialsReplyPrivate;
+
 /// \brief The QXmppPasswordRequest class represents a password request.
 ///
 class QXMPP_EXPORT QXmppPasswordRequest
@@ -34,6 +39,45 @@ private:
     QString m_username;
 };
 
+///
+/// \brief The QXmppScramCredentials class contains the keys needed to verify a SCRAM
+/// authentication (RFC 5802) without knowing the password.
+///
+/// Backends should store the credentials instead of the password and return them from
+/// QXmppPasswordChecker::getScramCredentials(). They can be created from a password using
+/// fromPassword(), e.g. when an account is registered.
+///
+/// \since QXmpp 1.13
+///
+class QXMPP_EXPORT QXmppScramCredentials
+{
+public:
+    QXmppScramCredentials();
+    QXmppScramCredentials(const QByteArray &salt, int iterations, const QByteArray &storedKey, const QByteArray &serverKey);
+
+    static QXmppScramCredentials fromPassword(QCryptographicHash::Algorithm algorithm, const QString &password, const QByteArray &salt, int iterations);
+
+    bool isNull() const;
+
+    QByteArray salt() const;
+    void setSalt(const QByteArray &salt);
+
+    int iterations() const;
+    void setIterations(int iterations);
+
+    QByteArray storedKey() const;
+    void setStoredKey(const QByteArray &storedKey);
+
+    QByteArray serverKey() const;
+    void setServerKey(const QByteArray &serverKey);
+
+private:
+    QByteArray m_salt;
+    int m_iterations = 0;
+    QByteArray m_storedKey;
+    QByteArray m_serverKey;
+};
+
 /// \brief The QXmppPasswordReply class represents a password reply.
 ///
 class QXMPP_EXPORT QXmppPasswordReply : public QObject
@@ -76,6 +120,26 @@ private:
     bool m_isFinished;
 };
 
+///
+/// \brief The QXmppScramCredentialsReply class represents a reply with SCRAM credentials.
+///
+/// \since QXmpp 1.13
+///
+class QXMPP_EXPORT QXmppScramCredentialsReply : public QXmppPasswordReply
+{
+    Q_OBJECT
+
+public:
+    QXmppScramCredentialsReply(QObject *parent = nullptr);
+    ~QXmppScramCredentialsReply() override;
+
+    QXmppScramCredentials scramCredentials() const;
+    void setScramCredentials(const QXmppScramCredentials &credentials);
+
+private:
+    const std::unique_ptr<QXmppScramCredentialsReplyPrivate> d;
+};
+
 /// \brief The QXmppPasswordChecker class represents an abstract password checker.
 ///
 
@@ -88,6 +152,10 @@ public:
 
 protected:
     virtual QXmppPasswordReply::Error getPassword(const QXmppPasswordRequest &request, QString &password);
+
+public:
+    virtual QXmppScramCredentialsReply *getScramCredentials(const QXmppPasswordRequest &request, QCryptographicHash::Algorithm algorithm);
+    virtual QList<QCryptographicHash::Algorithm> scramAlgorithms() const;
 };
 
 #endif
@@ -7,26 +7,40 @@
 #include "QXmppConstants_p.h"
 #include "QXmppDialback.h"
 #include "QXmppIncomingClient.h"
+#include "QXmppIncomingClient_p.h"
 #include "QXmppIncomingServer.h"
 #include "QXmppIq.h"
+#include "QXmppMessage.h"
+#include "QXmppMetrics_p.h"
 #include "QXmppOutgoingServer.h"
+#include "QXmppPresence.h"
 #include "QXmppServerExtension.h"
 #include "QXmppServerPlugin.h"
+#include "QXmppServer_p.h"
 #include "QXmppUtils.h"
 
 #include "StringLiterals.h"
+#include "TimerWheel.h"
 
 #include <QCoreApplication>
 #include <QDomElement>
 #include <QFileInfo>
 #include <QPluginLoader>
-#include <QSslCertificate>
+#include <QPointer>
 #include <QSslConfiguration>
-#include <QSslKey>
 #include <QSslSocket>
+#include <QVarLengthArray>
+#include <QXmlStreamReader>
+
+#include <algorithm>
+#include <functional>
+#include <optional>
 
 using namespace QXmpp::Private;
 
+// Seconds after which an incoming client is disconnected for inactivity.
+constexpr int CLIENT_INACTIVITY_TIMEOUT = 120;
+
 static void helperToXmlAddDomElement(QXmlStreamWriter *stream, const QDomElement &element, const QVector<QStringView> &omitNamespaces)
 {
     stream->writeStartElement(element.tagName());
@@ -55,43 +69,32 @@ static void helperToXmlAddDomElement(QXmlStreamWriter *stream, const QDomElement
     stream->writeEndElement();
 }
 
-class QXmppServerPrivate
+QSslSocket *SslSocketConfig::createSocket(qintptr socketDescriptor) const
+{
+    auto *socket = new QSslSocket;
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        delete socket;
+        return nullptr;
+    }
+
+    if (!localCertificate.isNull() && !privateKey.isNull()) {
+        auto sslConfig = socket->sslConfiguration();
+        sslConfig.setCaCertificates(sslConfig.caCertificates() + caCertificates);
+        socket->setSslConfiguration(sslConfig);
+
+        socket->setProtocol(QSsl::AnyProtocol);
+        socket->setLocalCertificate(localCertificate);
+        socket->setPrivateKey(privateKey);
+    }
+    return socket;
+}
+
+class QXmppSslServerPrivate
 {
 public:
-    QXmppServerPrivate(QXmppServer *qq);
-    void loadExtensions(QXmppServer *server);
-    bool routeData(const QString &to, const QByteArray &data);
-    void startExtensions();
-    void stopExtensions();
-
-    void info(const QString &message);
-    void warning(const QString &message);
-
-    QString domain;
-    QList<QXmppServerExtension *> extensions;
-    QXmppLogger *logger;
-    QXmppPasswordChecker *passwordChecker;
-
-    // client-to-server
-    QSet<QXmppIncomingClient *> incomingClients;
-    QHash<QString, QXmppIncomingClient *> incomingClientsByJid;
-    QHash<QString, QSet<QXmppIncomingClient *>> incomingClientsByBareJid;
-    QSet<QXmppSslServer *> serversForClients;
-
-    // server-to-server
-    QSet<QXmppIncomingServer *> incomingServers;
-    QSet<QXmppOutgoingServer *> outgoingServers;
-    QSet<QXmppSslServer *> serversForServers;
-
-    // ssl
-    QList<QSslCertificate> caCertificates;
-    QSslCertificate localCertificate;
-    QSslKey privateKey;
-
-private:
-    bool loaded;
-    bool started;
-    QXmppServer *q;
+    SslSocketConfig config;
+    // if set, accepted descriptors are passed on instead of creating the socket here
+    std::function<void(qintptr, const SslSocketConfig &)> descriptorHandler;
 };
 
 QXmppServerPrivate::QXmppServerPrivate(QXmppServer *qq)
@@ -103,6 +106,18 @@ QXmppServerPrivate::QXmppServerPrivate(QXmppServer *qq)
 {
 }
 
+// Calls the function directly if the object lives in the current thread and queues the call to the
+// thread of the object otherwise.
+template<typename T, typename Function>
+static void invokeInThread(T *object, Function function)
+{
+    if (object->thread() == QThread::currentThread()) {
+        function(object);
+    } else {
+        QMetaObject::invokeMethod(object, [object, function = std::move(function)] { function(object); }, Qt::QueuedConnection);
+    }
+}
+
 /// Routes XMPP data to the given recipient.
 ///
 /// \param to
@@ -113,18 +128,26 @@ bool QXmppServerPrivate::routeData(const QString &to, const QByteArray &data)
 {
     // refuse to route packets to empty destination, own domain or sub-domains
     const QString toDomain = QXmppUtils::jidToDomain(to);
-    if (to.isEmpty() || to == domain || toDomain.endsWith(QString(u"." + domain))) {
+    const auto isSubDomain = toDomain.size() > domain.size() &&
+        toDomain.endsWith(domain) &&
+        toDomain[toDomain.size() - domain.size() - 1] == u'.';
+    if (to.isEmpty() || to == domain || isSubDomain) {
         return false;
     }
 
     if (toDomain == domain) {
         // look for a client connection
-        QList<QXmppIncomingClient *> found;
+        QVarLengthArray<QXmppIncomingClient *, 8> found;
         // if (QXmppUtils::jidToResource(to).isEmpty()) {
-            const auto &connections = incomingClientsByBareJid.value(QXmppUtils::jidToBareJid(to));
-            for (auto *conn : connections) {
-                found << conn;
+            QReadLocker locker(&routingLock);
+            const auto connections = incomingClientsByBareJid.constFind(QXmppUtils::jidToBareJid(to));
+            if (connections != incomingClientsByBareJid.cend()) {
+                for (auto *conn : *connections) {
+                    found.append(conn);
+                }
             }
+            // do not hold the lock while sending, the stream may disconnect synchronously
+            locker.unlock();
         // } else {
         //     QXmppIncomingClient *conn = incomingClientsByJid.value(to);
         //     if (conn) {
@@ -132,40 +155,51 @@ bool QXmppServerPrivate::routeData(const QString &to, const QByteArray &data)
         //     }
         // }
 
-        // send data
+        // send data (queued if the stream runs in a worker thread)
         for (auto *conn : std::as_const(found)) {
-            QMetaObject::invokeMethod(conn, "sendData", Q_ARG(QByteArray, data));
+            invokeInThread(conn, [data](auto *stream) { stream->sendData(data); });
         }
         return !found.isEmpty();
 
     } else if (!serversForServers.isEmpty()) {
 
-        // look for an outgoing S2S connection
-        for (auto *conn : std::as_const(outgoingServers)) {
-            if (conn->remoteDomain() == toDomain) {
-                // send or queue data
-                QMetaObject::invokeMethod(conn, "queueData", Q_ARG(QByteArray, data));
-                return true;
-            }
+        // look for an outgoing S2S connection (server-to-server streams always run in the
+        // thread of the server)
+        if (auto *conn = outgoingServers.value(toDomain)) {
+            // send or queue data
+            invokeInThread(conn, [data](auto *stream) { stream->queueData(data); });
+            return true;
         }
 
         // if we did not find an outgoing server,
         // we need to establish the S2S connection
         auto *conn = new QXmppOutgoingServer(domain, nullptr);
         conn->setLocalStreamKey(QXmppUtils::generateStanzaHash());
+        conn->setQueueLimit(outgoingServerQueueLimit);
         conn->moveToThread(q->thread());
         conn->setParent(q);
 
         QObject::connect(conn, &QXmppOutgoingServer::disconnected,
                          q, &QXmppServer::_q_outgoingServerDisconnected);
+        QObject::connect(conn, &QXmppOutgoingServer::dataDropped, q, [this](const QByteArray &data) {
+            bounceData(data);
+        });
+        QObject::connect(conn, &QXmppOutgoingServer::queueSizeChanged, q, [this](qsizetype stanzaDelta, qsizetype byteDelta) {
+            outgoingQueuedStanzas += stanzaDelta;
+            outgoingQueuedBytes += byteDelta;
+            Q_EMIT q->setGauge(u"outgoing-server.queued-stanzas"_s, outgoingQueuedStanzas);
+            Q_EMIT q->setGauge(u"outgoing-server.queued-bytes"_s, outgoingQueuedBytes);
+        });
 
         // add stream
-        outgoingServers.insert(conn);
+        outgoingServers.insert(toDomain, conn);
         Q_EMIT q->setGauge(u"outgoing-server.count"_s, outgoingServers.size());
 
-        // queue data and connect to remote server
-        QMetaObject::invokeMethod(conn, "queueData", Q_ARG(QByteArray, data));
-        QMetaObject::invokeMethod(conn, "connectToHost", Q_ARG(QString, toDomain));
+        // connect to remote server and queue data
+        invokeInThread(conn, [data, toDomain](auto *stream) {
+            stream->connectToHost(toDomain);
+            stream->queueData(data);
+        });
         return true;
 
     } else {
@@ -175,55 +209,483 @@ bool QXmppServerPrivate::routeData(const QString &to, const QByteArray &data)
     }
 }
 
-/// Handles an incoming XML element.
-static void handleStanza(QXmppServer *server, const QDomElement &element)
+// Replies on behalf of the remote server with a remote-server-timeout error to a stanza that could
+// not be delivered to it.
+void QXmppServerPrivate::bounceData(const QByteArray &data)
 {
-    // try extensions
-    const auto &extensions = server->extensions();
-    for (auto *extension : extensions) {
-        if (extension->handleStanza(element)) {
+    // only the attributes of the stanza are needed
+    QXmlStreamReader reader(data);
+    if (!reader.readNextStartElement()) {
+        return;
+    }
+
+    const auto tagName = reader.name();
+    const auto attributes = reader.attributes();
+    const auto type = attributes.value(u"type");
+    const auto from = attributes.value(u"from").toString();
+    // never reply to errors or results
+    if (from.isEmpty() || type == u"error" || (tagName == u"iq" && type == u"result")) {
+        return;
+    }
+
+    auto bounce = [&](QXmppStanza &&stanza) {
+        stanza.setId(attributes.value(u"id").toString());
+        stanza.setFrom(attributes.value(u"to").toString());
+        stanza.setTo(from);
+        stanza.setError(QXmppStanza::Error(QXmppStanza::Error::Wait, QXmppStanza::Error::RemoteServerTimeout));
+        q->sendPacket(stanza);
+    };
+
+    if (tagName == u"iq") {
+        bounce(QXmppIq(QXmppIq::Error));
+    } else if (tagName == u"message") {
+        QXmppMessage message;
+        message.setType(QXmppMessage::Error);
+        bounce(std::move(message));
+    } else if (tagName == u"presence") {
+        bounce(QXmppPresence(QXmppPresence::Error));
+    }
+}
+
+// Memory accounted for a detached session in addition to its queued stanzas (stream, socket and
+// routing entries).
+constexpr qsizetype DETACHED_SESSION_OVERHEAD = 4 * 1024;
+
+// Keeps a session that lost its connection until it is resumed or times out.
+void QXmppServerPrivate::addDetachedSession(QXmppIncomingClient *client, const QString &id, qsizetype queuedBytes)
+{
+    {
+        // the stream may have been removed in the meantime
+        QReadLocker locker(&routingLock);
+        if (id.isEmpty() || !incomingClients.contains(client)) {
+            return;
+        }
+    }
+
+    const auto order = detachedSessionCounter++;
+    const auto size = queuedBytes + DETACHED_SESSION_OVERHEAD;
+    detachedSessions.insert(id, DetachedSession { client, client->jid(), size, order });
+    detachedSessionIds.insert(client, id);
+    detachedSessionOrder.emplace(order, id);
+    detachedSessionsSize += size;
+
+    // drop the oldest sessions when the memory limit is exceeded
+    while (detachedSessionsSize > detachedSessionsMemoryLimit && !detachedSessionOrder.empty()) {
+        const auto oldest = detachedSessions.value(detachedSessionOrder.begin()->second);
+        removeDetachedSession(oldest.client);
+        warning(u"Dropping detached session of '%1', the memory limit has been reached"_s.arg(oldest.jid));
+        invokeInThread(oldest.client, [](auto *stream) { stream->disconnectFromHost(); });
+    }
+
+    Q_EMIT q->setGauge(u"incoming-client.detached-count"_s, detachedSessions.size());
+}
+
+bool QXmppServerPrivate::removeDetachedSession(QXmppIncomingClient *client)
+{
+    const auto id = detachedSessionIds.take(client);
+    if (id.isEmpty()) {
+        return false;
+    }
+    const auto session = detachedSessions.take(id);
+    detachedSessionOrder.erase(session.order);
+    detachedSessionsSize -= session.size;
+    return true;
+}
+
+// Hands over a detached session to the stream that requested to resume it.
+void QXmppServerPrivate::resumeSession(QXmppIncomingClient *client, const QString &id)
+{
+    {
+        QReadLocker locker(&routingLock);
+        if (!incomingClients.contains(client)) {
             return;
         }
     }
 
+    // only the user of the session can resume it
+    const auto session = detachedSessions.value(id);
+    if (!session.client || QXmppUtils::jidToBareJid(session.jid) != QXmppUtils::jidToBareJid(client->jid())) {
+        invokeInThread(client, [](auto *stream) { stream->failResumption(); });
+        return;
+    }
+    removeDetachedSession(session.client);
+    Q_EMIT q->setGauge(u"incoming-client.detached-count"_s, detachedSessions.size());
+
+    // The old stream hands over its state in its own thread and forwards stanzas to the new stream
+    // until the routing tables have been updated.
+    QPointer<QXmppIncomingClient> successor(client);
+    invokeInThread(session.client, [this, successor, jid = session.jid](auto *stream) {
+        if (!successor) {
+            return;
+        }
+        auto state = stream->takeSession(successor);
+        if (!state) {
+            // the session timed out in the meantime
+            invokeInThread(successor.data(), [](auto *stream) { stream->failResumption(); });
+            return;
+        }
+        invokeInThread(successor.data(), [state](auto *stream) { stream->resumeSession(state); });
+        invokeInThread(q, [this, stream, successor = successor.data(), jid](auto *) {
+            replaceClient(stream, successor, jid);
+        });
+    });
+}
+
+// Routes the stanzas of a resumed session to the new stream and removes the old one.
+void QXmppServerPrivate::replaceClient(QXmppIncomingClient *oldClient, QXmppIncomingClient *client, const QString &jid)
+{
+    const auto bareJid = QXmppUtils::jidToBareJid(jid);
+
+    QWriteLocker locker(&routingLock);
+    incomingClients.remove(oldClient);
+    if (incomingClientsByJid.value(jid) == oldClient) {
+        incomingClientsByJid.remove(jid);
+    }
+    auto &bareJidClients = incomingClientsByBareJid[bareJid];
+    bareJidClients.remove(oldClient);
+    // the new stream may have been closed in the meantime
+    if (incomingClients.contains(client)) {
+        incomingClientsByJid.insert(jid, client);
+        bareJidClients.insert(client);
+    }
+    if (bareJidClients.isEmpty()) {
+        incomingClientsByBareJid.remove(bareJid);
+    }
+    const auto count = incomingClients.size();
+    locker.unlock();
+
+    oldClient->deleteLater();
+    Q_EMIT q->setGauge(u"incoming-client.count"_s, count);
+}
+
+// Hands a new client connection to the worker with the fewest connections.
+void QXmppServerPrivate::dispatchClientConnection(qintptr socketDescriptor, const SslSocketConfig &config)
+{
+    auto byConnections = [](const auto &a, const auto &b) {
+        return a->connections.load(std::memory_order_relaxed) < b->connections.load(std::memory_order_relaxed);
+    };
+    auto *worker = std::min_element(workers.begin(), workers.end(), byConnections)->get();
+    // counted immediately, so a burst of connections is spread over all workers
+    worker->connections++;
+
+    // the settings are read here, the worker thread must not access the server
+    QMetaObject::invokeMethod(worker->context, [this, worker, socketDescriptor, config, domain = domain, metrics = clientMetrics, passwordChecker = passwordChecker, queueLimit = streamManagementQueueLimit, resumptionTimeout = streamResumptionTimeout] {
+        auto *socket = config.createSocket(socketDescriptor);
+        if (!socket) {
+            worker->connections--;
+            return;
+        }
+
+        if (!worker->idleTimeouts) {
+            worker->idleTimeouts = createIdleTimerWheel();
+        }
+
+        auto *stream = new QXmppIncomingClient(socket, domain, worker->context);
+        stream->setIdleTimerWheel(worker->idleTimeouts.get());
+        stream->setInactivityTimeout(CLIENT_INACTIVITY_TIMEOUT);
+        stream->setMetrics(metrics);
+        stream->setPasswordChecker(passwordChecker);
+        stream->setStreamManagementQueueLimit(queueLimit);
+        stream->setStreamResumptionTimeout(resumptionTimeout);
+        socket->setParent(stream);
+        QObject::connect(stream, &QObject::destroyed, worker->context, [worker] {
+            worker->connections--;
+        });
+        registerIncomingClient(stream);
+    }, Qt::QueuedConnection);
+}
+
+// Connects the signals of a new client stream and adds it to the streams of the server. This is
+// called in the thread of the stream and must only use the routing tables and the server object.
+void QXmppServerPrivate::registerIncomingClient(QXmppIncomingClient *stream)
+{
+    // the JID is read in the thread of the stream
+    QObject::connect(stream, &QXmppIncomingClient::connected, stream, [this, stream] {
+        invokeInThread(q, [this, stream, jid = stream->jid()](auto *) {
+            clientConnected(stream, jid);
+        });
+    });
+    QObject::connect(stream, &QXmppIncomingClient::disconnected, q, &QXmppServer::_q_clientDisconnected);
+    QObject::connect(stream, &QXmppIncomingClient::elementDataReceived, q, [this](const QDomElement &element, const QByteArray &data) {
+        handleStanza(element, data);
+    });
+    QObject::connect(stream, &QXmppIncomingClient::sessionDetached, q, [this, stream](const QString &id, qsizetype queuedBytes) {
+        addDetachedSession(stream, id, queuedBytes);
+    });
+    QObject::connect(stream, &QXmppIncomingClient::sessionResumeRequested, q, [this, stream](const QString &id) {
+        resumeSession(stream, id);
+    });
+
+    // add stream
+    QWriteLocker locker(&routingLock);
+    incomingClients.insert(stream);
+    const auto count = incomingClients.size();
+    const auto logTypes = relayedMessageTypes;
+    locker.unlock();
+
+    // streams of worker threads are no children of the server, so their log messages and metrics
+    // are not relayed automatically
+    if (stream->parent() != q) {
+        QObject::connect(stream, &QXmppLoggable::setGauge, q, &QXmppLoggable::setGauge);
+        QObject::connect(stream, &QXmppLoggable::updateCounter, q, &QXmppLoggable::updateCounter);
+        invokeInThread(stream, [this, logTypes](auto *client) {
+            relayLogMessages(client, logTypes);
+        });
+    }
+
+    Q_EMIT q->setGauge(u"incoming-client.count"_s, count);
+}
+
+// Relays the log messages of a stream that is no child of the server, called in the thread of the
+// stream. The stream is only connected if any messages are logged, so it doesn't build messages
+// that would be discarded.
+void QXmppServerPrivate::relayLogMessages(QXmppIncomingClient *stream, QXmppLogger::MessageTypes types)
+{
+    stream->setRelayedMessageTypes(types);
+    if (!types) {
+        QObject::disconnect(stream, &QXmppLoggable::logMessage, q, &QXmppLoggable::logMessage);
+    } else {
+        QObject::connect(stream, &QXmppLoggable::logMessage, q, &QXmppLoggable::logMessage, Qt::UniqueConnection);
+    }
+}
+
+// Passes the logged message types of the server on to the streams that are no children of it.
+// Needs to be called whenever the logger or its settings change.
+void QXmppServerPrivate::updateRelayedMessageTypes()
+{
+    const auto types = q->loggedMessageTypes();
+
+    QWriteLocker locker(&routingLock);
+    relayedMessageTypes = types;
+    const auto clients = incomingClients;
+    locker.unlock();
+
+    for (auto *client : clients) {
+        // the parent of streams in other threads isn't read here
+        if (client->thread() != q->thread() || client->parent() != q) {
+            invokeInThread(client, [this, types](auto *stream) {
+                relayLogMessages(stream, types);
+            });
+        }
+    }
+}
+
+// Adds a client that has finished the stream negotiation to the routing tables.
+void QXmppServerPrivate::clientConnected(QXmppIncomingClient *client, const QString &jid)
+{
+    // check whether the connection conflicts with another one
+    QWriteLocker locker(&routingLock);
+    if (!incomingClients.contains(client)) {
+        // disconnected in the meantime
+        return;
+    }
+    QXmppIncomingClient *old = incomingClientsByJid.value(jid);
+    incomingClientsByJid.insert(jid, client);
+    incomingClientsByBareJid[QXmppUtils::jidToBareJid(jid)].insert(client);
+    locker.unlock();
+
+    if (old && old != client) {
+        invokeInThread(old, [](auto *stream) {
+            stream->sendData("<stream:error><conflict xmlns='urn:ietf:params:xml:ns:xmpp-streams'/><text xmlns='urn:ietf:params:xml:ns:xmpp-streams'>Replaced by new connection</text></stream:error>");
+            stream->disconnectFromHost();
+        });
+    }
+
+    Q_EMIT q->clientConnected(jid);
+}
+
+static QXmppMetrics::Histogram *extensionHandlingTime(QXmppMetrics *registry, QXmppServerExtension *extension)
+{
+    if (!registry) {
+        return nullptr;
+    }
+    auto name = extension->extensionName();
+    if (name.isEmpty()) {
+        name = QString::fromLatin1(extension->metaObject()->className());
+    }
+    return registry->histogram(u"server.extension.%1.handle-seconds"_s.arg(name));
+}
+
+// Looks up the handles of the metrics of the logger, new streams use them.
+void QXmppServerPrivate::updateMetrics()
+{
+    auto registry = logger ? logger->metrics() : nullptr;
+    routeTime = registry ? registry->histogram(u"server.route-seconds"_s) : nullptr;
+    for (auto &handler : extensionHandlers) {
+        handler.handlingTime = extensionHandlingTime(registry.get(), handler.extension);
+    }
+    clientMetrics = StreamMetrics::create(std::move(registry), u"incoming-client"_s);
+}
+
+void QXmppServerPrivate::startWorkers()
+{
+    while (std::ssize(workers) < workerThreadCount) {
+        auto worker = std::make_unique<ServerWorker>();
+        worker->thread.setObjectName(u"QXmppServer worker %1"_s.arg(workers.size()));
+        worker->context = new QObject;
+        worker->context->moveToThread(&worker->thread);
+        // deletes the streams of the worker in its own thread
+        QObject::connect(&worker->thread, &QThread::finished, worker->context, &QObject::deleteLater);
+        QObject::connect(&worker->thread, &QThread::finished, worker->context, [worker = worker.get()] {
+            worker->idleTimeouts.reset();
+        });
+        worker->thread.start();
+        workers.push_back(std::move(worker));
+    }
+}
+
+void QXmppServerPrivate::stopWorkers()
+{
+    for (const auto &worker : workers) {
+        worker->thread.quit();
+    }
+    for (const auto &worker : workers) {
+        worker->thread.wait();
+    }
+    workers.clear();
+}
+
+// Handles an incoming XML element. If available, \a data is the XML the element was received as.
+void QXmppServerPrivate::handleStanza(const QDomElement &element, const QByteArray &data)
+{
+    const ScopedTimer timer(routeTime);
+
+    // try extensions
+    if (dispatchToExtensions(element)) {
+        return;
+    }
+
     // default handlers
-    const QString domain = server->domain();
     const QString to = element.attribute(u"to"_s);
     if (to == domain) {
         if (element.tagName() == u"iq") {
             // we do not support the given IQ
-            QXmppIq request;
-            request.parse(element);
-
-            if (request.type() != QXmppIq::Error && request.type() != QXmppIq::Result) {
-                QXmppIq response(QXmppIq::Error);
-                response.setId(request.id());
-                response.setFrom(domain);
-                response.setTo(request.from());
-                QXmppStanza::Error error(QXmppStanza::Error::Cancel,
-                                         QXmppStanza::Error::FeatureNotImplemented);
-                response.setError(error);
-                server->sendPacket(response);
-            }
+            sendIqError(element, domain, QXmppStanza::Error::FeatureNotImplemented);
         }
 
     } else {
 
-        // route element or reply on behalf of missing peer
-        if (!server->sendElement(element) && element.tagName() == u"iq") {
-            QXmppIq request;
-            request.parse(element);
-
-            QXmppIq response(QXmppIq::Error);
-            response.setId(request.id());
-            response.setFrom(request.to());
-            response.setTo(request.from());
-            QXmppStanza::Error error(QXmppStanza::Error::Cancel,
-                                     QXmppStanza::Error::ServiceUnavailable);
-            response.setError(error);
-            server->sendPacket(response);
+        // route element or reply on behalf of missing peer, the received XML is forwarded if
+        // possible instead of serializing the element again
+        const auto routed = data.isEmpty() ? q->sendElement(element) : routeData(to, data);
+        if (!routed && element.tagName() == u"iq") {
+            sendIqError(element, to, QXmppStanza::Error::ServiceUnavailable);
+        }
+    }
+}
+
+static std::optional<qsizetype> stanzaRoutesIndex(const QString &tagName)
+{
+    if (tagName == u"message") {
+        return 0;
+    }
+    if (tagName == u"presence") {
+        return 1;
+    }
+    if (tagName == u"iq") {
+        return 2;
+    }
+    return {};
+}
+
+// Offers the element to the extensions that handle it, returns true if one of them handled it.
+bool QXmppServerPrivate::dispatchToExtensions(const QDomElement &element)
+{
+    if (!extensionRoutesValid) {
+        buildExtensionRoutes();
+    }
+
+    auto callHandler = [this, &element](qsizetype index) {
+        const auto &handler = extensionHandlers[index];
+        const ScopedTimer timer(handler.handlingTime);
+        return handler.extension->handleStanza(element);
+    };
+
+    const auto routesIndex = stanzaRoutesIndex(element.tagName());
+    if (!routesIndex) {
+        // other elements are offered to all extensions
+        for (qsizetype i = 0; i < std::ssize(extensionHandlers); i++) {
+            if (callHandler(i)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const auto &routes = extensionRoutes[*routesIndex];
+    QVarLengthArray<qsizetype, 16> candidates;
+    candidates.append(routes.anyNamespace.constData(), routes.anyNamespace.size());
+    if (!routes.byNamespace.isEmpty()) {
+        for (auto child = element.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+            const auto itr = routes.byNamespace.constFind(child.namespaceURI());
+            if (itr != routes.byNamespace.cend()) {
+                candidates.append(itr->constData(), itr->size());
+            }
+        }
+        // keep the order of the priorities and call each extension once
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    }
+
+    for (const auto index : std::as_const(candidates)) {
+        if (callHandler(index)) {
+            return true;
         }
     }
+    return false;
+}
+
+// Indexes the extensions by the stanzas they handle.
+void QXmppServerPrivate::buildExtensionRoutes()
+{
+    loadExtensions(q);
+
+    constexpr std::array stanzaTypes = {
+        QXmppServerExtension::MessageStanza,
+        QXmppServerExtension::PresenceStanza,
+        QXmppServerExtension::IqStanza,
+    };
+
+    const auto registry = logger ? logger->metrics() : nullptr;
+    extensionHandlers.clear();
+    extensionRoutes = {};
+    for (auto *extension : std::as_const(extensions)) {
+        const auto index = qsizetype(extensionHandlers.size());
+        extensionHandlers.push_back({ extension, extensionHandlingTime(registry.get(), extension) });
+
+        const auto types = extension->handledStanzaTypes();
+        const auto namespaces = extension->handledNamespaces();
+        for (std::size_t i = 0; i < stanzaTypes.size(); i++) {
+            if (!types.testFlag(stanzaTypes[i])) {
+                continue;
+            }
+            auto &routes = extensionRoutes[i];
+            if (namespaces.isEmpty()) {
+                routes.anyNamespace.append(index);
+            } else {
+                for (const auto &ns : namespaces) {
+                    routes.byNamespace[ns].append(index);
+                }
+            }
+        }
+    }
+    extensionRoutesValid = true;
+}
+
+// Replies to an IQ request with an error, the request is not parsed.
+void QXmppServerPrivate::sendIqError(const QDomElement &request, const QString &from, QXmppStanza::Error::Condition condition)
+{
+    const auto type = request.attribute(u"type"_s);
+    if (type == u"error" || type == u"result") {
+        return;
+    }
+
+    QXmppIq response(QXmppIq::Error);
+    response.setId(request.attribute(u"id"_s));
+    response.setFrom(from);
+    response.setTo(request.attribute(u"from"_s));
+    response.setError(QXmppStanza::Error(QXmppStanza::Error::Cancel, condition));
+    q->sendPacket(response);
 }
 
 void QXmppServerPrivate::info(const QString &message)
@@ -269,6 +731,8 @@ void QXmppServerPrivate::startExtensions()
                 warning(u"Could not start extension %1"_s.arg(extension->extensionName()));
             }
         }
+        // the extensions may only know the stanzas they handle once they are started
+        buildExtensionRoutes();
         started = true;
     }
 }
@@ -295,6 +759,7 @@ QXmppServer::QXmppServer(QObject *parent)
 QXmppServer::~QXmppServer()
 {
     close();
+    d->stopWorkers();
 }
 
 /// Registers a new extension with the server.
@@ -307,6 +772,8 @@ void QXmppServer::addExtension(QXmppServerExtension *extension)
     extension->setParent(this);
     extension->setServer(this);
 
+    d->extensionRoutesValid = false;
+
     // keep extensions sorted by priority
     for (int i = 0; i < d->extensions.size(); ++i) {
         QXmppServerExtension *other = d->extensions[i];
@@ -353,6 +820,7 @@ void QXmppServer::setLogger(QXmppLogger *logger)
                        d->logger, &QXmppLogger::setGauge);
             disconnect(this, &QXmppLoggable::updateCounter,
                        d->logger, &QXmppLogger::updateCounter);
+            disconnect(d->logger, nullptr, this, nullptr);
         }
 
         d->logger = logger;
@@ -363,7 +831,23 @@ void QXmppServer::setLogger(QXmppLogger *logger)
                     d->logger, &QXmppLogger::setGauge);
             connect(this, &QXmppLoggable::updateCounter,
                     d->logger, &QXmppLogger::updateCounter);
+
+            // only build log messages that are going to be logged
+            connect(d->logger, &QXmppLogger::loggingTypeChanged, this, [this] {
+                updateLoggedMessageTypes(d->logger);
+                d->updateRelayedMessageTypes();
+            });
+            connect(d->logger, &QXmppLogger::messageTypesChanged, this, [this] {
+                updateLoggedMessageTypes(d->logger);
+                d->updateRelayedMessageTypes();
+            });
+            connect(d->logger, &QXmppLogger::metricsChanged, this, [this] {
+                d->updateMetrics();
+            });
         }
+        updateLoggedMessageTypes(d->logger);
+        d->updateRelayedMessageTypes();
+        d->updateMetrics();
 
         Q_EMIT loggerChanged(d->logger);
     }
@@ -386,12 +870,147 @@ QVariantMap QXmppServer::statistics() const
 {
     QVariantMap stats;
     stats[u"version"_s] = qApp->applicationVersion();
-    stats[u"incoming-clients"_s] = d->incomingClients.size();
+    {
+        QReadLocker locker(&d->routingLock);
+        stats[u"incoming-clients"_s] = d->incomingClients.size();
+    }
     stats[u"incoming-servers"_s] = d->incomingServers.size();
     stats[u"outgoing-servers"_s] = d->outgoingServers.size();
+    stats[u"worker-threads"_s] = int(d->workers.size());
+    stats[u"detached-sessions"_s] = d->detachedSessions.size();
     return stats;
 }
 
+///
+/// Returns the number of worker threads that run client connections.
+///
+/// \since QXmpp 1.13
+///
+int QXmppServer::workerThreadCount() const
+{
+    return d->workerThreadCount;
+}
+
+///
+/// Sets the number of worker threads that run client connections.
+///
+/// With the default of 0, all streams run in the thread of the server. Otherwise each incoming
+/// client connection is handed to the worker with the fewest connections, which then does the TLS
+/// handshake, XML parsing and authentication of the stream. Received stanzas are still routed and
+/// handled by the extensions in the thread of the server. The password checker is called from the
+/// worker threads and needs to be thread-safe.
+///
+/// This needs to be set before listenForClients() is called.
+///
+/// \since QXmpp 1.13
+///
+void QXmppServer::setWorkerThreadCount(int count)
+{
+    if (!d->workers.empty()) {
+        d->warning(u"Worker threads can not be changed while the server is listening"_s);
+        return;
+    }
+    d->workerThreadCount = std::max(count, 0);
+}
+
+///
+/// Returns the number of seconds a client session is kept after its connection has been lost,
+/// so the client can resume it (XEP-0198: Stream Management).
+///
+/// \since QXmpp 1.13
+///
+int QXmppServer::streamResumptionTimeout() const
+{
+    return d->streamResumptionTimeout;
+}
+
+///
+/// Sets the number of seconds a client session is kept after its connection has been lost.
+///
+/// While the session is detached, it stays available: stanzas to the client are queued and sent
+/// when the client resumes the session, and no unavailable presence is broadcast. The default is
+/// 300 seconds, 0 disables resumption. The setting applies to new connections.
+///
+/// \since QXmpp 1.13
+///
+void QXmppServer::setStreamResumptionTimeout(int secs)
+{
+    d->streamResumptionTimeout = std::max(secs, 0);
+}
+
+///
+/// Returns the maximum size in bytes of the stanzas that have not been acknowledged by a client.
+///
+/// \since QXmpp 1.13
+///
+qsizetype QXmppServer::streamManagementQueueLimit() const
+{
+    return d->streamManagementQueueLimit;
+}
+
+///
+/// Sets the maximum size in bytes of the stanzas that have not been acknowledged by a client.
+///
+/// A client that exceeds the limit is disconnected with a resource-constraint stream error and a
+/// detached session that exceeds it is dropped. The default is 256 KiB. The setting applies to
+/// new connections.
+///
+/// \since QXmpp 1.13
+///
+void QXmppServer::setStreamManagementQueueLimit(qsizetype bytes)
+{
+    d->streamManagementQueueLimit = bytes;
+}
+
+///
+/// Returns the maximum memory in bytes used by all detached sessions.
+///
+/// \since QXmpp 1.13
+///
+qsizetype QXmppServer::detachedSessionsMemoryLimit() const
+{
+    return d->detachedSessionsMemoryLimit;
+}
+
+///
+/// Sets the maximum memory in bytes used by all detached sessions.
+///
+/// When the limit is exceeded, the sessions that have been detached first are dropped. The memory
+/// of a session is estimated from its queued stanzas and a fixed overhead. The default is 64 MiB.
+///
+/// \since QXmpp 1.13
+///
+void QXmppServer::setDetachedSessionsMemoryLimit(qsizetype bytes)
+{
+    d->detachedSessionsMemoryLimit = bytes;
+}
+
+///
+/// Returns the maximum size in bytes of the stanzas queued for a remote domain while the
+/// server-to-server stream is being established.
+///
+/// \since QXmpp 1.13
+///
+qsizetype QXmppServer::outgoingServerQueueLimit() const
+{
+    return d->outgoingServerQueueLimit;
+}
+
+///
+/// Sets the maximum size in bytes of the stanzas queued for a remote domain while the
+/// server-to-server stream is being established.
+///
+/// When the limit is exceeded, the oldest stanzas are dropped and their senders receive a
+/// remote-server-timeout error. The same happens to all queued stanzas when the stream can not be
+/// established. The default is 1 MiB. The setting applies to new streams.
+///
+/// \since QXmpp 1.13
+///
+void QXmppServer::setOutgoingServerQueueLimit(qsizetype bytes)
+{
+    d->outgoingServerQueueLimit = bytes;
+}
+
 /// Sets the path for additional SSL CA certificates.
 void QXmppServer::addCaCertificates(const QString &path)
 {
@@ -523,6 +1142,13 @@ bool QXmppServer::listenForClients(const QHostAddress &address, quint16 port)
                     this, SLOT(_q_clientConnection(QSslSocket *)));
     Q_ASSERT(check);
 
+    if (d->workerThreadCount > 0) {
+        d->startWorkers();
+        server->d->descriptorHandler = [this](qintptr socketDescriptor, const SslSocketConfig &config) {
+            d->dispatchClientConnection(socketDescriptor, config);
+        };
+    }
+
     if (!server->listen(address, port)) {
         d->warning(u"Could not start listening for C2S on %1 %2"_s.arg(address.toString(), QString::number(port)));
         delete server;
@@ -555,9 +1181,11 @@ void QXmppServer::close()
     d->stopExtensions();
 
     // close XMPP streams
-    QSetIterator<QXmppIncomingClient *> itr(d->incomingClients);
-    while (itr.hasNext()) {
-        itr.next()->disconnectFromHost();
+    QReadLocker locker(&d->routingLock);
+    const auto incomingClients = d->incomingClients;
+    locker.unlock();
+    for (auto *stream : incomingClients) {
+        invokeInThread(stream, [](auto *stream) { stream->disconnectFromHost(); });
     }
     for (auto *stream : std::as_const(d->incomingServers)) {
         stream->disconnectFromHost();
@@ -631,18 +1259,15 @@ bool QXmppServer::sendPacket(const QXmppStanza &packet)
 /// This method can be used for instance to implement BOSH support
 /// as a server extension.
 ///
+/// The stream may live in another thread than the server, its signals are then
+/// delivered to the server using queued connections.
+///
 void QXmppServer::addIncomingClient(QXmppIncomingClient *stream)
 {
-
     stream->setPasswordChecker(d->passwordChecker);
-
-    connect(stream, &QXmppIncomingClient::connected, this, &QXmppServer::_q_clientConnected);
-    connect(stream, &QXmppIncomingClient::disconnected, this, &QXmppServer::_q_clientDisconnected);
-    connect(stream, &QXmppIncomingClient::elementReceived, this, &QXmppServer::handleElement);
-
-    // add stream
-    d->incomingClients.insert(stream);
-    Q_EMIT setGauge(u"incoming-client.count"_s, d->incomingClients.size());
+    stream->setStreamManagementQueueLimit(d->streamManagementQueueLimit);
+    stream->setStreamResumptionTimeout(d->streamResumptionTimeout);
+    d->registerIncomingClient(stream);
 }
 
 /// Handle a new incoming TCP connection from a client.
@@ -654,36 +1279,18 @@ void QXmppServer::_q_clientConnection(QSslSocket *socket)
         return;
     }
 
+    if (!d->idleTimeouts) {
+        d->idleTimeouts = createIdleTimerWheel();
+    }
+
     auto *stream = new QXmppIncomingClient(socket, d->domain, this);
-    stream->setInactivityTimeout(120);
+    stream->setIdleTimerWheel(d->idleTimeouts.get());
+    stream->setInactivityTimeout(CLIENT_INACTIVITY_TIMEOUT);
+    stream->setMetrics(d->clientMetrics);
     socket->setParent(stream);
     addIncomingClient(stream);
 }
 
-/// Handle a successful stream connection for a client.
-void QXmppServer::_q_clientConnected()
-{
-    auto *client = qobject_cast<QXmppIncomingClient *>(sender());
-    if (!client) {
-        return;
-    }
-
-    // FIXME: at this point the JID must contain a resource, assert it?
-    const QString jid = client->jid();
-
-    // check whether the connection conflicts with another one
-    QXmppIncomingClient *old = d->incomingClientsByJid.value(jid);
-    if (old && old != client) {
-        old->sendData("<stream:error><conflict xmlns='urn:ietf:params:xml:ns:xmpp-streams'/><text xmlns='urn:ietf:params:xml:ns:xmpp-streams'>Replaced by new connection</text></stream:error>");
-        old->disconnectFromHost();
-    }
-    d->incomingClientsByJid.insert(jid, client);
-    d->incomingClientsByBareJid[QXmppUtils::jidToBareJid(jid)].insert(client);
-
-    // emit signal
-    Q_EMIT clientConnected(jid);
-}
-
 /// Handle a stream disconnection for a client.
 void QXmppServer::_q_clientDisconnected()
 {
@@ -692,6 +1299,11 @@ void QXmppServer::_q_clientDisconnected()
         return;
     }
 
+    if (d->removeDetachedSession(client)) {
+        Q_EMIT setGauge(u"incoming-client.detached-count"_s, d->detachedSessions.size());
+    }
+
+    QWriteLocker locker(&d->routingLock);
     if (d->incomingClients.remove(client)) {
         // remove stream from routing tables
         const QString jid = client->jid();
@@ -707,6 +1319,8 @@ void QXmppServer::_q_clientDisconnected()
                 }
             }
         }
+        const auto count = d->incomingClients.size();
+        locker.unlock();
 
         // destroy client
         client->deleteLater();
@@ -717,7 +1331,7 @@ void QXmppServer::_q_clientDisconnected()
         }
 
         // update counter
-        Q_EMIT setGauge(u"incoming-client.count"_s, d->incomingClients.size());
+        Q_EMIT setGauge(u"incoming-client.count"_s, count);
     }
 }
 
@@ -730,11 +1344,7 @@ void QXmppServer::_q_dialbackRequestReceived(const QXmppDialback &dialback)
 
     if (dialback.command() == QXmppDialback::Verify) {
         // handle a verify request
-        for (auto *out : std::as_const(d->outgoingServers)) {
-            if (out->remoteDomain() != dialback.from()) {
-                continue;
-            }
-
+        if (auto *out = d->outgoingServers.value(dialback.from())) {
             bool isValid = dialback.key() == out->localStreamKey();
             QXmppDialback verify;
             verify.setCommand(QXmppDialback::Verify);
@@ -743,7 +1353,6 @@ void QXmppServer::_q_dialbackRequestReceived(const QXmppDialback &dialback)
             verify.setFrom(d->domain);
             verify.setType(isValid ? u"valid"_s : u"invalid"_s);
             stream->sendPacket(verify);
-            return;
         }
     }
 }
@@ -751,7 +1360,7 @@ void QXmppServer::_q_dialbackRequestReceived(const QXmppDialback &dialback)
 /// Handle an incoming XML element.
 void QXmppServer::handleElement(const QDomElement &element)
 {
-    handleStanza(this, element);
+    d->handleStanza(element, {});
 }
 
 /// Handle a stream disconnection for an outgoing server.
@@ -762,7 +1371,9 @@ void QXmppServer::_q_outgoingServerDisconnected()
         return;
     }
 
-    if (d->outgoingServers.remove(outgoing)) {
+    const auto itr = d->outgoingServers.constFind(outgoing->remoteDomain());
+    if (itr != d->outgoingServers.cend() && *itr == outgoing) {
+        d->outgoingServers.erase(itr);
         outgoing->deleteLater();
         Q_EMIT setGauge(u"outgoing-server.count"_s, d->outgoingServers.size());
     }
@@ -787,8 +1398,10 @@ void QXmppServer::_q_serverConnection(QSslSocket *socket)
     connect(stream, &QXmppIncomingServer::dialbackRequestReceived,
             this, &QXmppServer::_q_dialbackRequestReceived);
 
-    connect(stream, &QXmppIncomingServer::elementReceived,
-            this, &QXmppServer::handleElement);
+    connect(stream, &QXmppIncomingServer::elementDataReceived,
+            this, [this](const QDomElement &element, const QByteArray &data) {
+                d->handleStanza(element, data);
+            });
 
     // add stream
     d->incomingServers.insert(stream);
@@ -809,14 +1422,6 @@ void QXmppServer::_q_serverDisconnected()
     }
 }
 
-class QXmppSslServerPrivate
-{
-public:
-    QList<QSslCertificate> caCertificates;
-    QSslCertificate localCertificate;
-    QSslKey privateKey;
-};
-
 /// Constructs a new SSL server instance.
 QXmppSslServer::QXmppSslServer(QObject *parent)
     : QTcpServer(parent),
@@ -828,22 +1433,15 @@ QXmppSslServer::~QXmppSslServer() = default;
 
 void QXmppSslServer::incomingConnection(qintptr socketDescriptor)
 {
-    auto *socket = new QSslSocket;
-    if (!socket->setSocketDescriptor(socketDescriptor)) {
-        delete socket;
+    if (d->descriptorHandler) {
+        // the socket is created in the thread that is going to use it
+        d->descriptorHandler(socketDescriptor, d->config);
         return;
     }
 
-    if (!d->localCertificate.isNull() && !d->privateKey.isNull()) {
-        auto sslConfig = socket->sslConfiguration();
-        sslConfig.setCaCertificates(sslConfig.caCertificates() + d->caCertificates);
-        socket->setSslConfiguration(sslConfig);
-
-        socket->setProtocol(QSsl::AnyProtocol);
-        socket->setLocalCertificate(d->localCertificate);
-        socket->setPrivateKey(d->privateKey);
+    if (auto *socket = d->config.createSocket(socketDescriptor)) {
+        Q_EMIT newConnection(socket);
     }
-    Q_EMIT newConnection(socket);
 }
 
 ///
@@ -852,17 +1450,17 @@ void QXmppSslServer::incomingConnection(qintptr socketDescriptor)
 ///
 void QXmppSslServer::addCaCertificates(const QList<QSslCertificate> &certificates)
 {
-    d->caCertificates += certificates;
+    d->config.caCertificates += certificates;
 }
 
 /// Sets the local certificate to be used for incoming connections.
 void QXmppSslServer::setLocalCertificate(const QSslCertificate &certificate)
 {
-    d->localCertificate = certificate;
+    d->config.localCertificate = certificate;
 }
 
 /// Sets the local private key to be used for incoming connections.
 void QXmppSslServer::setPrivateKey(const QSslKey &key)
 {
-    d->privateKey = key;
+    d->config.privateKey = key;
 }
@@ -24,6 +24,7 @@ class QXmppServerExtension;
 class QXmppServerPrivate;
 class QXmppSslServer;
 class QXmppStanza;
+class tst_QXmppBenchmark;
 
 ///
 /// \brief The QXmppServer class represents an XMPP server.
@@ -63,6 +64,18 @@ public:
 
     QVariantMap statistics() const;
 
+    int workerThreadCount() const;
+    void setWorkerThreadCount(int count);
+
+    int streamResumptionTimeout() const;
+    void setStreamResumptionTimeout(int secs);
+    qsizetype streamManagementQueueLimit() const;
+    void setStreamManagementQueueLimit(qsizetype bytes);
+    qsizetype detachedSessionsMemoryLimit() const;
+    void setDetachedSessionsMemoryLimit(qsizetype bytes);
+    qsizetype outgoingServerQueueLimit() const;
+    void setOutgoingServerQueueLimit(qsizetype bytes);
+
     void addCaCertificates(const QString &caCertificates);
     void setLocalCertificate(const QString &path);
     void setLocalCertificate(const QSslCertificate &certificate);
@@ -93,7 +106,6 @@ public Q_SLOTS:
 
 private Q_SLOTS:
     void _q_clientConnection(QSslSocket *socket);
-    void _q_clientConnected();
     void _q_clientDisconnected();
     void _q_dialbackRequestReceived(const QXmppDialback &dialback);
     void _q_outgoingServerDisconnected();
@@ -102,6 +114,7 @@ private Q_SLOTS:
 
 private:
     friend class QXmppServerPrivate;
+    friend class ::tst_QXmppBenchmark;
     const std::unique_ptr<QXmppServerPrivate> d;
 };
 
@@ -129,6 +142,7 @@ Q_SIGNALS:
 private:
     void incomingConnection(qintptr socketDescriptor) override;
     const std::unique_ptr<QXmppSslServerPrivate> d;
+    friend class QXmppServer;
 };
 
 #endif
@@ -66,6 +66,9 @@ int QXmppServerExtension::extensionPriority() const
 ///
 /// Return true if no further processing should occur, false otherwise.
 ///
+/// Stanzas that are not handled must not be modified: they may be routed using
+/// the XML they were received as.
+///
 /// \param stanza The received stanza.
 ///
 bool QXmppServerExtension::handleStanza(const QDomElement &stanza)
@@ -107,6 +110,35 @@ void QXmppServerExtension::stop()
 {
 }
 
+///
+/// Returns the kinds of stanzas handleStanza() is called for.
+///
+/// The server reads this once when it starts the extensions. The default
+/// implementation returns AnyStanza.
+///
+/// \since QXmpp 1.13
+///
+QXmppServerExtension::StanzaTypes QXmppServerExtension::handledStanzaTypes() const
+{
+    return AnyStanza;
+}
+
+///
+/// Returns the namespaces of the payloads handleStanza() is called for.
+///
+/// A stanza is only passed to the extension if one of its child elements has
+/// one of the namespaces, e.g. the query of an IQ. An empty list, the default,
+/// means the extension is called for all stanzas of the handledStanzaTypes().
+///
+/// The server reads this once when it starts the extensions.
+///
+/// \since QXmpp 1.13
+///
+QStringList QXmppServerExtension::handledNamespaces() const
+{
+    return {};
+}
+
 /// Returns the server which loaded this extension.
 QXmppServer *QXmppServerExtension::server() const
 {
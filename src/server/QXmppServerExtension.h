@@ -23,13 +23,27 @@ class QXmppServerExtensionPrivate;
 /// and implement handleStanza(). You can then add your extension to the
 /// client instance using QXmppServer::addExtension().
 ///
+/// By default an extension is offered every stanza. Extensions that only
+/// handle some stanzas should implement handledStanzaTypes() and
+/// handledNamespaces(), the server then skips them for all other stanzas.
+///
 /// \ingroup Core
 ///
 class QXMPP_EXPORT QXmppServerExtension : public QXmppLoggable
 {
     Q_OBJECT
+    Q_FLAGS(StanzaType StanzaTypes)
 
 public:
+    /// Kind of stanza
+    enum StanzaType {
+        MessageStanza = 1 << 0,  ///< \<message/\>
+        PresenceStanza = 1 << 1,  ///< \<presence/\>
+        IqStanza = 1 << 2,  ///< \<iq/\>
+        AnyStanza = MessageStanza | PresenceStanza | IqStanza,  ///< All kinds of stanzas
+    };
+    Q_DECLARE_FLAGS(StanzaTypes, StanzaType)
+
     QXmppServerExtension();
     ~QXmppServerExtension() override;
     virtual QString extensionName() const;
@@ -44,6 +58,9 @@ public:
     virtual bool start();
     virtual void stop();
 
+    virtual StanzaTypes handledStanzaTypes() const;
+    virtual QStringList handledNamespaces() const;
+
 protected:
     QXmppServer *server() const;
 
@@ -54,4 +71,6 @@ private:
     friend class QXmppServer;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(QXmppServerExtension::StanzaTypes)
+
 #endif
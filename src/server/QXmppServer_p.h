@@ -0,0 +1,192 @@
+// SPDX-FileCopyrightText: 2010 Jeremy Lainé <jeremy.laine@m4x.org>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QXmpp API.
+//
+// This header file may change from version to version without notice,
+// or even be removed.
+//
+// We mean it.
+//
+
+#ifndef QXMPPSERVER_P_H
+#define QXMPPSERVER_P_H
+
+#include "QXmppGlobal.h"
+#include "QXmppLogger.h"
+#include "QXmppMetrics.h"
+#include "QXmppStanza.h"
+
+#include "TimerWheel.h"
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QThread>
+
+class QDomElement;
+class QSslSocket;
+class QXmppIncomingClient;
+class QXmppIncomingServer;
+class QXmppLogger;
+class QXmppOutgoingServer;
+class QXmppPasswordChecker;
+class QXmppServer;
+class QXmppServerExtension;
+class QXmppSslServer;
+
+namespace QXmpp::Private {
+struct StreamMetrics;
+}
+
+// SSL settings for the sockets of incoming connections.
+struct SslSocketConfig {
+    QSslSocket *createSocket(qintptr socketDescriptor) const;
+
+    QList<QSslCertificate> caCertificates;
+    QSslCertificate localCertificate;
+    QSslKey privateKey;
+};
+
+// Thread with its own event loop that runs a share of the client connections.
+struct ServerWorker {
+    QThread thread;
+    // lives in the worker thread and is the parent of its streams
+    QObject *context = nullptr;
+    std::atomic<int> connections = 0;
+    // inactivity timeouts of the streams, only used in the worker thread
+    std::unique_ptr<QXmpp::Private::TimerWheel> idleTimeouts;
+};
+
+// Extension with the handle of the histogram of its handling time.
+struct ExtensionHandler {
+    QXmppServerExtension *extension = nullptr;
+    QXmppMetrics::Histogram *handlingTime = nullptr;
+};
+
+// Extensions that handle one kind of stanza, as indices into QXmppServerPrivate::extensionHandlers.
+// The extensions are called in the order of their indices.
+struct ExtensionRoutes {
+    // extensions without handled namespaces
+    QList<qsizetype> anyNamespace;
+    // by namespace of a child element of the stanza
+    QHash<QString, QList<qsizetype>> byNamespace;
+};
+
+// Client session that lost its connection and can be resumed (XEP-0198).
+struct DetachedSession {
+    QXmppIncomingClient *client = nullptr;
+    QString jid;
+    // approximate memory used by the session
+    qsizetype size = 0;
+    // position in QXmppServerPrivate::detachedSessionOrder
+    quint64 order = 0;
+};
+
+class QXmppServerPrivate
+{
+public:
+    QXmppServerPrivate(QXmppServer *qq);
+    void loadExtensions(QXmppServer *server);
+    QXMPP_EXPORT bool routeData(const QString &to, const QByteArray &data);
+    void bounceData(const QByteArray &data);
+    void handleStanza(const QDomElement &element, const QByteArray &data);
+    bool dispatchToExtensions(const QDomElement &element);
+    void buildExtensionRoutes();
+    void sendIqError(const QDomElement &request, const QString &from, QXmppStanza::Error::Condition condition);
+    void startExtensions();
+    void stopExtensions();
+    void startWorkers();
+    void stopWorkers();
+    void dispatchClientConnection(qintptr socketDescriptor, const SslSocketConfig &config);
+    void registerIncomingClient(QXmppIncomingClient *stream);
+    void relayLogMessages(QXmppIncomingClient *stream, QXmppLogger::MessageTypes types);
+    void updateRelayedMessageTypes();
+    void clientConnected(QXmppIncomingClient *client, const QString &jid);
+    void addDetachedSession(QXmppIncomingClient *client, const QString &id, qsizetype queuedBytes);
+    bool removeDetachedSession(QXmppIncomingClient *client);
+    void resumeSession(QXmppIncomingClient *client, const QString &id);
+    void replaceClient(QXmppIncomingClient *oldClient, QXmppIncomingClient *client, const QString &jid);
+    void updateMetrics();
+
+    void info(const QString &message);
+    void warning(const QString &message);
+
+    QString domain;
+    QList<QXmppServerExtension *> extensions;
+    // built from the extensions when they are started, only used in the thread of the server
+    std::vector<ExtensionHandler> extensionHandlers;
+    // for messages, presences and IQs
+    std::array<ExtensionRoutes, 3> extensionRoutes;
+    bool extensionRoutesValid = false;
+    QXmppLogger *logger;
+    QXmppPasswordChecker *passwordChecker;
+
+    // metrics handles of the logger, only used in the thread of the server
+    std::shared_ptr<QXmpp::Private::StreamMetrics> clientMetrics;
+    QXmppMetrics::Histogram *routeTime = nullptr;
+
+    // client-to-server, the tables are guarded by routingLock because clients are added from
+    // the worker threads
+    mutable QReadWriteLock routingLock;
+    QSet<QXmppIncomingClient *> incomingClients;
+    QHash<QString, QXmppIncomingClient *> incomingClientsByJid;
+    QHash<QString, QSet<QXmppIncomingClient *>> incomingClientsByBareJid;
+    // logged message types of the streams that are no children of the server
+    QXmppLogger::MessageTypes relayedMessageTypes = QXmppLogger::NoMessage;
+    QSet<QXmppSslServer *> serversForClients;
+    // inactivity timeouts of the streams in the thread of the server
+    std::unique_ptr<QXmpp::Private::TimerWheel> idleTimeouts;
+
+    // server-to-server
+    QSet<QXmppIncomingServer *> incomingServers;
+    // by remote domain, there is at most one outgoing stream per domain
+    QHash<QString, QXmppOutgoingServer *> outgoingServers;
+    qsizetype outgoingServerQueueLimit = 1024 * 1024;
+    // data queued by all outgoing streams until they are ready
+    qsizetype outgoingQueuedStanzas = 0;
+    qsizetype outgoingQueuedBytes = 0;
+    QSet<QXmppSslServer *> serversForServers;
+
+    // ssl
+    QList<QSslCertificate> caCertificates;
+    QSslCertificate localCertificate;
+    QSslKey privateKey;
+
+    // stream management, the detached sessions are only used in the thread of the server
+    int streamResumptionTimeout = 300;
+    qsizetype streamManagementQueueLimit = 256 * 1024;
+    qsizetype detachedSessionsMemoryLimit = 64 * 1024 * 1024;
+    QHash<QString, DetachedSession> detachedSessions;
+    QHash<QXmppIncomingClient *, QString> detachedSessionIds;
+    // resumption ids in the order the sessions were detached, the oldest are dropped first
+    std::map<quint64, QString> detachedSessionOrder;
+    quint64 detachedSessionCounter = 0;
+    qsizetype detachedSessionsSize = 0;
+
+    // worker threads
+    int workerThreadCount = 0;
+    std::vector<std::unique_ptr<ServerWorker>> workers;
+
+private:
+    bool loaded;
+    bool started;
+    QXmppServer *q;
+};
+
+#endif  // QXMPPSERVER_P_H
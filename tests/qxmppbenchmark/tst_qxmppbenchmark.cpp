@@ -0,0 +1,524 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "QXmppClient.h"
+#include "QXmppDataForm.h"
+#include "QXmppIncomingClient.h"
+#include "QXmppIncomingClient_p.h"
+#include "QXmppMessage.h"
+#include "QXmppOutgoingServer.h"
+#include "QXmppPresence.h"
+#include "QXmppRosterManager.h"
+#include "QXmppServer.h"
+#include "QXmppServer_p.h"
+#include "QXmppStun.h"
+#include "QXmppUtils.h"
+#include "QXmppUtils_p.h"
+
+#include "Algorithms.h"
+#include "TimerWheel.h"
+#include "XmppSocket.h"
+#include "util.h"
+
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include <QBuffer>
+#include <QFile>
+#include <QObject>
+#include <QSslSocket>
+#include <QXmlStreamWriter>
+
+using namespace QXmpp::Private;
+
+//
+// Allocation counting
+//
+// malloc() and friends are replaced to count the heap allocations done by an operation. This
+// includes allocations of Qt containers (which do not use operator new). Only available with glibc.
+//
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define COUNT_ALLOCATIONS 1
+
+static std::atomic<quint64> allocationCount = 0;
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+}
+#endif
+
+// Runs the operation once and reports the number of allocations it did.
+template<typename Function>
+static void reportAllocations(Function operation)
+{
+#ifdef COUNT_ALLOCATIONS
+    const auto before = allocationCount.load(std::memory_order_relaxed);
+    operation();
+    const auto allocations = allocationCount.load(std::memory_order_relaxed) - before;
+    qInfo("Allocations per operation: %llu", static_cast<unsigned long long>(allocations));
+#else
+    Q_UNUSED(operation)
+    qInfo("Allocations per operation: not available on this platform");
+#endif
+}
+
+//
+// Heap usage
+//
+// Uses the statistics of the glibc allocator (mallinfo2() is available since glibc 2.33).
+//
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#include <malloc.h>
+#if __GLIBC_PREREQ(2, 33)
+#define HAVE_MALLINFO2 1
+#endif
+#endif
+
+// Returns the number of bytes currently allocated on the heap.
+static std::optional<size_t> heapUsage()
+{
+#ifdef HAVE_MALLINFO2
+    return mallinfo2().uordblks;
+#else
+    return {};
+#endif
+}
+
+static QByteArray readCorpus(const QString &name)
+{
+    QFile file(u":/corpus/"_s + name);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qFatal("Could not open corpus %s", qPrintable(name));
+    }
+    return file.readAll();
+}
+
+// Returns the child elements of the root element of an XML corpus.
+static QList<QDomElement> readElementCorpus(const QString &name)
+{
+    const auto root = xmlToDom(readCorpus(name));
+
+    QList<QDomElement> elements;
+    for (auto el = root.firstChildElement(); !el.isNull(); el = el.nextSiblingElement()) {
+        elements.append(el);
+    }
+    return elements;
+}
+
+template<typename T>
+static QList<T> parseCorpus(const QList<QDomElement> &elements)
+{
+    return transform<QList<T>>(elements, [](const QDomElement &el) {
+        T packet;
+        packet.parse(el);
+        return packet;
+    });
+}
+
+static QList<QByteArray> readStunCorpus()
+{
+    QList<QByteArray> packets;
+    const auto lines = readCorpus(u"stun.txt"_s).split('\n');
+    for (const auto &line : lines) {
+        const auto trimmed = line.trimmed();
+        if (!trimmed.isEmpty() && !trimmed.startsWith('#')) {
+            packets.append(QByteArray::fromHex(trimmed));
+        }
+    }
+    return packets;
+}
+
+class tst_QXmppBenchmark : public QObject
+{
+    Q_OBJECT
+
+private:
+    Q_SLOT void processData_data();
+    Q_SLOT void processData();
+    Q_SLOT void messageParse();
+    Q_SLOT void messageToXml();
+    Q_SLOT void presenceParse();
+    Q_SLOT void dataFormParse();
+    Q_SLOT void stunDecode();
+    Q_SLOT void stunEncode();
+    Q_SLOT void serializeXml_data();
+    Q_SLOT void serializeXml();
+    Q_SLOT void rosterPresences_data();
+    Q_SLOT void rosterPresences();
+    Q_SLOT void routeData();
+    Q_SLOT void idleClients_data();
+    Q_SLOT void idleClients();
+};
+
+void tst_QXmppBenchmark::processData_data()
+{
+    QTest::addColumn<bool>("raw");
+
+    QTest::newRow("utf16") << false;
+    QTest::newRow("utf8") << true;
+}
+
+void tst_QXmppBenchmark::processData()
+{
+    QFETCH(bool, raw);
+
+    // split into stream header and stanzas, so the stanzas can be processed repeatedly
+    const auto corpus = readCorpus(u"stream.xml"_s);
+    const auto headerEnd = corpus.indexOf('>', corpus.indexOf("<stream:stream")) + 1;
+    const auto header = corpus.left(headerEnd);
+    const auto stanzas = corpus.mid(headerEnd);
+
+    // count only, a QSignalSpy would copy every stanza
+    XmppSocket socket(this);
+    qsizetype stanzaCount = 0;
+    connect(&socket, &XmppSocket::stanzaReceived, this, [&] { stanzaCount++; });
+    socket.processRawData(header);
+
+    auto process = [&] {
+        if (raw) {
+            socket.processRawData(stanzas);
+        } else {
+            // the UTF-16 path includes the conversion the socket had to do before
+            socket.processData(QString::fromUtf8(stanzas));
+        }
+    };
+
+    process();
+    const auto corpusStanzas = stanzaCount;
+    QVERIFY(corpusStanzas > 0);
+
+    reportAllocations(process);
+    QBENCHMARK {
+        process();
+    }
+    QCOMPARE(stanzaCount % corpusStanzas, 0);
+}
+
+void tst_QXmppBenchmark::messageParse()
+{
+    const auto elements = readElementCorpus(u"messages.xml"_s);
+    QVERIFY(!elements.isEmpty());
+
+    auto parse = [&] {
+        for (const auto &el : elements) {
+            QXmppMessage message;
+            message.parse(el);
+        }
+    };
+
+    reportAllocations(parse);
+    QBENCHMARK {
+        parse();
+    }
+}
+
+void tst_QXmppBenchmark::messageToXml()
+{
+    const auto messages = parseCorpus<QXmppMessage>(readElementCorpus(u"messages.xml"_s));
+    QVERIFY(!messages.isEmpty());
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    auto serialize = [&] {
+        buffer.seek(0);
+        QXmlStreamWriter writer(&buffer);
+        for (const auto &message : messages) {
+            message.toXml(&writer);
+        }
+    };
+
+    reportAllocations(serialize);
+    QBENCHMARK {
+        serialize();
+    }
+}
+
+void tst_QXmppBenchmark::presenceParse()
+{
+    const auto elements = readElementCorpus(u"presences.xml"_s);
+    QVERIFY(!elements.isEmpty());
+
+    auto parse = [&] {
+        for (const auto &el : elements) {
+            QXmppPresence presence;
+            presence.parse(el);
+        }
+    };
+
+    reportAllocations(parse);
+    QBENCHMARK {
+        parse();
+    }
+}
+
+void tst_QXmppBenchmark::dataFormParse()
+{
+    const auto elements = readElementCorpus(u"dataforms.xml"_s);
+    QVERIFY(!elements.isEmpty());
+
+    auto parse = [&] {
+        for (const auto &el : elements) {
+            QXmppDataForm form;
+            form.parse(el);
+        }
+    };
+
+    reportAllocations(parse);
+    QBENCHMARK {
+        parse();
+    }
+}
+
+void tst_QXmppBenchmark::stunDecode()
+{
+    const auto packets = readStunCorpus();
+    QVERIFY(!packets.isEmpty());
+    for (const auto &packet : packets) {
+        QXmppStunMessage message;
+        QVERIFY(message.decode(packet));
+    }
+
+    auto decode = [&] {
+        for (const auto &packet : packets) {
+            QXmppStunMessage message;
+            message.decode(packet);
+        }
+    };
+
+    reportAllocations(decode);
+    QBENCHMARK {
+        decode();
+    }
+}
+
+void tst_QXmppBenchmark::stunEncode()
+{
+    QList<QXmppStunMessage> messages;
+    for (const auto &packet : readStunCorpus()) {
+        QXmppStunMessage message;
+        QVERIFY(message.decode(packet));
+        messages.append(message);
+    }
+
+    // password of the RFC 5769 test vectors
+    const auto key = QByteArrayLiteral("VOkJxbRl1RmTxUk/WvJxBt");
+    auto encode = [&] {
+        for (const auto &message : std::as_const(messages)) {
+            message.encode(key, true);
+        }
+    };
+
+    reportAllocations(encode);
+    QBENCHMARK {
+        encode();
+    }
+}
+
+void tst_QXmppBenchmark::serializeXml_data()
+{
+    QTest::addColumn<QString>("corpus");
+
+    QTest::newRow("messages") << u"messages.xml"_s;
+    QTest::newRow("presences") << u"presences.xml"_s;
+}
+
+void tst_QXmppBenchmark::serializeXml()
+{
+    QFETCH(QString, corpus);
+
+    const auto elements = readElementCorpus(corpus);
+    QVERIFY(!elements.isEmpty());
+
+    std::function<void()> serialize;
+    if (corpus == u"messages.xml") {
+        serialize = [messages = parseCorpus<QXmppMessage>(elements)] {
+            for (const auto &message : messages) {
+                QXmpp::Private::serializeXml(message);
+            }
+        };
+    } else {
+        serialize = [presences = parseCorpus<QXmppPresence>(elements)] {
+            for (const auto &presence : presences) {
+                QXmpp::Private::serializeXml(presence);
+            }
+        };
+    }
+
+    reportAllocations(serialize);
+    QBENCHMARK {
+        serialize();
+    }
+}
+
+void tst_QXmppBenchmark::rosterPresences_data()
+{
+    QTest::addColumn<int>("contacts");
+    QTest::addColumn<bool>("fullPresences");
+
+    QTest::newRow("10k-full") << 10'000 << true;
+    QTest::newRow("10k-compact") << 10'000 << false;
+    QTest::newRow("100k-full") << 100'000 << true;
+    QTest::newRow("100k-compact") << 100'000 << false;
+}
+
+void tst_QXmppBenchmark::rosterPresences()
+{
+    QFETCH(int, contacts);
+    QFETCH(bool, fullPresences);
+
+    QXmppClient client(QXmppClient::NoExtensions);
+    auto *manager = client.addNewExtension<QXmppRosterManager>(&client);
+    manager->setKeepFullPresences(fullPresences);
+
+    QStringList jids;
+    jids.reserve(contacts);
+    for (int i = 0; i < contacts; i++) {
+        jids.append(u"contact%1@example.org"_s.arg(i));
+    }
+
+    // typical presence of a mobile client, all strings are allocated like received ones
+    auto createPresence = [](const QString &bareJid) {
+        QXmppPresence presence;
+        presence.setFrom(bareJid + u"/Conversations.Xq3h"_s);
+        presence.setAvailableStatusType(QXmppPresence::Away);
+        presence.setStatusText(QString::fromUtf8("On the phone"));
+        presence.setCapabilityHash(QString::fromUtf8("sha-1"));
+        presence.setCapabilityNode(QString::fromUtf8("http://conversations.im"));
+        presence.setCapabilityVer(QByteArray::fromBase64("IqsvQwkTr+FLDf0ZwqStyvcJ4Cs="));
+        presence.setVCardUpdateType(QXmppPresence::VCardUpdateValidPhoto);
+        presence.setPhotoHash(QByteArray::fromHex("01b87fcd030b72895ff8e88db57ec525450f000d"));
+        return presence;
+    };
+
+    const auto before = heapUsage();
+    for (const auto &jid : std::as_const(jids)) {
+        Q_EMIT client.presenceReceived(createPresence(jid));
+    }
+    const auto after = heapUsage();
+
+    if (before && after) {
+        const auto bytes = *after - *before;
+        qInfo("Heap usage: %zu bytes, %zu bytes per contact", bytes, bytes / size_t(contacts));
+    } else {
+        qInfo("Heap usage: not available on this platform");
+    }
+
+    QBENCHMARK {
+        for (const auto &jid : std::as_const(jids)) {
+            manager->presences(jid);
+        }
+    }
+    QCOMPARE(manager->presences(jids.constLast()).size(), 1);
+}
+
+void tst_QXmppBenchmark::routeData()
+{
+    const auto testDomain = u"example.com"_s;
+    const int clientCount = 1000;
+    const int remoteDomainCount = 50;
+    const int stanzaCount = 100000;
+
+    QXmppServer server;
+    server.setDomain(testDomain);
+    // enables S2S routing
+    QVERIFY(server.listenForServers(QHostAddress::LocalHost, 0));
+
+    // register streams without connections, sending to them fails immediately
+    QStringList recipients;
+    for (int i = 0; i < clientCount; i++) {
+        const auto jid = u"user%1@%2/resource"_s.arg(QString::number(i), testDomain);
+        auto *client = new QXmppIncomingClient(new QSslSocket, testDomain, &server);
+        server.d->incomingClients.insert(client);
+        server.d->incomingClientsByJid.insert(jid, client);
+        server.d->incomingClientsByBareJid[QXmppUtils::jidToBareJid(jid)].insert(client);
+        recipients.append(jid);
+    }
+    for (int i = 0; i < remoteDomainCount; i++) {
+        const auto remoteDomain = u"remote%1.example.org"_s.arg(i);
+        server.d->outgoingServers.insert(remoteDomain, new QXmppOutgoingServer(testDomain, &server));
+        recipients.append(u"user@"_s + remoteDomain);
+    }
+
+    const QByteArray data = "<message type='chat'><body>Hello</body></message>";
+    qint64 routed = 0;
+    qint64 iterations = 0;
+    QBENCHMARK {
+        for (int i = 0; i < stanzaCount; i++) {
+            routed += server.d->routeData(recipients[i % recipients.size()], data);
+        }
+        iterations++;
+    }
+    QCOMPARE(routed, iterations * stanzaCount);
+}
+
+void tst_QXmppBenchmark::idleClients_data()
+{
+    QTest::addColumn<bool>("useWheel");
+
+    QTest::newRow("timer-per-client") << false;
+    QTest::newRow("timer-wheel") << true;
+}
+
+void tst_QXmppBenchmark::idleClients()
+{
+    QFETCH(bool, useWheel);
+    const int clientCount = 50000;
+
+    // idle streams without connections, like the server keeps them for connected clients
+    QObject parent;
+    auto wheel = createIdleTimerWheel();
+    std::vector<QXmppIncomingClient *> clients;
+    clients.reserve(clientCount);
+
+    const auto before = heapUsage();
+    for (int i = 0; i < clientCount; i++) {
+        auto *client = new QXmppIncomingClient(new QSslSocket, u"example.com"_s, &parent);
+        if (useWheel) {
+            client->setIdleTimerWheel(wheel.get());
+        }
+        client->setInactivityTimeout(120);
+        clients.push_back(client);
+    }
+    const auto after = heapUsage();
+
+    if (before && after) {
+        qInfo("Heap usage: %zu bytes per idle client", (*after - *before) / size_t(clientCount));
+    } else {
+        qInfo("Heap usage: not available on this platform");
+    }
+
+    // every client receives a stanza, followed by one tick of the wheel
+    const auto ack = xmlToDom(u"<a xmlns='urn:xmpp:sm:3' h='0'/>"_s);
+    QBENCHMARK {
+        for (auto *client : clients) {
+            client->handleStanza(ack);
+        }
+        wheel->processExpired();
+    }
+}
+
+QTEST_MAIN(tst_QXmppBenchmark)
+#include "tst_qxmppbenchmark.moc"
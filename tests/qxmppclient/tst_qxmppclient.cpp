@@ -33,7 +33,11 @@ class tst_QXmppClient : public QObject
 
 private:
     Q_SLOT void testSendMessage();
+    Q_SLOT void testLoggedMessageTypes();
     Q_SLOT void testIndexOfExtension();
+    Q_SLOT void extensionDispatch();
+    Q_SLOT void benchmarkExtensionDispatch_data();
+    Q_SLOT void benchmarkExtensionDispatch();
     Q_SLOT void testE2eeExtension();
     Q_SLOT void testTaskDirect();
     Q_SLOT void testTaskStore();
@@ -46,6 +50,9 @@ private:
     // outgoing client
 #if BUILD_INTERNAL_TESTS
     Q_SLOT void csiManager();
+    Q_SLOT void streamManagementAckRequests();
+    Q_SLOT void streamManagementBackpressure();
+    Q_SLOT void iqTimeouts();
 #endif
 
     Q_SLOT void credentialsSerialization();
@@ -80,6 +87,76 @@ void tst_QXmppClient::testSendMessage()
     client->setLogger(nullptr);
 }
 
+class TestLoggable : public QXmppLoggable
+{
+public:
+    using QXmppLoggable::QXmppLoggable;
+    using QXmppLoggable::isLoggingEnabled;
+};
+
+void tst_QXmppClient::testLoggedMessageTypes()
+{
+    auto client = std::make_unique<QXmppClient>();
+
+    QXmppLogger logger;
+    client->setLogger(&logger);
+
+    int sentMessages = 0;
+    connect(&logger, &QXmppLogger::message, this, [&](QXmppLogger::MessageType type, const QString &) {
+        if (type == QXmppLogger::SentMessage) {
+            sentMessages++;
+        }
+    });
+
+    auto sendMessage = [&] {
+        client->sendLegacy(QXmppMessage({}, u"support@qxmpp.org"_s, u"implement XEP-* plz"_s));
+    };
+
+    // logger discards everything
+    sendMessage();
+    QCOMPARE(sentMessages, 0);
+
+    // filters are updated when the logger changes
+    logger.setLoggingType(QXmppLogger::SignalLogging);
+    logger.setMessageTypes(QXmppLogger::WarningMessage);
+    sendMessage();
+    QCOMPARE(sentMessages, 0);
+
+    logger.setMessageTypes(QXmppLogger::SentMessage | QXmppLogger::ReceivedMessage);
+    sendMessage();
+    QCOMPARE(sentMessages, 1);
+
+    // extensions added later inherit the filter
+    auto *versionManager = client->addNewExtension<QXmppVersionManager>();
+    QVERIFY(versionManager);
+    sendMessage();
+    QCOMPARE(sentMessages, 2);
+
+    // other receivers of the client's log messages get everything
+    logger.setMessageTypes(QXmppLogger::WarningMessage);
+    int clientLogMessages = 0;
+    auto connection = connect(client.get(), &QXmppLoggable::logMessage, this, [&](QXmppLogger::MessageType type, const QString &) {
+        if (type == QXmppLogger::SentMessage) {
+            clientLogMessages++;
+        }
+    });
+    sendMessage();
+    QCOMPARE(sentMessages, 2);
+    QCOMPARE(clientLogMessages, 1);
+
+    auto *loggable = new TestLoggable(client.get());
+    QVERIFY(loggable->isLoggingEnabled(QXmppLogger::SentMessage));
+
+    // the filter is narrowed down again once the other receiver is gone
+    disconnect(connection);
+    QVERIFY(!loggable->isLoggingEnabled(QXmppLogger::SentMessage));
+    QVERIFY(loggable->isLoggingEnabled(QXmppLogger::WarningMessage));
+    sendMessage();
+    QCOMPARE(clientLogMessages, 1);
+
+    client->setLogger(nullptr);
+}
+
 void tst_QXmppClient::testIndexOfExtension()
 {
     auto client = std::make_unique<QXmppClient>();
@@ -102,6 +179,109 @@ void tst_QXmppClient::testIndexOfExtension()
     QCOMPARE(client->indexOfExtension<QXmppVCardManager>(), 1);
 }
 
+class DispatchExtension : public QXmppClientExtension
+{
+public:
+    DispatchExtension(QList<StanzaFilter> filters = {}, bool accept = false)
+        : filters(std::move(filters)), accept(accept)
+    {
+    }
+
+    QList<StanzaFilter> stanzaFilters() const override { return filters; }
+    bool handleStanza(const QDomElement &) override
+    {
+        calls++;
+        return accept;
+    }
+
+    void inject(const QDomElement &iq) { injectIq(iq, std::nullopt); }
+
+    QList<StanzaFilter> filters;
+    bool accept;
+    int calls = 0;
+};
+
+void tst_QXmppClient::extensionDispatch()
+{
+    QXmppClient client;
+    for (auto *ext : client.extensions()) {
+        client.removeExtension(ext);
+    }
+
+    auto *fallback = client.addNewExtension<DispatchExtension>();
+    auto *ping = client.addNewExtension<DispatchExtension>(QList<DispatchExtension::StanzaFilter> { { u"iq"_s, u"ping"_s, u"urn:xmpp:ping"_s } });
+    auto *version = client.addNewExtension<DispatchExtension>(QList<DispatchExtension::StanzaFilter> { { u"iq"_s, {}, u"jabber:iq:version"_s } });
+    auto *messages = client.addNewExtension<DispatchExtension>(QList<DispatchExtension::StanzaFilter> { { u"message"_s, u"ping"_s, u"urn:xmpp:ping"_s } });
+
+    const auto pingIq = xmlToDom(u"<iq id='1' type='result'><ping xmlns='urn:xmpp:ping'/></iq>"_s);
+    const auto versionIq = xmlToDom(u"<iq id='2' type='result'><query xmlns='jabber:iq:version'/></iq>"_s);
+
+    // extensions without filters get all stanzas
+    fallback->inject(pingIq);
+    QCOMPARE(fallback->calls, 1);
+    QCOMPARE(ping->calls, 1);
+    QCOMPARE(version->calls, 0);
+    QCOMPARE(messages->calls, 0);
+
+    fallback->inject(versionIq);
+    QCOMPARE(fallback->calls, 2);
+    QCOMPARE(ping->calls, 1);
+    QCOMPARE(version->calls, 1);
+    QCOMPARE(messages->calls, 0);
+
+    // order of the extension list is kept
+    auto *first = new DispatchExtension({ { u"iq"_s, u"ping"_s, u"urn:xmpp:ping"_s } }, true);
+    client.insertExtension(0, first);
+    fallback->inject(pingIq);
+    QCOMPARE(first->calls, 1);
+    QCOMPARE(fallback->calls, 2);
+    QCOMPARE(ping->calls, 1);
+
+    // removed extensions are not called anymore
+    client.removeExtension(first);
+    client.removeExtension(fallback);
+    ping->inject(pingIq);
+    QCOMPARE(ping->calls, 2);
+    QCOMPARE(version->calls, 1);
+}
+
+void tst_QXmppClient::benchmarkExtensionDispatch_data()
+{
+    QTest::addColumn<int>("extensionCount");
+    QTest::addColumn<bool>("filtered");
+
+    for (int count : { 5, 25, 100 }) {
+        QTest::addRow("linear-%d", count) << count << false;
+        QTest::addRow("indexed-%d", count) << count << true;
+    }
+}
+
+void tst_QXmppClient::benchmarkExtensionDispatch()
+{
+    QFETCH(int, extensionCount);
+    QFETCH(bool, filtered);
+
+    QXmppClient client;
+    for (auto *ext : client.extensions()) {
+        client.removeExtension(ext);
+    }
+
+    // the last extension handles the stanza
+    DispatchExtension *target = nullptr;
+    for (int i = 0; i < extensionCount; i++) {
+        QList<DispatchExtension::StanzaFilter> filters;
+        if (filtered) {
+            filters = { { u"iq"_s, u"query"_s, u"urn:example:%1"_s.arg(i) } };
+        }
+        target = client.addNewExtension<DispatchExtension>(filters, i == extensionCount - 1);
+    }
+
+    const auto iq = xmlToDom(u"<iq id='1' type='result'><query xmlns='urn:example:%1'/></iq>"_s.arg(extensionCount - 1));
+    QBENCHMARK {
+        target->inject(iq);
+    }
+}
+
 class EncryptionExtension : public QXmppE2eeExtension
 {
 public:
@@ -316,6 +496,151 @@ void tst_QXmppClient::csiManager()
     csi.onSessionOpened(session);
     client.expectNoPacket();
 }
+
+void tst_QXmppClient::streamManagementAckRequests()
+{
+    TestClient client;
+    auto &ackManager = client.stream()->streamAckManager();
+    ackManager.setAckRequestPolicy({ 3, std::chrono::milliseconds(20), 1024 * 1024 });
+
+    int ackRequests = 0;
+    connect(client.logger(), &QXmppLogger::message, this, [&](QXmppLogger::MessageType type, const QString &text) {
+        if (type == QXmppLogger::SentMessage && text == u"<r xmlns=\"urn:xmpp:sm:3\"/>") {
+            ackRequests++;
+        }
+    });
+
+    auto sendMessages = [&](int count) {
+        for (int i = 0; i < count; i++) {
+            client.send(QXmppMessage({}, u"support@qxmpp.org"_s, u"implement XEP-* plz"_s));
+            client.ignore();
+        }
+    };
+
+    // one request per three stanzas
+    sendMessages(7);
+    QCOMPARE(ackRequests, 2);
+    QCOMPARE(ackManager.unacknowledgedCount(), 7);
+
+    // the last stanza is covered after the delay
+    QTRY_COMPARE(ackRequests, 3);
+    QVERIFY(ackManager.oldestUnacknowledgedAge() >= std::chrono::milliseconds(15));
+
+    QVERIFY(ackManager.handleStanza(xmlToDom("<a xmlns='urn:xmpp:sm:3' h='5'/>")));
+    QCOMPARE(ackManager.unacknowledgedCount(), 2);
+    QVERIFY(ackManager.unacknowledgedBytes() > 0);
+
+    QVERIFY(ackManager.handleStanza(xmlToDom("<a xmlns='urn:xmpp:sm:3' h='7'/>")));
+    QCOMPARE(ackManager.unacknowledgedCount(), 0);
+    QCOMPARE(ackManager.unacknowledgedBytes(), 0);
+    QCOMPARE(ackManager.oldestUnacknowledgedAge().count(), 0);
+
+    // byte threshold
+    ackManager.setAckRequestPolicy({ 100, std::chrono::milliseconds(1000), 1 });
+    sendMessages(2);
+    QCOMPARE(ackRequests, 4);
+
+    // the queue grows beyond its initial capacity
+    ackManager.setAckRequestPolicy({ 100, std::chrono::milliseconds(1000), 1024 * 1024 });
+    sendMessages(40);
+    QCOMPARE(ackManager.unacknowledgedCount(), 42);
+    QVERIFY(ackManager.handleStanza(xmlToDom("<a xmlns='urn:xmpp:sm:3' h='40'/>")));
+    QCOMPARE(ackManager.unacknowledgedCount(), 9);
+    // outdated acks are ignored
+    QVERIFY(ackManager.handleStanza(xmlToDom("<a xmlns='urn:xmpp:sm:3' h='20'/>")));
+    QCOMPARE(ackManager.unacknowledgedCount(), 9);
+}
+
+void tst_QXmppClient::streamManagementBackpressure()
+{
+    TestClient client;
+    auto &ackManager = client.stream()->streamAckManager();
+
+    QList<bool> states;
+    connect(&client, &QXmppClient::backpressureChanged, this, [&](bool active) {
+        states.append(active);
+    });
+
+    auto sendMessage = [&] {
+        return client.send(QXmppMessage({}, u"support@qxmpp.org"_s, u"implement XEP-* plz"_s));
+    };
+
+    // the first stanza already fills the queue
+    ackManager.setQueueLimit(1);
+    auto task1 = sendMessage();
+    client.ignore();
+    QCOMPARE(states, QList<bool> { true });
+
+    // the second stanza is held back
+    auto task2 = sendMessage();
+    client.expectNoPacket();
+    QCOMPARE(ackManager.pendingCount(), 1);
+    QVERIFY(!task2.isFinished());
+
+    QVERIFY(ackManager.handleStanza(xmlToDom("<a xmlns='urn:xmpp:sm:3' h='1'/>")));
+    QVERIFY(task1.isFinished());
+    QVERIFY(!task2.isFinished());
+    client.ignore();
+    QCOMPARE(ackManager.pendingCount(), 0);
+    QCOMPARE(states, QList<bool> { true });
+
+    QVERIFY(ackManager.handleStanza(xmlToDom("<a xmlns='urn:xmpp:sm:3' h='2'/>")));
+    QVERIFY(task2.isFinished());
+    QCOMPARE(states, (QList<bool> { true, false }));
+}
+
+void tst_QXmppClient::iqTimeouts()
+{
+    using namespace std::chrono_literals;
+
+    // keep unique IQ IDs
+    TestClient client(false, false);
+    auto &iqManager = client.stream()->iqManager();
+
+    auto sendIq = [&](std::optional<std::chrono::milliseconds> timeout) {
+        QXmppIq iq;
+        iq.setTo(u"pubsub.qxmpp.org"_s);
+        QXmppSendStanzaParams params;
+        params.setIqTimeout(timeout);
+        auto task = client.sendIq(std::move(iq), params);
+        client.ignore();
+        return task;
+    };
+
+    // no default timeout
+    auto task1 = sendIq({});
+    auto task2 = sendIq(50ms);
+    auto task3 = sendIq(5min);
+    QCOMPARE(iqManager.pendingCount(), 3);
+
+    QTRY_VERIFY(task2.isFinished());
+    auto error = expectFutureVariant<QXmppError>(task2);
+    QVERIFY(error.holdsType<QXmpp::TimeoutError>());
+    QCOMPARE(iqManager.pendingCount(), 2);
+    QCOMPARE(iqManager.timeoutCount(), 1);
+    QVERIFY(!task1.isFinished());
+    QVERIFY(!task3.isFinished());
+
+    // default timeout from the configuration
+    iqManager.setDefaultTimeout(50ms);
+    auto task4 = sendIq({});
+    QTRY_VERIFY(task4.isFinished());
+    QCOMPARE(iqManager.timeoutCount(), 2);
+
+    // a response cancels the timeout
+    auto task5 = sendIq({});
+    client.inject(u"<iq id='qx5' from='pubsub.qxmpp.org' type='result'/>"_s);
+    QVERIFY(task5.isFinished());
+    expectFutureVariant<QDomElement>(task5);
+    QTest::qWait(100);
+    QCOMPARE(iqManager.timeoutCount(), 2);
+
+    // pending requests are removed from the wheel when cancelled
+    iqManager.cancelAll();
+    QCOMPARE(iqManager.pendingCount(), 0);
+    QVERIFY(task1.isFinished());
+    QVERIFY(task3.isFinished());
+}
 #endif
 
 void tst_QXmppClient::credentialsSerialization()
@@ -2,10 +2,37 @@
 //
 // SPDX-License-Identifier: LGPL-2.1-or-later
 
+#include "QXmppCapabilitiesFileStorage.h"
 #include "QXmppDiscoveryManager.h"
 
 #include "TestClient.h"
 
+#include <QTemporaryDir>
+
+// example from XEP-0115: Entity Capabilities
+static const auto EXODUS_NODE = u"http://code.google.com/p/exodus"_s;
+static const auto EXODUS_VER = QByteArray::fromBase64("QgayPKawpkPSDYmwT/WM94uAlu0=");
+static const auto EXODUS_INFO = uR"(
+<iq id='qx1' from='romeo@montague.lit/orchard' type='result'>
+    <query xmlns='http://jabber.org/protocol/disco#info' node='http://code.google.com/p/exodus#QgayPKawpkPSDYmwT/WM94uAlu0='>
+        <identity category='client' name='Exodus 0.9.1' type='pc'/>
+        <feature var='http://jabber.org/protocol/caps'/>
+        <feature var='http://jabber.org/protocol/disco#info'/>
+        <feature var='http://jabber.org/protocol/disco#items'/>
+        <feature var='http://jabber.org/protocol/muc'/>
+    </query>
+</iq>)"_s;
+
+static QXmppPresence capabilitiesPresence(const QString &from, const QByteArray &ver = EXODUS_VER)
+{
+    QXmppPresence presence;
+    presence.setFrom(from);
+    presence.setCapabilityHash(u"sha-1"_s);
+    presence.setCapabilityNode(EXODUS_NODE);
+    presence.setCapabilityVer(ver);
+    return presence;
+}
+
 class tst_QXmppDiscoveryManager : public QObject
 {
     Q_OBJECT
@@ -15,6 +42,9 @@ private:
     Q_SLOT void testRequests();
     Q_SLOT void cachingItems();
     Q_SLOT void cachingInfo();
+    Q_SLOT void capabilities();
+    Q_SLOT void capabilitiesVerification();
+    Q_SLOT void capabilitiesStorage();
 };
 
 void tst_QXmppDiscoveryManager::testInfo()
@@ -196,6 +226,100 @@ void tst_QXmppDiscoveryManager::cachingInfo()
     }
 }
 
+void tst_QXmppDiscoveryManager::capabilities()
+{
+    TestClient test;
+    test.configuration().setJid(u"juliet@capulet.lit/balcony"_s);
+    auto *discoManager = test.addNewExtension<QXmppDiscoveryManager>();
+
+    // only one request is sent for all entities with the same capabilities
+    Q_EMIT test.presenceReceived(capabilitiesPresence(u"romeo@montague.lit/orchard"_s));
+    Q_EMIT test.presenceReceived(capabilitiesPresence(u"benvolio@montague.lit/home"_s));
+    test.expect(u"<iq id='qx1' to='romeo@montague.lit/orchard' type='get'><query xmlns='http://jabber.org/protocol/disco#info' node='http://code.google.com/p/exodus#QgayPKawpkPSDYmwT/WM94uAlu0='/></iq>"_s);
+    test.expectNoPacket();
+
+    // info() waits for the pending request
+    auto task = discoManager->info(u"benvolio@montague.lit/home"_s, {}, QXmppDiscoveryManager::CachePolicy::Strict);
+    test.expectNoPacket();
+
+    test.inject(EXODUS_INFO);
+    const auto info = expectFutureVariant<QXmppDiscoInfo>(task);
+    QCOMPARE(info.features().size(), 4);
+    QVERIFY(info.node().isEmpty());
+
+    // later presences use the cache
+    Q_EMIT test.presenceReceived(capabilitiesPresence(u"mercutio@verona.lit/home"_s));
+    test.expectNoPacket();
+    auto cachedTask = discoManager->info(u"mercutio@verona.lit/home"_s, {}, QXmppDiscoveryManager::CachePolicy::Strict);
+    QVERIFY(cachedTask.isFinished());
+    QCOMPARE(expectFutureVariant<QXmppDiscoInfo>(cachedTask).features().size(), 4);
+
+    // the capabilities are forgotten when the entity goes offline
+    QXmppPresence unavailable(QXmppPresence::Unavailable);
+    unavailable.setFrom(u"mercutio@verona.lit/home"_s);
+    Q_EMIT test.presenceReceived(unavailable);
+    discoManager->info(u"mercutio@verona.lit/home"_s, {}, QXmppDiscoveryManager::CachePolicy::Strict);
+    test.expect(u"<iq id='qx1' to='mercutio@verona.lit/home' type='get'><query xmlns='http://jabber.org/protocol/disco#info'/></iq>"_s);
+}
+
+void tst_QXmppDiscoveryManager::capabilitiesVerification()
+{
+    TestClient test;
+    test.configuration().setJid(u"juliet@capulet.lit/balcony"_s);
+    auto *discoManager = test.addNewExtension<QXmppDiscoveryManager>();
+
+    // the advertised verification string does not match the information
+    const auto ver = QByteArray::fromBase64("q07IKJEyjvHSyhy//CH0CxmKi8w=");
+    Q_EMIT test.presenceReceived(capabilitiesPresence(u"romeo@montague.lit/orchard"_s, ver));
+    test.expect(u"<iq id='qx1' to='romeo@montague.lit/orchard' type='get'><query xmlns='http://jabber.org/protocol/disco#info' node='http://code.google.com/p/exodus#q07IKJEyjvHSyhy//CH0CxmKi8w='/></iq>"_s);
+
+    auto task = discoManager->info(u"romeo@montague.lit/orchard"_s);
+    test.inject(EXODUS_INFO);
+
+    // the entity is queried directly and nothing is cached for the verification string
+    test.expectPacketRandomOrder(u"<iq id='qx1' to='romeo@montague.lit/orchard' type='get'><query xmlns='http://jabber.org/protocol/disco#info'/></iq>"_s);
+    QVERIFY(!task.isFinished());
+
+    Q_EMIT test.presenceReceived(capabilitiesPresence(u"benvolio@montague.lit/home"_s, ver));
+    test.expect(u"<iq id='qx1' to='benvolio@montague.lit/home' type='get'><query xmlns='http://jabber.org/protocol/disco#info' node='http://code.google.com/p/exodus#q07IKJEyjvHSyhy//CH0CxmKi8w='/></iq>"_s);
+}
+
+void tst_QXmppDiscoveryManager::capabilitiesStorage()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QXmppCapabilitiesFileStorage storage(dir.filePath(u"caps.xml"_s));
+
+    {
+        TestClient test;
+        test.configuration().setJid(u"juliet@capulet.lit/balcony"_s);
+        auto *discoManager = test.addNewExtension<QXmppDiscoveryManager>();
+        discoManager->setCapabilitiesStorage(&storage);
+        QCOMPARE(discoManager->capabilitiesStorage(), &storage);
+
+        Q_EMIT test.presenceReceived(capabilitiesPresence(u"romeo@montague.lit/orchard"_s));
+        test.ignore();
+        test.inject(EXODUS_INFO);
+    }
+
+    // a new manager with a new storage for the same file does not need to send a request
+    QXmppCapabilitiesFileStorage reopenedStorage(storage.path());
+    TestClient test;
+    test.configuration().setJid(u"juliet@capulet.lit/balcony"_s);
+    auto *discoManager = test.addNewExtension<QXmppDiscoveryManager>();
+    discoManager->setCapabilitiesStorage(&reopenedStorage);
+
+    Q_EMIT test.presenceReceived(capabilitiesPresence(u"benvolio@montague.lit/home"_s));
+    test.expectNoPacket();
+
+    auto task = discoManager->info(u"benvolio@montague.lit/home"_s);
+    test.expectNoPacket();
+    const auto info = expectFutureVariant<QXmppDiscoInfo>(task);
+    QCOMPARE(info.identities().size(), 1);
+    QCOMPARE(info.identities().first().name(), u"Exodus 0.9.1"_s);
+    QCOMPARE(info.features().size(), 4);
+}
+
 QTEST_MAIN(tst_QXmppDiscoveryManager)
 
 #include "tst_qxmppdiscoverymanager.moc"
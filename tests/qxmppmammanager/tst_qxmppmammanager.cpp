@@ -5,6 +5,7 @@
 #include "QXmppE2eeExtension.h"
 #include "QXmppMamManager.h"
 #include "QXmppMessage.h"
+#include "QXmppPromise.h"
 
 #include "Async.h"
 #include "TestClient.h"
@@ -42,6 +43,47 @@ public:
     bool isEncrypted(const QXmppMessage &) override { return false; };
 };
 
+// finishes decryptions only when requested
+class DeferredEncryptionExtension : public EncryptionExtension
+{
+public:
+    QXmppTask<MessageDecryptResult> decryptMessage(QXmppMessage &&m) override
+    {
+        pending.emplace_back(QXmppPromise<MessageDecryptResult>(), std::move(m));
+        return pending.back().first.task();
+    }
+
+    void finish(qsizetype index)
+    {
+        auto &[promise, message] = pending.at(index);
+        message.setBody(u"decrypted: "_s + message.e2eeFallbackBody());
+        promise.finish(std::move(message));
+    }
+
+    void fail(qsizetype index)
+    {
+        pending.at(index).first.finish(QXmppError { "it's only a test", QXmpp::SendError::EncryptionError });
+    }
+
+    std::vector<std::pair<QXmppPromise<MessageDecryptResult>, QXmppMessage>> pending;
+};
+
+static QDomElement mamMessage(const QString &id, const QString &body, bool encrypted, const QString &queryId = u"qx1"_s)
+{
+    return xmlToDom(u"<message to='juliet@capulet.lit/chamber' from='mam.server.org'>"
+                    "<result xmlns='urn:xmpp:mam:2' queryid='"_s +
+                    queryId + u"' id='"_s + id +
+                    u"'>"
+                    "<forwarded xmlns='urn:xmpp:forward:0'>"
+                    "<message xmlns='jabber:client' to='juliet@capulet.lit/balcony' from='romeo@montague.lit/orchard' type='chat'>"_s +
+                    (encrypted ? u"<test-encrypted/>"_s : QString()) +
+                    u"<body>"_s + body + u"</body>"
+                                          "</message>"
+                                          "</forwarded>"
+                                          "</result>"
+                                          "</message>"_s);
+}
+
 class QXmppMamTestHelper : public QObject
 {
     Q_OBJECT
@@ -76,6 +118,10 @@ private:
     // test for task-based API
     Q_SLOT void retrieveMessagesUnencrypted();
     Q_SLOT void retrieveMessagesEncrypted();
+    Q_SLOT void streamMessages();
+    Q_SLOT void streamMessagesDecryptionWindow();
+    Q_SLOT void catchUp();
+    Q_SLOT void catchUpSince();
 
     QXmppMamTestHelper m_helper;
     QXmppMamManager m_manager;
@@ -351,6 +397,199 @@ void tst_QXmppMamManager::retrieveMessagesEncrypted()
     QCOMPARE(retrieved.result.resultSetReply().first(), "28482-98726-73623");
 }
 
+void tst_QXmppMamManager::streamMessages()
+{
+    TestClient test;
+    auto *mam = test.addNewExtension<QXmppMamManager>();
+
+    QList<QXmppMamManager::ArchivedMessage> received;
+    auto task = mam->streamMessages([&](QXmppMamManager::ArchivedMessage &&archived) {
+        received.append(std::move(archived));
+    },
+                                    u"mam.server.org"_s);
+    test.expect("<iq id='qx1' to='mam.server.org' type='set'>"
+                "<query xmlns='urn:xmpp:mam:2' queryid='qx1'>"
+                "<x xmlns='jabber:x:data' type='submit'>"
+                "<field type='hidden' var='FORM_TYPE'><value>urn:xmpp:mam:2</value></field>"
+                "</x>"
+                "</query>"
+                "</iq>");
+
+    // messages are delivered when they arrive
+    mam->handleStanza(mamMessage(u"28482-98726-73623"_s, u"first"_s, false));
+    QCOMPARE(received.size(), 1);
+    QCOMPARE(received.at(0).id, u"28482-98726-73623"_s);
+    QCOMPARE(received.at(0).message.body(), u"first"_s);
+
+    mam->handleStanza(mamMessage(u"09af3-cc343-b409f"_s, u"second"_s, false));
+    QCOMPARE(received.size(), 2);
+    QCOMPARE(received.at(1).id, u"09af3-cc343-b409f"_s);
+    QVERIFY(!task.isFinished());
+
+    test.inject("<iq type='result' id='qx1'>"
+                "<fin xmlns='urn:xmpp:mam:2' complete='true'>"
+                "<set xmlns='http://jabber.org/protocol/rsm'>"
+                "<first index='0'>28482-98726-73623</first>"
+                "<last>09af3-cc343-b409f</last>"
+                "</set>"
+                "</fin>"
+                "</iq>");
+
+    auto result = expectFutureVariant<QXmppMamResultIq>(task);
+    QVERIFY(result.complete());
+    QCOMPARE(result.resultSetReply().last(), u"09af3-cc343-b409f"_s);
+}
+
+void tst_QXmppMamManager::streamMessagesDecryptionWindow()
+{
+    TestClient test;
+    DeferredEncryptionExtension e2ee;
+    test.setEncryptionExtension(&e2ee);
+    auto *mam = test.addNewExtension<QXmppMamManager>();
+    QCOMPARE(mam->decryptionWindow(), 8);
+    mam->setDecryptionWindow(2);
+
+    QStringList received;
+    auto task = mam->streamMessages([&](QXmppMamManager::ArchivedMessage &&archived) {
+        received.append(archived.message.body());
+    });
+    test.ignore();
+
+    mam->handleStanza(mamMessage(u"1"_s, u"1"_s, true));
+    mam->handleStanza(mamMessage(u"2"_s, u"2"_s, false));
+    mam->handleStanza(mamMessage(u"3"_s, u"3"_s, true));
+    mam->handleStanza(mamMessage(u"4"_s, u"4"_s, true));
+    test.inject("<iq type='result' id='qx1'><fin xmlns='urn:xmpp:mam:2'/></iq>");
+
+    // only two decryptions run at the same time, nothing is delivered out of order
+    QCOMPARE(e2ee.pending.size(), size_t(2));
+    QVERIFY(received.isEmpty());
+
+    // the next decryption starts when one has finished
+    e2ee.finish(1);
+    QVERIFY(received.isEmpty());
+    QCOMPARE(e2ee.pending.size(), size_t(3));
+
+    e2ee.finish(0);
+    QCOMPARE(received, (QStringList { u"decrypted: 1"_s, u"2"_s, u"decrypted: 3"_s }));
+    QVERIFY(!task.isFinished());
+
+    // the message is delivered with the fallback body if the decryption fails
+    e2ee.fail(2);
+    QCOMPARE(received.size(), 4);
+    QCOMPARE(received.last(), u"4"_s);
+    expectFutureVariant<QXmppMamResultIq>(task);
+}
+
+void tst_QXmppMamManager::catchUp()
+{
+    // IQ IDs are used as query IDs and must not be reused
+    TestClient test(false, false);
+    DeferredEncryptionExtension e2ee;
+    test.setEncryptionExtension(&e2ee);
+    auto *mam = test.addNewExtension<QXmppMamManager>();
+
+    QStringList received;
+    QList<QXmppMamManager::CatchUpProgress> progress;
+    auto task = mam->catchUp([&](QXmppMamManager::ArchivedMessage &&archived) {
+        received.append(archived.id);
+    },
+                             u"a"_s,
+                             [&](const QXmppMamManager::CatchUpProgress &p) {
+        progress.append(p);
+    },
+                             {},
+                             {},
+                             2);
+    test.expect("<iq id='qx1' type='set'>"
+                "<query xmlns='urn:xmpp:mam:2' queryid='qx1'>"
+                "<x xmlns='jabber:x:data' type='submit'>"
+                "<field type='hidden' var='FORM_TYPE'><value>urn:xmpp:mam:2</value></field>"
+                "</x>"
+                "<set xmlns='http://jabber.org/protocol/rsm'><max>2</max><after>a</after></set>"
+                "</query>"
+                "</iq>");
+
+    mam->handleStanza(mamMessage(u"b"_s, u"b"_s, true));
+    mam->handleStanza(mamMessage(u"c"_s, u"c"_s, false));
+    test.inject("<iq type='result' id='qx1'>"
+                "<fin xmlns='urn:xmpp:mam:2'>"
+                "<set xmlns='http://jabber.org/protocol/rsm'>"
+                "<first index='0'>b</first><last>c</last><count>3</count>"
+                "</set>"
+                "</fin>"
+                "</iq>");
+
+    // the next page is requested while the first one is still being decrypted
+    test.expect("<iq id='qx2' type='set'>"
+                "<query xmlns='urn:xmpp:mam:2' queryid='qx2'>"
+                "<x xmlns='jabber:x:data' type='submit'>"
+                "<field type='hidden' var='FORM_TYPE'><value>urn:xmpp:mam:2</value></field>"
+                "</x>"
+                "<set xmlns='http://jabber.org/protocol/rsm'><max>2</max><after>c</after></set>"
+                "</query>"
+                "</iq>");
+    QVERIFY(received.isEmpty());
+
+    mam->handleStanza(mamMessage(u"d"_s, u"d"_s, false, u"qx2"_s));
+    test.inject("<iq type='result' id='qx2'>"
+                "<fin xmlns='urn:xmpp:mam:2' complete='true'>"
+                "<set xmlns='http://jabber.org/protocol/rsm'>"
+                "<first index='2'>d</first><last>d</last><count>3</count>"
+                "</set>"
+                "</fin>"
+                "</iq>");
+    test.expectNoPacket();
+
+    // the second page waits for the first one
+    QVERIFY(received.isEmpty());
+    QVERIFY(!task.isFinished());
+
+    e2ee.finish(0);
+    QCOMPARE(received, (QStringList { u"b"_s, u"c"_s, u"d"_s }));
+
+    QCOMPARE(progress.size(), 2);
+    QCOMPARE(progress.at(0).lastId, u"c"_s);
+    QCOMPARE(progress.at(0).messages, qsizetype(2));
+    QCOMPARE(progress.at(0).pages, qsizetype(1));
+    QCOMPARE(progress.at(0).total, std::optional<int>(3));
+
+    auto result = expectFutureVariant<QXmppMamManager::CatchUpProgress>(task);
+    QCOMPARE(result.lastId, u"d"_s);
+    QCOMPARE(result.messages, qsizetype(3));
+    QCOMPARE(result.pages, qsizetype(2));
+}
+
+void tst_QXmppMamManager::catchUpSince()
+{
+    TestClient test;
+    auto *mam = test.addNewExtension<QXmppMamManager>();
+
+    QStringList received;
+    auto task = mam->catchUp([&](QXmppMamManager::ArchivedMessage &&archived) {
+        received.append(archived.id);
+    },
+                             QDateTime({ 2010, 7, 10 }, { 23, 8, 25 }, TimeZoneUTC));
+    test.expect("<iq id='qx1' type='set'>"
+                "<query xmlns='urn:xmpp:mam:2' queryid='qx1'>"
+                "<x xmlns='jabber:x:data' type='submit'>"
+                "<field type='hidden' var='FORM_TYPE'><value>urn:xmpp:mam:2</value></field>"
+                "<field type='text-single' var='start'><value>2010-07-10T23:08:25Z</value></field>"
+                "</x>"
+                "<set xmlns='http://jabber.org/protocol/rsm'><max>100</max></set>"
+                "</query>"
+                "</iq>");
+
+    mam->handleStanza(mamMessage(u"b"_s, u"b"_s, false));
+    test.inject("<iq type='error' id='qx1'>"
+                "<error type='cancel'><item-not-found xmlns='urn:ietf:params:xml:ns:xmpp-stanzas'/></error>"
+                "</iq>");
+
+    // the catch-up can be resumed from the last delivered message
+    QCOMPARE(received, (QStringList { u"b"_s }));
+    expectFutureVariant<QXmppError>(task);
+}
+
 void QXmppMamTestHelper::archivedMessageReceived(const QString &queryId, const QXmppMessage &message)
 {
     m_signalTriggered = true;
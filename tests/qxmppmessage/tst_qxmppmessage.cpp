@@ -65,6 +65,8 @@ private:
     Q_SLOT void testEncryptedFileSource();
     Q_SLOT void testReplies();
     Q_SLOT void testJingleMessageInitiationElement();
+    Q_SLOT void benchmarkParse_data();
+    Q_SLOT void benchmarkParse();
 };
 
 void tst_QXmppMessage::testBasic_data()
@@ -1457,5 +1459,65 @@ void tst_QXmppMessage::testJingleMessageInitiationElement()
     QVERIFY(message2.jingleMessageInitiationElement());
 }
 
+void tst_QXmppMessage::benchmarkParse_data()
+{
+    QTest::addColumn<QByteArray>("xml");
+
+    QTest::newRow("chat") << QByteArrayLiteral(
+        "<message xmlns='jabber:client' to='juliet@capulet.example/balcony' from='romeo@montague.example/garden' id='a1' type='chat'>"
+        "<body>Art thou not Romeo, and a Montague?</body>"
+        "<thread>e0ffe42b28561960c6b12b944a092794b9683a38</thread>"
+        "</message>");
+    QTest::newRow("receipts-markers-ids") << QByteArrayLiteral(
+        "<message xmlns='jabber:client' to='juliet@capulet.example/balcony' from='romeo@montague.example/garden' id='a2' type='chat'>"
+        "<body>Neither, fair saint, if either thee dislike.</body>"
+        "<active xmlns='http://jabber.org/protocol/chatstates'/>"
+        "<request xmlns='urn:xmpp:receipts'/>"
+        "<markable xmlns='urn:xmpp:chat-markers:0'/>"
+        "<origin-id xmlns='urn:xmpp:sid:0' id='de305d54-75b4-431b-adb2-eb6b9e546013'/>"
+        "<stanza-id xmlns='urn:xmpp:sid:0' id='5f3dbc5e-e1d3-4077-a492-693f3769c7ad' by='juliet@capulet.example'/>"
+        "</message>");
+    QTest::newRow("groupchat-history") << QByteArrayLiteral(
+        "<message xmlns='jabber:client' to='hag66@shakespeare.lit/pda' from='coven@chat.shakespeare.lit/thirdwitch' id='a3' type='groupchat'>"
+        "<body>Harpier cries: 'tis time, 'tis time.</body>"
+        "<subject>Fire Burn and Cauldron Bubble!</subject>"
+        "<delay xmlns='urn:xmpp:delay' from='coven@chat.shakespeare.lit' stamp='2002-10-13T23:58:37Z'/>"
+        "<stanza-id xmlns='urn:xmpp:sid:0' id='5f3dbc5e-e1d3-4077-a492-693f3769c7ad' by='coven@chat.shakespeare.lit'/>"
+        "<x xmlns='http://jabber.org/protocol/muc#user'/>"
+        "</message>");
+    QTest::newRow("reaction-reply-fallback") << QByteArrayLiteral(
+        "<message xmlns='jabber:client' to='juliet@capulet.example' from='romeo@montague.example/garden' id='a4' type='chat'>"
+        "<body>> Art thou not Romeo\nI am.</body>"
+        "<reply xmlns='urn:xmpp:reply:0' to='juliet@capulet.example/balcony' id='a1'/>"
+        "<fallback xmlns='urn:xmpp:fallback:0' for='urn:xmpp:reply:0'><body start='0' end='21'/></fallback>"
+        "<reactions xmlns='urn:xmpp:reactions:0' id='a2'><reaction>\u2764</reaction></reactions>"
+        "<store xmlns='urn:xmpp:hints'/>"
+        "<replace xmlns='urn:xmpp:message-correct:0' id='a3'/>"
+        "</message>");
+    QTest::newRow("encrypted") << QByteArrayLiteral(
+        "<message xmlns='jabber:client' to='juliet@capulet.example' from='romeo@montague.example/garden' id='a5' type='chat'>"
+        "<encrypted xmlns='urn:xmpp:omemo:2'>"
+        "<header sid='27183'><keys jid='juliet@capulet.example'><key rid='31415'>Tm90IHJlYWxseSBhbiBPTUVNTyBrZXk=</key></keys></header>"
+        "<payload>VGhpcyBpcyBub3QgcmVhbGx5IGFuIGVuY3J5cHRlZCBwYXlsb2Fk</payload>"
+        "</encrypted>"
+        "<encryption xmlns='urn:xmpp:eme:0' namespace='urn:xmpp:omemo:2'/>"
+        "<body>This message is encrypted with OMEMO 2.</body>"
+        "<store xmlns='urn:xmpp:hints'/>"
+        "<request xmlns='urn:xmpp:receipts'/>"
+        "<markable xmlns='urn:xmpp:chat-markers:0'/>"
+        "</message>");
+}
+
+void tst_QXmppMessage::benchmarkParse()
+{
+    QFETCH(QByteArray, xml);
+
+    const auto element = xmlToDom(xml);
+    QBENCHMARK {
+        QXmppMessage message;
+        message.parse(element);
+    }
+}
+
 QTEST_MAIN(tst_QXmppMessage)
 #include "tst_qxmppmessage.moc"
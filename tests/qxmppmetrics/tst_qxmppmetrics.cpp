@@ -0,0 +1,253 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "QXmppLogger.h"
+#include "QXmppMetrics.h"
+#include "QXmppMetrics_p.h"
+#include "QXmppMetricsExporter.h"
+
+#include "util.h"
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+
+class tst_QXmppMetrics : public QObject
+{
+    Q_OBJECT
+
+private:
+    Q_SLOT void testCounter();
+    Q_SLOT void testGauge();
+    Q_SLOT void testHistogram();
+    Q_SLOT void testTypeMismatch();
+    Q_SLOT void testExportName();
+    Q_SLOT void testExportNameCollision();
+    Q_SLOT void testStreamMetricsCollision();
+    Q_SLOT void testExportPrometheus();
+    Q_SLOT void testExportOpenMetrics();
+    Q_SLOT void testLogger();
+    Q_SLOT void testFileExporter();
+    Q_SLOT void testHttpExporter();
+};
+
+void tst_QXmppMetrics::testCounter()
+{
+    QXmppMetrics metrics;
+    auto *counter = metrics.counter(u"incoming-client.auth.success"_s);
+    QVERIFY(counter);
+    QCOMPARE(counter->value(), qint64(0));
+
+    counter->increment();
+    counter->increment(5);
+    QCOMPARE(counter->value(), qint64(6));
+
+    // the handle is looked up again
+    QCOMPARE(metrics.counter(u"incoming-client.auth.success"_s), counter);
+}
+
+void tst_QXmppMetrics::testGauge()
+{
+    QXmppMetrics metrics;
+    auto *gauge = metrics.gauge(u"incoming-client.count"_s);
+    QVERIFY(gauge);
+    QCOMPARE(gauge->value(), 0.0);
+
+    gauge->set(12);
+    QCOMPARE(gauge->value(), 12.0);
+    gauge->set(3.5);
+    QCOMPARE(gauge->value(), 3.5);
+}
+
+void tst_QXmppMetrics::testHistogram()
+{
+    QXmppMetrics metrics;
+    auto *histogram = metrics.histogram(u"latency"_s, { 1, 0.1 });
+    QVERIFY(histogram);
+    // bounds are sorted
+    QCOMPARE(histogram->upperBounds(), (QList<double> { 0.1, 1 }));
+
+    histogram->observe(0.05);
+    histogram->observe(0.1);
+    histogram->observe(0.5);
+    histogram->observe(7);
+
+    QCOMPARE(histogram->bucketCount(0), quint64(2));
+    QCOMPARE(histogram->bucketCount(1), quint64(1));
+    QCOMPARE(histogram->bucketCount(2), quint64(1));
+    QCOMPARE(histogram->count(), quint64(4));
+    QCOMPARE(histogram->sum(), 7.65);
+
+    // existing histograms keep their buckets
+    QCOMPARE(metrics.histogram(u"latency"_s), histogram);
+    QCOMPARE(histogram->upperBounds().size(), qsizetype(2));
+}
+
+void tst_QXmppMetrics::testTypeMismatch()
+{
+    QXmppMetrics metrics;
+    QVERIFY(metrics.counter(u"a"_s));
+    QVERIFY(!metrics.gauge(u"a"_s));
+    QVERIFY(!metrics.histogram(u"a"_s));
+}
+
+void tst_QXmppMetrics::testExportName()
+{
+    QCOMPARE(QXmppMetrics::exportName(u"incoming-client.count"), u"qxmpp_incoming_client_count"_s);
+    QCOMPARE(QXmppMetrics::exportName(u"server.route_seconds"), u"qxmpp_server_route_seconds"_s);
+}
+
+void tst_QXmppMetrics::testExportNameCollision()
+{
+    QXmppMetrics metrics;
+    QVERIFY(metrics.gauge(u"a.b"_s));
+    QVERIFY(!metrics.gauge(u"a_b"_s));
+    QVERIFY(!metrics.counter(u"a-b"_s));
+    QVERIFY(metrics.gauge(u"a.b"_s));
+
+    // samples of counters and histograms have suffixes
+    QVERIFY(metrics.counter(u"c"_s));
+    QVERIFY(!metrics.gauge(u"c_total"_s));
+    QVERIFY(metrics.histogram(u"h"_s));
+    QVERIFY(!metrics.counter(u"h.sum"_s));
+    QVERIFY(!metrics.gauge(u"h_count"_s));
+
+    QCOMPARE(metrics.exportText(QXmppMetrics::Prometheus).count("# TYPE"), 3);
+}
+
+void tst_QXmppMetrics::testStreamMetricsCollision()
+{
+    using QXmpp::Private::StreamMetrics;
+
+    auto metrics = std::make_shared<QXmppMetrics>();
+    QVERIFY(StreamMetrics::create(metrics, u"client"_s));
+
+    // a stream counter can't be registered, no incomplete handles are returned
+    metrics = std::make_shared<QXmppMetrics>();
+    QVERIFY(metrics->gauge(u"client.writes"_s));
+    QTest::ignoreMessage(QtWarningMsg, "[QXmpp] Metrics of 'client' streams are disabled, their names are taken by other metrics");
+    QVERIFY(!StreamMetrics::create(metrics, u"client"_s));
+}
+
+void tst_QXmppMetrics::testExportPrometheus()
+{
+    QXmppMetrics metrics;
+    metrics.counter(u"incoming-client.auth.success"_s)->increment(3);
+    metrics.gauge(u"incoming-client.count"_s)->set(2);
+    auto *histogram = metrics.histogram(u"server.route-seconds"_s, { 0.25, 1 });
+    histogram->observe(0.125);
+    histogram->observe(2);
+
+    const auto expected = QByteArrayLiteral(
+        "# TYPE qxmpp_incoming_client_auth_success_total counter\n"
+        "qxmpp_incoming_client_auth_success_total 3\n"
+        "# TYPE qxmpp_incoming_client_count gauge\n"
+        "qxmpp_incoming_client_count 2\n"
+        "# TYPE qxmpp_server_route_seconds histogram\n"
+        "qxmpp_server_route_seconds_bucket{le=\"0.25\"} 1\n"
+        "qxmpp_server_route_seconds_bucket{le=\"1\"} 1\n"
+        "qxmpp_server_route_seconds_bucket{le=\"+Inf\"} 2\n"
+        "qxmpp_server_route_seconds_sum 2.125\n"
+        "qxmpp_server_route_seconds_count 2\n");
+    QCOMPARE(metrics.exportText(QXmppMetrics::Prometheus), expected);
+}
+
+void tst_QXmppMetrics::testExportOpenMetrics()
+{
+    QXmppMetrics metrics;
+    metrics.counter(u"client.stanzas-sent"_s)->increment();
+
+    const auto expected = QByteArrayLiteral(
+        "# TYPE qxmpp_client_stanzas_sent counter\n"
+        "qxmpp_client_stanzas_sent_total 1\n"
+        "# EOF\n");
+    QCOMPARE(metrics.exportText(QXmppMetrics::OpenMetrics), expected);
+    QCOMPARE(QXmppMetrics().exportText(QXmppMetrics::OpenMetrics), QByteArrayLiteral("# EOF\n"));
+}
+
+void tst_QXmppMetrics::testLogger()
+{
+    QXmppLogger logger;
+    // without metrics nothing is recorded
+    logger.updateCounter(u"counter"_s, 1);
+    QVERIFY(!logger.metrics());
+
+    auto metrics = std::make_shared<QXmppMetrics>();
+    QSignalSpy spy(&logger, &QXmppLogger::metricsChanged);
+    logger.setMetrics(metrics);
+    QCOMPARE(spy.size(), 1);
+    logger.setMetrics(metrics);
+    QCOMPARE(spy.size(), 1);
+
+    logger.updateCounter(u"counter"_s, 2);
+    logger.updateCounter(u"counter"_s, 3);
+    logger.setGauge(u"gauge"_s, 42);
+    QCOMPARE(metrics->counter(u"counter"_s)->value(), qint64(5));
+    QCOMPARE(metrics->gauge(u"gauge"_s)->value(), 42.0);
+
+    // a gauge can not be updated as counter
+    logger.updateCounter(u"gauge"_s, 1);
+    QCOMPARE(metrics->gauge(u"gauge"_s)->value(), 42.0);
+}
+
+void tst_QXmppMetrics::testFileExporter()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    auto metrics = std::make_shared<QXmppMetrics>();
+    metrics->counter(u"counter"_s)->increment();
+
+    QXmppMetricsFileExporter exporter(metrics, dir.filePath(u"metrics.prom"_s));
+    QCOMPARE(exporter.interval(), std::chrono::milliseconds(0));
+    QVERIFY(exporter.write());
+
+    auto readFile = [&] {
+        QFile file(exporter.path());
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    };
+    QCOMPARE(readFile(), metrics->exportText());
+
+    exporter.setFormat(QXmppMetrics::OpenMetrics);
+    exporter.setInterval(std::chrono::milliseconds(10));
+    QCOMPARE(exporter.interval(), std::chrono::milliseconds(10));
+    QTRY_COMPARE(readFile(), metrics->exportText(QXmppMetrics::OpenMetrics));
+}
+
+void tst_QXmppMetrics::testHttpExporter()
+{
+    auto metrics = std::make_shared<QXmppMetrics>();
+    metrics->counter(u"counter"_s)->increment();
+
+    QXmppMetricsHttpExporter exporter(metrics);
+    QVERIFY(exporter.listen());
+
+    // sends the request and returns the response once the server closed the connection
+    auto request = [&](const QByteArray &data) {
+        QTcpSocket socket;
+        socket.connectToHost(QHostAddress::LocalHost, exporter.serverPort());
+        if (!socket.waitForConnected()) {
+            return QByteArray();
+        }
+        socket.write(data);
+        QByteArray response;
+        while (socket.state() == QAbstractSocket::ConnectedState || socket.bytesAvailable()) {
+            QTest::qWait(10);
+            response += socket.readAll();
+        }
+        return response;
+    };
+
+    const auto response = request("GET /metrics HTTP/1.0\r\n\r\n");
+    QVERIFY(response.startsWith("HTTP/1.0 200 OK\r\n"));
+    QVERIFY(response.endsWith(metrics->exportText()));
+
+    QVERIFY(request("GET /other HTTP/1.0\r\n\r\n").startsWith("HTTP/1.0 404 Not Found\r\n"));
+
+    // the headers never end
+    QVERIFY(request("GET /metrics HTTP/1.0\r\nX-Header: " + QByteArray(10000, 'a')).startsWith("HTTP/1.0 400 Bad Request\r\n"));
+}
+
+QTEST_MAIN(tst_QXmppMetrics)
+#include "tst_qxmppmetrics.moc"
@@ -6,11 +6,16 @@
 #include "QXmppClient.h"
 #include "QXmppDiscoveryManager.h"
 #include "QXmppMovedManager.h"
+#include "QXmppOutgoingClient_p.h"
 #include "QXmppPubSubManager.h"
+#include "QXmppRosterFileStorage.h"
 #include "QXmppRosterManager.h"
+#include "QXmppRosterMemoryStorage.h"
 
 #include "TestClient.h"
 
+#include <QTemporaryDir>
+
 class tst_QXmppRosterManager : public QObject
 {
     Q_OBJECT
@@ -25,6 +30,10 @@ private:
     Q_SLOT void testMovedSubscriptionRequestReceived();
     Q_SLOT void testAddItem();
     Q_SLOT void testRemoveItem();
+    Q_SLOT void testRosterVersioning();
+    Q_SLOT void testRosterVersioningUnsupported();
+    Q_SLOT void testRosterFileStorage();
+    Q_SLOT void testPresences();
 
 private:
     QXmppClient client;
@@ -272,5 +281,206 @@ void tst_QXmppRosterManager::testRemoveItem()
     QCOMPARE(error.text(), u"Not found"_s);
 }
 
+void tst_QXmppRosterManager::testRosterVersioning()
+{
+    TestClient test;
+    test.configuration().setJid(u"juliet@capulet.lit"_s);
+    test.streamPrivate()->isAuthenticated = true;
+    test.streamPrivate()->rosterVersioningSupported = true;
+    auto *rosterManager = test.addNewExtension<QXmppRosterManager>(&test);
+
+    QXmppRosterMemoryStorage storage;
+    rosterManager->setStorage(&storage);
+    QCOMPARE(rosterManager->storage(), &storage);
+
+    // without a cached roster an empty version is sent
+    Q_EMIT test.connected();
+    test.expect(u"<iq id='qx1' from='juliet@capulet.lit' type='get'><query xmlns='jabber:iq:roster' ver=''><annotate xmlns='urn:xmpp:mix:roster:0'/></query></iq>"_s);
+    test.inject(u"<iq id='qx1' type='result'><query xmlns='jabber:iq:roster' ver='ver1'><item jid='romeo@montague.lit' subscription='both'/><item jid='nurse@capulet.lit' subscription='to'/></query></iq>"_s);
+    QVERIFY(rosterManager->isRosterReceived());
+    QCOMPARE(rosterManager->getRosterBareJids().size(), 2);
+
+    auto cached = storage.load().takeResult();
+    QCOMPARE(cached.version, u"ver1"_s);
+    QCOMPARE(cached.items.size(), 2);
+
+    // roster pushes update the storage
+    QVERIFY(rosterManager->handleStanza(xmlToDom(u"<iq id='push1' type='set'><query xmlns='jabber:iq:roster' ver='ver2'><item jid='nurse@capulet.lit' subscription='remove'/></query></iq>"_s)));
+    test.expect(u"<iq id='push1' type='result'/>"_s);
+    cached = storage.load().takeResult();
+    QCOMPARE(cached.version, u"ver2"_s);
+    QCOMPARE(cached.items.size(), 1);
+    QCOMPARE(cached.items.first().bareJid(), u"romeo@montague.lit"_s);
+
+    // reconnect: the roster is unchanged
+    test.setStreamManagementState(QXmppClient::NoStreamManagement);
+    Q_EMIT test.disconnected();
+    QVERIFY(!rosterManager->isRosterReceived());
+
+    QSignalSpy rosterReceivedSpy(rosterManager, &QXmppRosterManager::rosterReceived);
+    Q_EMIT test.connected();
+    test.expect(u"<iq id='qx1' from='juliet@capulet.lit' type='get'><query xmlns='jabber:iq:roster' ver='ver2'><annotate xmlns='urn:xmpp:mix:roster:0'/></query></iq>"_s);
+    test.inject(u"<iq id='qx1' type='result'/>"_s);
+    QCOMPARE(rosterReceivedSpy.size(), 1);
+    QCOMPARE(rosterManager->getRosterBareJids(), QStringList { u"romeo@montague.lit"_s });
+    QCOMPARE(rosterManager->getRosterEntry(u"romeo@montague.lit"_s).subscriptionType(), QXmppRosterIq::Item::Both);
+
+    // reconnect: the server sends the complete roster
+    Q_EMIT test.disconnected();
+    Q_EMIT test.connected();
+    test.expect(u"<iq id='qx1' from='juliet@capulet.lit' type='get'><query xmlns='jabber:iq:roster' ver='ver2'><annotate xmlns='urn:xmpp:mix:roster:0'/></query></iq>"_s);
+    test.inject(u"<iq id='qx1' type='result'><query xmlns='jabber:iq:roster' ver='ver5'><item jid='benvolio@montague.lit' subscription='both'/></query></iq>"_s);
+    QCOMPARE(rosterReceivedSpy.size(), 2);
+    QCOMPARE(rosterManager->getRosterBareJids(), QStringList { u"benvolio@montague.lit"_s });
+    cached = storage.load().takeResult();
+    QCOMPARE(cached.version, u"ver5"_s);
+    QCOMPARE(cached.items.size(), 1);
+}
+
+void tst_QXmppRosterManager::testRosterVersioningUnsupported()
+{
+    TestClient test;
+    test.configuration().setJid(u"juliet@capulet.lit"_s);
+    test.streamPrivate()->isAuthenticated = true;
+    auto *rosterManager = test.addNewExtension<QXmppRosterManager>(&test);
+
+    QXmppRosterMemoryStorage storage;
+    storage.store({ u"ver1"_s, {} });
+    rosterManager->setStorage(&storage);
+
+    // no version is sent and the received roster replaces the cached one
+    Q_EMIT test.connected();
+    test.expect(u"<iq id='qx1' from='juliet@capulet.lit' type='get'><query xmlns='jabber:iq:roster'><annotate xmlns='urn:xmpp:mix:roster:0'/></query></iq>"_s);
+    test.inject(u"<iq id='qx1' type='result'><query xmlns='jabber:iq:roster'><item jid='romeo@montague.lit' subscription='both'/></query></iq>"_s);
+    QVERIFY(rosterManager->isRosterReceived());
+
+    const auto cached = storage.load().takeResult();
+    QVERIFY(cached.version.isEmpty());
+    QCOMPARE(cached.items.size(), 1);
+}
+
+void tst_QXmppRosterManager::testRosterFileStorage()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const auto path = dir.filePath(u"roster.xml"_s);
+
+    QXmppRosterIq::Item romeo;
+    romeo.setBareJid(u"romeo@montague.lit"_s);
+    romeo.setName(u"Romeo"_s);
+    romeo.setSubscriptionType(QXmppRosterIq::Item::Both);
+    romeo.setGroups({ u"Friends"_s });
+
+    QXmppRosterIq::Item nurse;
+    nurse.setBareJid(u"nurse@capulet.lit"_s);
+    nurse.setSubscriptionType(QXmppRosterIq::Item::To);
+
+    {
+        QXmppRosterFileStorage storage(path);
+        QCOMPARE(storage.path(), path);
+        QVERIFY(storage.load().takeResult().items.isEmpty());
+
+        storage.store({ u"ver1"_s, { romeo } });
+        storage.update(u"ver2"_s, { nurse });
+    }
+
+    {
+        QXmppRosterFileStorage storage(path);
+        auto roster = storage.load().takeResult();
+        QCOMPARE(roster.version, u"ver2"_s);
+        QCOMPARE(roster.items.size(), 2);
+
+        const auto &item = roster.items.at(1);
+        QCOMPARE(item.bareJid(), u"romeo@montague.lit"_s);
+        QCOMPARE(item.name(), u"Romeo"_s);
+        QCOMPARE(item.subscriptionType(), QXmppRosterIq::Item::Both);
+        QCOMPARE(item.groups(), QSet<QString> { u"Friends"_s });
+
+    }
+
+    {
+        // updates without loading first keep the other items
+        QXmppRosterFileStorage storage(path);
+        nurse.setSubscriptionType(QXmppRosterIq::Item::Remove);
+        storage.update(u"ver3"_s, { nurse });
+    }
+
+    QXmppRosterFileStorage storage(path);
+    auto roster = storage.load().takeResult();
+    QCOMPARE(roster.version, u"ver3"_s);
+    QCOMPARE(roster.items.size(), 1);
+    QCOMPARE(roster.items.first().bareJid(), u"romeo@montague.lit"_s);
+
+    storage.clear();
+    QVERIFY(!QFile::exists(path));
+    QVERIFY(storage.load().takeResult().items.isEmpty());
+}
+
+void tst_QXmppRosterManager::testPresences()
+{
+    auto createPresence = [](const QString &from, int priority) {
+        QXmppPresence presence;
+        presence.setFrom(from);
+        presence.setAvailableStatusType(QXmppPresence::Away);
+        presence.setPriority(priority);
+        presence.setStatusText(u"Out for lunch"_s);
+        presence.setCapabilityHash(u"sha-1"_s);
+        presence.setCapabilityNode(u"https://qxmpp.org"_s);
+        presence.setCapabilityVer(QByteArray::fromBase64("QgayPKawpkPSDYmwT/WM94uAlu0="));
+        presence.setPhotoHash(QByteArray::fromHex("01b87fcd030b72895ff8e88db57ec525450f000d"));
+        return presence;
+    };
+
+    Q_EMIT client.presenceReceived(createPresence(u"carol@example.org/phone"_s, 5));
+    Q_EMIT client.presenceReceived(createPresence(u"carol@example.org/laptop"_s, -1));
+
+    const auto presences = manager->presences(u"carol@example.org"_s);
+    QCOMPARE(presences.size(), 2);
+    QCOMPARE(manager->getResources(u"carol@example.org"_s), (QStringList { u"phone"_s, u"laptop"_s }));
+
+    auto phone = manager->presence(u"carol@example.org"_s, u"phone"_s);
+    const auto laptop = manager->presence(u"carol@example.org"_s, u"laptop"_s);
+    QVERIFY(phone);
+    QVERIFY(laptop);
+    QCOMPARE(phone->availableStatus, QXmppPresence::Away);
+    QCOMPARE(phone->priority, qint8(5));
+    QCOMPARE(laptop->priority, qint8(-1));
+    QCOMPARE(phone->statusText, u"Out for lunch"_s);
+    QCOMPARE(phone->capabilityNode, u"https://qxmpp.org"_s);
+    QVERIFY(phone->presence);
+    QCOMPARE(phone->presence->photoHash(), QByteArray::fromHex("01b87fcd030b72895ff8e88db57ec525450f000d"));
+
+    // entity capabilities are shared
+    QVERIFY(phone->capabilityNode.constData() == laptop->capabilityNode.constData());
+    QVERIFY(phone->capabilityVer.constData() == laptop->capabilityVer.constData());
+
+    // without full presences only the stored fields are returned
+    manager->setKeepFullPresences(false);
+    QVERIFY(!manager->keepsFullPresences());
+    Q_EMIT client.presenceReceived(createPresence(u"carol@example.org/phone"_s, 10));
+    phone = manager->presence(u"carol@example.org"_s, u"phone"_s);
+    QVERIFY(!phone->presence);
+
+    auto presence = manager->getPresence(u"carol@example.org"_s, u"phone"_s);
+    QCOMPARE(presence.type(), QXmppPresence::Available);
+    QCOMPARE(presence.from(), u"carol@example.org/phone"_s);
+    QCOMPARE(presence.priority(), 10);
+    QCOMPARE(presence.capabilityVer(), QByteArray::fromBase64("QgayPKawpkPSDYmwT/WM94uAlu0="));
+    QVERIFY(presence.photoHash().isEmpty());
+    QCOMPARE(manager->getAllPresencesForBareJid(u"carol@example.org"_s).size(), 2);
+
+    // unavailable resources are removed
+    QXmppPresence unavailable(QXmppPresence::Unavailable);
+    unavailable.setFrom(u"carol@example.org/phone"_s);
+    Q_EMIT client.presenceReceived(unavailable);
+    unavailable.setFrom(u"carol@example.org/laptop"_s);
+    Q_EMIT client.presenceReceived(unavailable);
+    QVERIFY(manager->presences(u"carol@example.org"_s).isEmpty());
+    QVERIFY(!manager->presence(u"carol@example.org"_s, u"phone"_s));
+    QCOMPARE(manager->getPresence(u"carol@example.org"_s, u"phone"_s).type(), QXmppPresence::Unavailable);
+
+    manager->setKeepFullPresences(true);
+}
+
 QTEST_MAIN(tst_QXmppRosterManager)
 #include "tst_qxmpprostermanager.moc"
@@ -5,6 +5,7 @@
 
 #include "QXmppConfiguration.h"
 #include "QXmppConstants_p.h"
+#include "QXmppPasswordChecker.h"
 #include "QXmppSasl2UserAgent.h"
 #include "QXmppSaslManager_p.h"
 #include "QXmppSasl_p.h"
@@ -103,6 +104,11 @@ private:
     Q_SLOT void testServerDigestMd5();
     Q_SLOT void testServerPlain();
     Q_SLOT void testServerPlainChallenge();
+    Q_SLOT void testServerScram_data();
+    Q_SLOT void testServerScram();
+    Q_SLOT void testServerScramBad();
+    Q_SLOT void benchmarkServerLogin_data();
+    Q_SLOT void benchmarkServerLogin();
 
     // SASL 1 client manager
     Q_SLOT void saslManagerNoMechanisms();
@@ -784,6 +790,193 @@ void tst_QXmppSasl::testServerPlainChallenge()
     QCOMPARE(server->respond(QByteArray(), response), QXmppSaslServer::Failed);
 }
 
+void tst_QXmppSasl::testServerScram_data()
+{
+    QTest::addColumn<QString>("mechanism");
+    QTest::addColumn<QByteArray>("serverNonce");
+    QTest::addColumn<QByteArray>("clientFirst");
+    QTest::addColumn<QByteArray>("serverFirst");
+    QTest::addColumn<QByteArray>("clientFinal");
+    QTest::addColumn<QByteArray>("serverFinal");
+
+    // test vectors from RFC 5802 and RFC 7677
+    QTest::newRow("SCRAM-SHA-1")
+        << u"SCRAM-SHA-1"_s
+        << QByteArray("3rfcNHYJY1ZVvWVs7j")
+        << QByteArray("n,,n=user,r=fyko+d2lbbFgONRv9qkxdawL")
+        << QByteArray("r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,s=QSXCR+Q6sek8bf92,i=4096")
+        << QByteArray("c=biws,r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,p=v0X8v3Bz2T0CJGbJQyF0X+HI4Ts=")
+        << QByteArray("v=rmF9pqV8S7suAoZWja4dJRkFsKQ=");
+    QTest::newRow("SCRAM-SHA-256")
+        << u"SCRAM-SHA-256"_s
+        << QByteArray("%hvYDpWUa2RaTCAfuxFIlj)hNlF$k0")
+        << QByteArray("n,,n=user,r=rOprNGfwEbeRWgbNEkqO")
+        << QByteArray("r=rOprNGfwEbeRWgbNEkqO%hvYDpWUa2RaTCAfuxFIlj)hNlF$k0,s=W22ZaJ0SNY7soEsUEjb6gQ==,i=4096")
+        << QByteArray("c=biws,r=rOprNGfwEbeRWgbNEkqO%hvYDpWUa2RaTCAfuxFIlj)hNlF$k0,p=dHzbZapWIk4jUhN+Ute9ytag9zjfMHgsqmmiz7AndVQ=")
+        << QByteArray("v=6rriTRBi23WpRR/wtup+mMhUZUn/dB5nLTJRsjl95G4=");
+}
+
+void tst_QXmppSasl::testServerScram()
+{
+    QFETCH(QString, mechanism);
+    QFETCH(QByteArray, serverNonce);
+    QFETCH(QByteArray, clientFirst);
+    QFETCH(QByteArray, serverFirst);
+    QFETCH(QByteArray, clientFinal);
+    QFETCH(QByteArray, serverFinal);
+
+    QXmppSaslDigestMd5::setNonce(serverNonce);
+
+    auto server = QXmppSaslServer::create(mechanism);
+    QVERIFY(server);
+    QCOMPARE(server->mechanism(), mechanism);
+    auto *scramServer = qobject_cast<QXmppSaslServerScram *>(server.get());
+    QVERIFY(scramServer);
+
+    // credentials needed
+    QByteArray response;
+    QCOMPARE(server->respond(clientFirst, response), QXmppSaslServer::InputNeeded);
+    QCOMPARE(server->username(), u"user"_s);
+
+    // the server only knows the stored keys
+    const auto salt = QByteArray::fromBase64(serverFirst.split(',').at(1).mid(2));
+    const auto credentials = QXmppScramCredentials::fromPassword(scramServer->scramMechanism().qtAlgorithm(), u"pencil"_s, salt, 4096);
+    scramServer->setCredentials(credentials.salt(), credentials.iterations(), credentials.storedKey(), credentials.serverKey());
+
+    // first challenge
+    QCOMPARE(server->respond(clientFirst, response), QXmppSaslServer::Challenge);
+    QCOMPARE(response, serverFirst);
+
+    // server signature
+    QCOMPARE(server->respond(clientFinal, response), QXmppSaslServer::Challenge);
+    QCOMPARE(response, serverFinal);
+
+    // success
+    QCOMPARE(server->respond(QByteArray(), response), QXmppSaslServer::Succeeded);
+    QCOMPARE(response, QByteArray());
+
+    // any further step is an error
+    QCOMPARE(server->respond(QByteArray(), response), QXmppSaslServer::Failed);
+}
+
+void tst_QXmppSasl::testServerScramBad()
+{
+    QXmppSaslDigestMd5::setNonce("3rfcNHYJY1ZVvWVs7j");
+    const QByteArray clientFirst("n,,n=user,r=fyko+d2lbbFgONRv9qkxdawL");
+    const auto credentials = QXmppScramCredentials::fromPassword(QCryptographicHash::Sha1, u"pencil"_s, QByteArray::fromBase64("QSXCR+Q6sek8bf92"), 4096);
+
+    auto createServer = [&] {
+        auto server = QXmppSaslServer::create("SCRAM-SHA-1");
+        qobject_cast<QXmppSaslServerScram *>(server.get())->setCredentials(credentials.salt(), credentials.iterations(), credentials.storedKey(), credentials.serverKey());
+        return server;
+    };
+    QByteArray response;
+
+    // channel binding and authorization identities are not supported
+    QCOMPARE(createServer()->respond("p=tls-unique,,n=user,r=fyko+d2lbbFgONRv9qkxdawL", response), QXmppSaslServer::Failed);
+    QCOMPARE(createServer()->respond("n,a=admin,n=user,r=fyko+d2lbbFgONRv9qkxdawL", response), QXmppSaslServer::Failed);
+
+    // invalid username encoding
+    QCOMPARE(createServer()->respond("n,,n=us=er,r=fyko+d2lbbFgONRv9qkxdawL", response), QXmppSaslServer::Failed);
+
+    // no credentials (unknown user): the salt does not change between attempts, the proof fails
+    auto server = QXmppSaslServer::create("SCRAM-SHA-1");
+    QCOMPARE(server->respond(clientFirst, response), QXmppSaslServer::InputNeeded);
+    QCOMPARE(server->respond(clientFirst, response), QXmppSaslServer::Challenge);
+    const auto unknownUserSalt = response.split(',').at(1);
+    QCOMPARE(response.split(',').at(2), QByteArray("i=4096"));
+    QCOMPARE(server->respond("c=biws,r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,p=v0X8v3Bz2T0CJGbJQyF0X+HI4Ts=", response), QXmppSaslServer::Failed);
+
+    server = QXmppSaslServer::create("SCRAM-SHA-1");
+    QCOMPARE(server->respond(clientFirst, response), QXmppSaslServer::InputNeeded);
+    QCOMPARE(server->respond(clientFirst, response), QXmppSaslServer::Challenge);
+    QCOMPARE(response.split(',').at(1), unknownUserSalt);
+
+    server = QXmppSaslServer::create("SCRAM-SHA-1");
+    QCOMPARE(server->respond("n,,n=other,r=fyko+d2lbbFgONRv9qkxdawL", response), QXmppSaslServer::InputNeeded);
+    QCOMPARE(server->respond(clientFirst, response), QXmppSaslServer::Challenge);
+    QVERIFY(response.split(',').at(1) != unknownUserSalt);
+
+    // wrong proof
+    server = createServer();
+    QCOMPARE(server->respond(clientFirst, response), QXmppSaslServer::InputNeeded);
+    QCOMPARE(server->respond(clientFirst, response), QXmppSaslServer::Challenge);
+    QCOMPARE(server->respond("c=biws,r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,p=AAAAAAAAAAAAAAAAAAAAAAAAAAA=", response), QXmppSaslServer::Failed);
+
+    // wrong nonce
+    server = createServer();
+    QCOMPARE(server->respond(clientFirst, response), QXmppSaslServer::InputNeeded);
+    QCOMPARE(server->respond(clientFirst, response), QXmppSaslServer::Challenge);
+    QCOMPARE(server->respond("c=biws,r=fyko+d2lbbFgONRv9qkxdawL,p=v0X8v3Bz2T0CJGbJQyF0X+HI4Ts=", response), QXmppSaslServer::Failed);
+}
+
+void tst_QXmppSasl::benchmarkServerLogin_data()
+{
+    QTest::addColumn<QString>("mechanism");
+    QTest::addColumn<bool>("storedKeys");
+
+    QTest::newRow("PLAIN") << u"PLAIN"_s << true;
+    QTest::newRow("SCRAM-SHA-1") << u"SCRAM-SHA-1"_s << true;
+    QTest::newRow("SCRAM-SHA-256") << u"SCRAM-SHA-256"_s << true;
+    QTest::newRow("SCRAM-SHA-512") << u"SCRAM-SHA-512"_s << true;
+    // default QXmppPasswordChecker::getScramCredentials(): keys are derived on every login
+    QTest::newRow("SCRAM-SHA-256-from-password") << u"SCRAM-SHA-256"_s << false;
+}
+
+// Server side cost of one login, e.g. while all clients reconnect after a server restart.
+void tst_QXmppSasl::benchmarkServerLogin()
+{
+    QFETCH(QString, mechanism);
+    QFETCH(bool, storedKeys);
+
+    const auto password = u"pencil"_s;
+    const auto salt = QByteArray::fromBase64("QSXCR+Q6sek8bf92");
+    const auto algorithm = SaslScramMechanism::fromString(mechanism).value_or(SaslScramMechanism { SaslScramMechanism::Sha1 }).qtAlgorithm();
+    const auto credentials = QXmppScramCredentials::fromPassword(algorithm, password, salt, 4096);
+
+    // with a fixed nonce the messages of the client are the same for every login
+    QXmppSaslDigestMd5::setNonce("fyko+d2lbbFgONRv9qkxdawL");
+    auto client = QXmppSaslClient::create(mechanism);
+    client->setUsername(u"user"_s);
+    client->setCredentials(Credentials { .password = password });
+    const auto clientFirst = *client->respond({});
+
+    auto login = [&](const QByteArray &clientFinal) {
+        auto server = QXmppSaslServer::create(mechanism);
+        QByteArray response;
+        if (server->respond(clientFirst, response) != QXmppSaslServer::InputNeeded) {
+            return QByteArray();
+        }
+        if (auto *scramServer = qobject_cast<QXmppSaslServerScram *>(server.get())) {
+            const auto serverCredentials = storedKeys ? credentials : QXmppScramCredentials::fromPassword(algorithm, password, salt, 4096);
+            scramServer->setCredentials(serverCredentials.salt(), serverCredentials.iterations(), serverCredentials.storedKey(), serverCredentials.serverKey());
+            server->respond(clientFirst, response);
+            server->respond(clientFinal, response);
+        } else if (server->password() != password) {
+            return QByteArray();
+        }
+        return response;
+    };
+
+    QByteArray clientFinal;
+    if (mechanism != u"PLAIN") {
+        // complete one login with the client to get its final message
+        auto server = QXmppSaslServer::create(mechanism);
+        QByteArray serverFirst;
+        server->respond(clientFirst, serverFirst);
+        qobject_cast<QXmppSaslServerScram *>(server.get())->setCredentials(credentials.salt(), credentials.iterations(), credentials.storedKey(), credentials.serverKey());
+        QCOMPARE(server->respond(clientFirst, serverFirst), QXmppSaslServer::Challenge);
+        clientFinal = *client->respond(serverFirst);
+
+        // the client accepts the server signature
+        QCOMPARE(client->respond(login(clientFinal)), QByteArray());
+    }
+
+    QBENCHMARK {
+        login(clientFinal);
+    }
+}
+
 void tst_QXmppSasl::saslManagerNoMechanisms()
 {
     SaslManagerTest test;
@@ -3,10 +3,95 @@
 // SPDX-License-Identifier: LGPL-2.1-or-later
 
 #include "QXmppClient.h"
+#include "QXmppIncomingClient.h"
+#include "QXmppIncomingClient_p.h"
+#include "QXmppMessage.h"
+#include "QXmppOutgoingServer.h"
+#include "QXmppMetrics.h"
 #include "QXmppServer.h"
+#include "QXmppServerExtension.h"
 
+#include "TimerWheel.h"
 #include "util.h"
 
+#include <QRegularExpression>
+#include <QSslSocket>
+#include <QTcpSocket>
+
+// Client that writes the XMPP stream by hand, so the connection can be dropped at any point.
+class RawClient
+{
+public:
+    RawClient()
+    {
+        QObject::connect(&socket, &QTcpSocket::readyRead, [this] { received += socket.readAll(); });
+    }
+
+    // Connects, authenticates and binds a resource.
+    bool login(quint16 port, const QByteArray &user, const QByteArray &password)
+    {
+        socket.connectToHost(QHostAddress::LocalHost, port);
+        send(streamHeader());
+        if (!waitFor("</mechanisms>")) {
+            return false;
+        }
+        send("<auth xmlns='urn:ietf:params:xml:ns:xmpp-sasl' mechanism='PLAIN'>" + QByteArray('\0' + user + '\0' + password).toBase64() + "</auth>");
+        if (!waitFor("<success")) {
+            return false;
+        }
+        received.clear();
+        send(streamHeader());
+        return waitFor("urn:ietf:params:xml:ns:xmpp-bind");
+    }
+
+    void send(const QByteArray &data) { socket.write(data); }
+
+    // Waits until the received data contains the text.
+    bool waitFor(const QByteArray &text)
+    {
+        for (int i = 0; i < 500 && !received.contains(text); i++) {
+            QTest::qWait(10);
+        }
+        return received.contains(text);
+    }
+
+    static QByteArray streamHeader()
+    {
+        return "<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams' to='localhost' version='1.0'>";
+    }
+
+    QTcpSocket socket;
+    QByteArray received;
+};
+
+// Extension that records the stanzas it is offered.
+class TestExtension : public QXmppServerExtension
+{
+    Q_OBJECT
+public:
+    TestExtension(const QString &name, int priority, StanzaTypes types, const QStringList &namespaces, QStringList &calls)
+        : m_name(name), m_priority(priority), m_types(types), m_namespaces(namespaces), m_calls(calls)
+    {
+    }
+
+    QString extensionName() const override { return m_name; }
+    int extensionPriority() const override { return m_priority; }
+    StanzaTypes handledStanzaTypes() const override { return m_types; }
+    QStringList handledNamespaces() const override { return m_namespaces; }
+    bool handleStanza(const QDomElement &stanza) override
+    {
+        m_calls.append(m_name);
+        return stanza.attribute(u"handler"_s) == m_name;
+    }
+
+private:
+    QString m_name;
+    int m_priority;
+    StanzaTypes m_types;
+    QStringList m_namespaces;
+    QStringList &m_calls;
+};
+
 class tst_QXmppServer : public QObject
 {
     Q_OBJECT
@@ -14,6 +99,13 @@ class tst_QXmppServer : public QObject
 private:
     Q_SLOT void testConnect_data();
     Q_SLOT void testConnect();
+    Q_SLOT void testWorkerThreads();
+    Q_SLOT void testStreamResumption();
+    Q_SLOT void testStreamResumptionTimeout();
+    Q_SLOT void testInactivityTimeout();
+    Q_SLOT void testOutgoingServerQueueLimit();
+    Q_SLOT void testExtensionDispatch();
+    Q_SLOT void testOutgoingServerBounce();
 };
 
 void tst_QXmppServer::testConnect_data()
@@ -42,6 +134,22 @@ void tst_QXmppServer::testConnect_data()
     QTest::newRow("digest-bad-password") << "testuser"
                                          << "badpwd"
                                          << "DIGEST-MD5" << false;
+
+    QTest::newRow("scram-sha1-good") << "testuser"
+                                     << "testpwd"
+                                     << "SCRAM-SHA-1" << true;
+    QTest::newRow("scram-sha256-good") << "testuser"
+                                       << "testpwd"
+                                       << "SCRAM-SHA-256" << true;
+    QTest::newRow("scram-sha512-good") << "testuser"
+                                       << "testpwd"
+                                       << "SCRAM-SHA-512" << true;
+    QTest::newRow("scram-bad-username") << "baduser"
+                                        << "testpwd"
+                                        << "SCRAM-SHA-256" << false;
+    QTest::newRow("scram-bad-password") << "testuser"
+                                        << "badpwd"
+                                        << "SCRAM-SHA-256" << false;
 }
 
 void tst_QXmppServer::testConnect()
@@ -89,5 +197,329 @@ void tst_QXmppServer::testConnect()
     QCOMPARE(client.isConnected(), connected);
 }
 
+void tst_QXmppServer::testWorkerThreads()
+{
+    const QString testDomain("localhost");
+    const QHostAddress testHost(QHostAddress::LocalHost);
+    const quint16 testPort = 12346;
+
+    TestPasswordChecker passwordChecker;
+    passwordChecker.addCredentials("alice", "alicepwd");
+    passwordChecker.addCredentials("bob", "bobpwd");
+
+    auto metrics = std::make_shared<QXmppMetrics>();
+    QXmppLogger logger;
+    logger.setLoggingType(QXmppLogger::SignalLogging);
+    logger.setMetrics(metrics);
+    QSignalSpy logSpy(&logger, &QXmppLogger::message);
+
+    QXmppServer server;
+    server.setLogger(&logger);
+    server.setDomain(testDomain);
+    server.setPasswordChecker(&passwordChecker);
+    server.setWorkerThreadCount(2);
+    QCOMPARE(server.workerThreadCount(), 2);
+    QVERIFY(server.listenForClients(testHost, testPort));
+    QCOMPARE(server.statistics().value(u"worker-threads"_s).toInt(), 2);
+
+    // the clients are put into different workers
+    QXmppClient alice;
+    QXmppClient bob;
+    for (auto [client, user] : { std::pair { &alice, u"alice"_s }, std::pair { &bob, u"bob"_s } }) {
+        QXmppConfiguration config;
+        config.setDomain(testDomain);
+        config.setHost(testHost.toString());
+        config.setPort(testPort);
+        config.setUser(user);
+        config.setPassword(user + u"pwd");
+        config.setSaslAuthMechanism(u"PLAIN"_s);
+        config.setDisabledSaslMechanisms({});
+
+        QSignalSpy connectedSpy(client, &QXmppClient::connected);
+        client->connectToServer(config);
+        QVERIFY(connectedSpy.wait());
+    }
+    QCOMPARE(server.statistics().value(u"incoming-clients"_s).toInt(), 2);
+
+    // log messages and metrics of the worker threads reach the server's logger
+    QTRY_COMPARE(metrics->counter(u"incoming-client.auth.success"_s)->value(), qint64(2));
+    QVERIFY(std::any_of(logSpy.cbegin(), logSpy.cend(), [](const QList<QVariant> &args) {
+        return args.constFirst().toInt() == QXmppLogger::ReceivedMessage;
+    }));
+
+    // the streams of the workers follow the settings of the logger
+    logger.setMessageTypes(QXmppLogger::WarningMessage);
+    logger.setMessageTypes(QXmppLogger::AnyMessage);
+    logSpy.clear();
+
+    // stanzas are routed between the workers
+    QSignalSpy messageSpy(&bob, &QXmppClient::messageReceived);
+    QXmppMessage message(alice.configuration().jid(), bob.configuration().jid(), u"Hello"_s);
+    alice.sendPacket(message);
+    QVERIFY(messageSpy.wait());
+    QCOMPARE(messageSpy.constFirst().constFirst().value<QXmppMessage>().body(), u"Hello"_s);
+    QTRY_VERIFY(std::any_of(logSpy.cbegin(), logSpy.cend(), [](const QList<QVariant> &args) {
+        return args.constFirst().toInt() == QXmppLogger::ReceivedMessage;
+    }));
+
+    // disconnected clients are removed
+    QSignalSpy disconnectedSpy(&server, &QXmppServer::clientDisconnected);
+    alice.disconnectFromServer();
+    bob.disconnectFromServer();
+    QTRY_COMPARE(disconnectedSpy.size(), 2);
+    QCOMPARE(server.statistics().value(u"incoming-clients"_s).toInt(), 0);
+}
+
+void tst_QXmppServer::testStreamResumption()
+{
+    const quint16 testPort = 12347;
+
+    TestPasswordChecker passwordChecker;
+    passwordChecker.addCredentials("testuser", "testpwd");
+
+    QXmppServer server;
+    server.setDomain(u"localhost"_s);
+    server.setPasswordChecker(&passwordChecker);
+    QVERIFY(server.listenForClients(QHostAddress::LocalHost, testPort));
+    QSignalSpy disconnectedSpy(&server, &QXmppServer::clientDisconnected);
+
+    // enable stream management with resumption
+    RawClient first;
+    QVERIFY(first.login(testPort, "testuser", "testpwd"));
+    first.send("<iq type='set' id='bind1'><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'><resource>phone</resource></bind></iq>");
+    QVERIFY(first.waitFor("testuser@localhost/phone"));
+    first.send("<enable xmlns='urn:xmpp:sm:3' resume='true'/>");
+    QVERIFY(first.waitFor("<enabled"));
+    const auto match = QRegularExpression(uR"(<enabled[^>]*\sid=["']([^"']+)["'])"_s).match(QString::fromUtf8(first.received));
+    QVERIFY(match.hasMatch());
+    const auto resumptionId = match.captured(1).toUtf8();
+
+    server.sendPacket(QXmppMessage(u"localhost"_s, u"testuser@localhost/phone"_s, u"first"_s));
+    QVERIFY(first.waitFor("<body>first</body>"));
+
+    // the connection is lost, the session is kept
+    first.socket.abort();
+    QTRY_COMPARE(server.statistics().value(u"detached-sessions"_s).toInt(), 1);
+    server.sendPacket(QXmppMessage(u"localhost"_s, u"testuser@localhost/phone"_s, u"second"_s));
+    QCOMPARE(disconnectedSpy.size(), 0);
+
+    // unknown sessions can not be resumed
+    RawClient second;
+    QVERIFY(second.login(testPort, "testuser", "testpwd"));
+    second.send("<resume xmlns='urn:xmpp:sm:3' h='1' previd='unknown'/>");
+    QVERIFY(second.waitFor("<failed"));
+
+    // the client has received the first message, only the second one is resent
+    second.received.clear();
+    second.send("<resume xmlns='urn:xmpp:sm:3' h='1' previd='" + resumptionId + "'/>");
+    QVERIFY(second.waitFor("<resumed"));
+    QVERIFY(second.waitFor("<body>second</body>"));
+    QVERIFY(!second.received.contains("<body>first</body>"));
+    QTRY_COMPARE(server.statistics().value(u"incoming-clients"_s).toInt(), 1);
+    QCOMPARE(server.statistics().value(u"detached-sessions"_s).toInt(), 0);
+    QCOMPARE(disconnectedSpy.size(), 0);
+
+    // stanzas are routed to the new stream
+    server.sendPacket(QXmppMessage(u"localhost"_s, u"testuser@localhost/phone"_s, u"third"_s));
+    QVERIFY(second.waitFor("<body>third</body>"));
+
+    // closing the stream ends the session
+    second.send("</stream:stream>");
+    QTRY_COMPARE(disconnectedSpy.size(), 1);
+    QCOMPARE(server.statistics().value(u"detached-sessions"_s).toInt(), 0);
+}
+
+void tst_QXmppServer::testStreamResumptionTimeout()
+{
+    const quint16 testPort = 12348;
+
+    TestPasswordChecker passwordChecker;
+    passwordChecker.addCredentials("testuser", "testpwd");
+
+    QXmppServer server;
+    server.setDomain(u"localhost"_s);
+    server.setPasswordChecker(&passwordChecker);
+    server.setStreamResumptionTimeout(1);
+    QVERIFY(server.listenForClients(QHostAddress::LocalHost, testPort));
+    QSignalSpy disconnectedSpy(&server, &QXmppServer::clientDisconnected);
+
+    RawClient client;
+    QVERIFY(client.login(testPort, "testuser", "testpwd"));
+    client.send("<iq type='set' id='bind1'><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'><resource>phone</resource></bind></iq>");
+    QVERIFY(client.waitFor("testuser@localhost/phone"));
+    client.send("<enable xmlns='urn:xmpp:sm:3' resume='true'/>");
+    QVERIFY(client.waitFor("<enabled"));
+
+    client.socket.abort();
+    QTRY_COMPARE(server.statistics().value(u"detached-sessions"_s).toInt(), 1);
+    QCOMPARE(disconnectedSpy.size(), 0);
+
+    // the session is dropped after the resumption timeout
+    QTRY_COMPARE_WITH_TIMEOUT(disconnectedSpy.size(), 1, 5000);
+    QCOMPARE(server.statistics().value(u"detached-sessions"_s).toInt(), 0);
+    QCOMPARE(server.statistics().value(u"incoming-clients"_s).toInt(), 0);
+}
+
+void tst_QXmppServer::testInactivityTimeout()
+{
+    using namespace std::chrono_literals;
+
+    auto wheel = createIdleTimerWheel(10ms);
+    QXmppIncomingClient client(new QSslSocket, u"localhost"_s);
+    client.setIdleTimerWheel(wheel.get());
+    client.setInactivityTimeout(200ms);
+    QCOMPARE(wheel->size(), std::size_t(1));
+    const auto expiry = wheel->coarseTime() + 200;
+
+    QSignalSpy disconnectedSpy(&client, &QXmppIncomingClient::disconnected);
+    const auto ack = xmlToDom(u"<a xmlns='urn:xmpp:sm:3' h='0'/>"_s);
+
+    // activity postpones the timeout: the client is rescheduled when the original timeout expires
+    const auto start = wheel->coarseTime();
+    QVERIFY(QTest::qWaitFor([&] { return wheel->coarseTime() > start; }));
+    QVERIFY(wheel->coarseTime() < expiry);
+    client.handleStanza(ack);
+    QVERIFY(QTest::qWaitFor([&] { return wheel->coarseTime() >= expiry; }));
+    QCOMPARE(disconnectedSpy.size(), 0);
+    QCOMPARE(wheel->size(), std::size_t(1));
+
+    QVERIFY(disconnectedSpy.wait(1000));
+    QCOMPARE(wheel->size(), std::size_t(0));
+}
+
+void tst_QXmppServer::testOutgoingServerQueueLimit()
+{
+    QXmppOutgoingServer stream(u"example.com"_s, nullptr);
+    stream.setQueueLimit(100);
+    QCOMPARE(stream.queueLimit(), qsizetype(100));
+
+    QSignalSpy droppedSpy(&stream, &QXmppOutgoingServer::dataDropped);
+    QSignalSpy queueSpy(&stream, &QXmppOutgoingServer::queueSizeChanged);
+    // sum of the reported changes
+    auto reportedQueue = [&] {
+        std::pair<qsizetype, qsizetype> queue;
+        for (const auto &args : std::as_const(queueSpy)) {
+            queue.first += args.at(0).value<qsizetype>();
+            queue.second += args.at(1).value<qsizetype>();
+        }
+        return queue;
+    };
+
+    const QByteArray first = "<message id='1' from='a@example.com' to='b@example.org'/>";
+    const QByteArray second = "<message id='2' from='a@example.com' to='b@example.org'/>";
+    stream.queueData(first);
+    QCOMPARE(stream.queuedBytes(), first.size());
+    QCOMPARE(droppedSpy.size(), 0);
+    QCOMPARE(reportedQueue(), std::pair(qsizetype(1), first.size()));
+
+    // the oldest stanza is dropped
+    stream.queueData(second);
+    QCOMPARE(stream.queuedBytes(), second.size());
+    QCOMPARE(droppedSpy.size(), 1);
+    QCOMPARE(droppedSpy.constFirst().constFirst().toByteArray(), first);
+
+    // a stanza exceeding the limit on its own is dropped, too
+    const auto large = QByteArray("<message><body>") + QByteArray(100, 'a') + QByteArray("</body></message>");
+    stream.queueData(large);
+    QCOMPARE(stream.queuedBytes(), qsizetype(0));
+    QCOMPARE(droppedSpy.size(), 3);
+    QCOMPARE(droppedSpy.at(1).constFirst().toByteArray(), second);
+    QCOMPARE(droppedSpy.at(2).constFirst().toByteArray(), large);
+    QCOMPARE(reportedQueue(), std::pair(qsizetype(0), qsizetype(0)));
+}
+
+void tst_QXmppServer::testOutgoingServerBounce()
+{
+    const QString testDomain("localhost");
+    const QHostAddress testHost(QHostAddress::LocalHost);
+    const quint16 testPort = 12349;
+
+    TestPasswordChecker passwordChecker;
+    passwordChecker.addCredentials("alice", "alicepwd");
+
+    QXmppServer server;
+    server.setDomain(testDomain);
+    server.setPasswordChecker(&passwordChecker);
+    // every stanza exceeds the limit
+    server.setOutgoingServerQueueLimit(1);
+    QCOMPARE(server.outgoingServerQueueLimit(), qsizetype(1));
+    QVERIFY(server.listenForClients(testHost, testPort));
+    // enables S2S routing
+    QVERIFY(server.listenForServers(testHost, 0));
+
+    QXmppClient alice;
+    QXmppConfiguration config;
+    config.setDomain(testDomain);
+    config.setHost(testHost.toString());
+    config.setPort(testPort);
+    config.setUser(u"alice"_s);
+    config.setPassword(u"alicepwd"_s);
+    config.setSaslAuthMechanism(u"PLAIN"_s);
+    config.setDisabledSaslMechanisms({});
+    QSignalSpy connectedSpy(&alice, &QXmppClient::connected);
+    alice.connectToServer(config);
+    QVERIFY(connectedSpy.wait());
+
+    // the sender receives an error from the remote domain
+    QSignalSpy messageSpy(&alice, &QXmppClient::messageReceived);
+    QXmppMessage message(alice.configuration().jid(), u"bob@remote.invalid"_s, u"Hello"_s);
+    message.setId(u"msg1"_s);
+    alice.sendPacket(message);
+    QVERIFY(messageSpy.wait());
+
+    const auto error = messageSpy.constFirst().constFirst().value<QXmppMessage>();
+    QCOMPARE(error.type(), QXmppMessage::Error);
+    QCOMPARE(error.id(), u"msg1"_s);
+    QCOMPARE(error.from(), u"bob@remote.invalid"_s);
+    const auto stanzaError = error.errorOptional();
+    QVERIFY(stanzaError);
+    QCOMPARE(stanzaError->type(), QXmppStanza::Error::Wait);
+    QCOMPARE(stanzaError->condition(), QXmppStanza::Error::RemoteServerTimeout);
+}
+
+void tst_QXmppServer::testExtensionDispatch()
+{
+    auto metrics = std::make_shared<QXmppMetrics>();
+    QXmppLogger logger;
+    logger.setMetrics(metrics);
+
+    QStringList calls;
+    QXmppServer server;
+    server.setDomain(u"example.com"_s);
+    server.setLogger(&logger);
+    server.addExtension(new TestExtension(u"all"_s, 0, QXmppServerExtension::AnyStanza, {}, calls));
+    server.addExtension(new TestExtension(u"version"_s, 10, QXmppServerExtension::IqStanza, { u"jabber:iq:version"_s }, calls));
+    server.addExtension(new TestExtension(u"disco"_s, 5, QXmppServerExtension::IqStanza, { u"http://jabber.org/protocol/disco#info"_s, u"http://jabber.org/protocol/disco#items"_s }, calls));
+    server.addExtension(new TestExtension(u"receipts"_s, 20, QXmppServerExtension::MessageStanza, { u"urn:xmpp:receipts"_s }, calls));
+
+    auto handle = [&](const QString &xml) {
+        calls.clear();
+        server.handleElement(xmlToDom(xml));
+        return calls;
+    };
+
+    // extensions are called by priority, extensions for other payloads are skipped
+    QCOMPARE(handle(u"<iq xmlns='jabber:client' type='get' id='1' from='a@example.com/r' to='example.com'><query xmlns='jabber:iq:version'/></iq>"_s),
+             (QStringList { u"version"_s, u"all"_s }));
+    QCOMPARE(handle(u"<iq xmlns='jabber:client' type='get' id='2' from='a@example.com/r' to='example.com'><query xmlns='http://jabber.org/protocol/disco#items'/></iq>"_s),
+             (QStringList { u"disco"_s, u"all"_s }));
+    // extensions for other kinds of stanzas are skipped
+    QCOMPARE(handle(u"<message xmlns='jabber:client' to='b@example.com'><body>Hi</body><request xmlns='urn:xmpp:receipts'/><query xmlns='jabber:iq:version'/></message>"_s),
+             (QStringList { u"receipts"_s, u"all"_s }));
+    QCOMPARE(handle(u"<presence xmlns='jabber:client' to='b@example.com'/>"_s), QStringList { u"all"_s });
+    // dispatch stops at the extension that handles the stanza
+    QCOMPARE(handle(u"<iq xmlns='jabber:client' type='get' id='3' handler='version' to='example.com'><query xmlns='jabber:iq:version'/></iq>"_s),
+             QStringList { u"version"_s });
+
+    // extensions added later are indexed, too
+    server.addExtension(new TestExtension(u"late"_s, 30, QXmppServerExtension::PresenceStanza, {}, calls));
+    QCOMPARE(handle(u"<presence xmlns='jabber:client' to='b@example.com'/>"_s), (QStringList { u"late"_s, u"all"_s }));
+
+    // the handling time is recorded per extension
+    QCOMPARE(metrics->histogram(u"server.extension.version.handle-seconds"_s)->count(), quint64(2));
+    QCOMPARE(metrics->histogram(u"server.extension.all.handle-seconds"_s)->count(), quint64(5));
+    QCOMPARE(metrics->histogram(u"server.route-seconds"_s)->count(), quint64(6));
+}
+
 QTEST_MAIN(tst_QXmppServer)
 #include "tst_qxmppserver.moc"
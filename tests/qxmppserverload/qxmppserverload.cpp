@@ -0,0 +1,596 @@
+// SPDX-FileCopyrightText: 2026 QXmpp Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+//
+// Load generator for QXmppServer
+//
+// Starts a server on the loopback interface and connects a number of QXmppClients to it from
+// several threads. The clients then send a mix of messages, directed presences and IQs to each
+// other and to the server. The connection rate, the stanza throughput, the delivery latencies and
+// the memory usage of the process are reported at the end.
+//
+// Everything runs in one process and no network access is needed, e.g.:
+//
+//   qxmppserverload --clients 2000 --threads 4 --server-threads 2 --duration 30 --rate 2
+//
+
+#include "QXmppClient.h"
+#include "QXmppLogger.h"
+#include "QXmppMessage.h"
+#include "QXmppPasswordChecker.h"
+#include "QXmppPingIq.h"
+#include "QXmppPresence.h"
+#include "QXmppServer.h"
+#include "QXmppTask.h"
+
+#include "StringLiterals.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QThread>
+#include <QTimer>
+
+using namespace std::chrono_literals;
+
+enum StanzaKind {
+    Message,
+    Presence,
+    Iq,
+    StanzaKindCount,
+};
+
+constexpr std::array<const char *, StanzaKindCount> STANZA_KIND_NAMES = { "message", "presence", "iq" };
+
+// Password of all test accounts.
+constexpr QStringView PASSWORD = u"password";
+
+struct LoadConfig {
+    int clients = 100;
+    int threads = 4;
+    int serverThreads = 0;
+    // seconds of load after all clients have connected
+    int duration = 10;
+    // stanzas per client and second
+    double rate = 1.0;
+    // relative shares of the stanza kinds
+    std::array<int, StanzaKindCount> mix = { 70, 20, 10 };
+    // maximum number of connection attempts in progress per thread
+    int connectBatch = 32;
+    QString domain = u"localhost"_s;
+    QString mechanism = u"PLAIN"_s;
+    quint16 port = 0;
+};
+
+// Returns a monotonic timestamp in nanoseconds, comparable between threads.
+static qint64 timestamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Returns the resident set size of the process in bytes, or 0 if it is not available.
+static qint64 residentSetSize()
+{
+    QFile file(u"/proc/self/status"_s);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    while (!file.atEnd()) {
+        const auto line = file.readLine();
+        if (line.startsWith("VmRSS:")) {
+            // e.g. "VmRSS:     12345 kB"
+            return line.mid(6).trimmed().split(' ').constFirst().toLongLong() * 1024;
+        }
+    }
+    return 0;
+}
+
+// Returns a free TCP port on the loopback interface.
+static quint16 freePort()
+{
+    QTcpServer server;
+    server.listen(QHostAddress::LocalHost, 0);
+    return server.serverPort();
+}
+
+// Runs the event loop until the predicate is true or the timeout has expired.
+static bool waitUntil(const std::function<bool()> &predicate, std::chrono::milliseconds timeout)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QEventLoop loop;
+    QTimer poll;
+    QObject::connect(&poll, &QTimer::timeout, &loop, [&] {
+        if (predicate() || timer.elapsed() >= timeout.count()) {
+            loop.quit();
+        }
+    });
+    poll.start(10ms);
+    if (!predicate()) {
+        loop.exec();
+    }
+    return predicate();
+}
+
+//
+// Latency histogram with logarithmic buckets: 16 buckets per power of two, so the percentiles are
+// accurate to about 6 % and long runs do not need more memory.
+//
+class LatencyHistogram
+{
+public:
+    void record(qint64 nsecs)
+    {
+        m_buckets[bucketIndex(quint64(std::max<qint64>(nsecs, 0)))]++;
+        m_count++;
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (std::size_t i = 0; i < m_buckets.size(); i++) {
+            m_buckets[i] += other.m_buckets[i];
+        }
+        m_count += other.m_count;
+    }
+
+    quint64 count() const { return m_count; }
+
+    // Returns the lower bound of the bucket that contains the percentile, in nanoseconds.
+    qint64 percentile(double p) const
+    {
+        if (m_count == 0) {
+            return 0;
+        }
+        const auto rank = std::max<quint64>(1, quint64(p * double(m_count) + 0.5));
+        quint64 cumulative = 0;
+        for (std::size_t i = 0; i < m_buckets.size(); i++) {
+            cumulative += m_buckets[i];
+            if (cumulative >= rank) {
+                return qint64(lowerBound(i));
+            }
+        }
+        return qint64(lowerBound(m_buckets.size() - 1));
+    }
+
+private:
+    static constexpr std::size_t SUB_BUCKETS = 16;
+
+    static std::size_t bucketIndex(quint64 value)
+    {
+        if (value < SUB_BUCKETS) {
+            return value;
+        }
+        const auto exponent = std::size_t(std::bit_width(value) - 1);
+        const auto subBucket = std::size_t(value >> (exponent - 4)) - SUB_BUCKETS;
+        return SUB_BUCKETS + (exponent - 4) * SUB_BUCKETS + subBucket;
+    }
+
+    static quint64 lowerBound(std::size_t index)
+    {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        const auto exponent = (index - SUB_BUCKETS) / SUB_BUCKETS + 4;
+        const auto subBucket = (index - SUB_BUCKETS) % SUB_BUCKETS;
+        return quint64(SUB_BUCKETS + subBucket) << (exponent - 4);
+    }
+
+    std::array<quint64, 1024> m_buckets = {};
+    quint64 m_count = 0;
+};
+
+using Latencies = std::array<LatencyHistogram, StanzaKindCount>;
+
+// Counters shared by all threads.
+struct LoadStatistics {
+    std::atomic<int> connected = 0;
+    std::atomic<int> connectFailures = 0;
+    std::array<std::atomic<quint64>, StanzaKindCount> sent = {};
+    std::array<std::atomic<quint64>, StanzaKindCount> received = {};
+};
+
+// Accepts every user with the common password.
+class LoadPasswordChecker : public QXmppPasswordChecker
+{
+public:
+    QXmppPasswordReply::Error getPassword(const QXmppPasswordRequest &, QString &password) override
+    {
+        password = PASSWORD.toString();
+        return QXmppPasswordReply::NoError;
+    }
+
+    bool hasGetPassword() const override { return true; }
+};
+
+//
+// The clients of one thread. All methods are called in that thread.
+//
+class ClientGroup : public QObject
+{
+    Q_OBJECT
+public:
+    ClientGroup(const LoadConfig &config, int firstIndex, int count, LoadStatistics &statistics)
+        : m_config(config),
+          m_firstIndex(firstIndex),
+          m_count(count),
+          m_statistics(statistics),
+          m_loadTimer(this)
+    {
+        connect(&m_loadTimer, &QTimer::timeout, this, &ClientGroup::sendLoad);
+    }
+
+    void connectClients()
+    {
+        m_clients.reserve(m_count);
+        for (int i = 0; i < m_count; i++) {
+            m_clients.push_back(createClient(m_firstIndex + i));
+        }
+        for (int i = 0; i < m_config.connectBatch; i++) {
+            connectNext();
+        }
+    }
+
+    void startLoad()
+    {
+        m_loadClock.start();
+        m_lastTick = 0;
+        m_budget = 0;
+        m_loadTimer.start(10ms);
+    }
+
+    void stopLoad() { m_loadTimer.stop(); }
+
+    Latencies latencies() const { return m_latencies; }
+
+    void disconnectClients()
+    {
+        for (auto *client : m_clients) {
+            client->disconnectFromServer();
+        }
+    }
+
+private:
+    static QString userName(int index) { return u"load%1"_s.arg(index); }
+
+    QString bareJid(int index) const { return userName(index) + u'@' + m_config.domain; }
+
+    QXmppClient *createClient(int index)
+    {
+        auto *client = new QXmppClient(QXmppClient::NoExtensions, this);
+        client->setLogger(nullptr);
+
+        connect(client, &QXmppClient::connected, this, [this, client] {
+            if (!client->property("loadConnected").toBool()) {
+                client->setProperty("loadConnected", true);
+                m_statistics.connected++;
+                m_connectedClients.push_back(client);
+                connectNext();
+            }
+        });
+        connect(client, &QXmppClient::errorOccurred, this, [this, client] {
+            if (!client->property("loadConnected").toBool() && !client->property("loadFailed").toBool()) {
+                client->setProperty("loadFailed", true);
+                m_statistics.connectFailures++;
+                connectNext();
+            }
+        });
+        connect(client, &QXmppClient::messageReceived, this, [this](const QXmppMessage &message) {
+            recordDelivery(Message, message.body());
+        });
+        connect(client, &QXmppClient::presenceReceived, this, [this](const QXmppPresence &presence) {
+            recordDelivery(Presence, presence.statusText());
+        });
+
+        client->setProperty("loadIndex", index);
+        return client;
+    }
+
+    void connectNext()
+    {
+        if (m_nextConnect >= m_count) {
+            return;
+        }
+        auto *client = m_clients[m_nextConnect++];
+
+        QXmppConfiguration config;
+        config.setDomain(m_config.domain);
+        config.setHost(u"127.0.0.1"_s);
+        config.setPort(m_config.port);
+        config.setUser(userName(client->property("loadIndex").toInt()));
+        config.setPassword(PASSWORD.toString());
+        config.setResource(u"load"_s);
+        config.setStreamSecurityMode(QXmppConfiguration::TLSDisabled);
+        config.setSaslAuthMechanism(m_config.mechanism);
+        config.setDisabledSaslMechanisms({});
+        client->connectToServer(config);
+    }
+
+    void recordDelivery(StanzaKind kind, const QString &sentAt)
+    {
+        bool ok = false;
+        const auto sent = sentAt.toLongLong(&ok);
+        if (ok) {
+            m_statistics.received[kind]++;
+            m_latencies[kind].record(timestamp() - sent);
+        }
+    }
+
+    StanzaKind randomKind()
+    {
+        const auto total = m_config.mix[Message] + m_config.mix[Presence] + m_config.mix[Iq];
+        auto value = int(m_random.bounded(total));
+        for (int kind = 0; kind < StanzaKindCount; kind++) {
+            if (value < m_config.mix[kind]) {
+                return StanzaKind(kind);
+            }
+            value -= m_config.mix[kind];
+        }
+        return Message;
+    }
+
+    void sendLoad()
+    {
+        if (m_connectedClients.empty()) {
+            return;
+        }
+
+        const auto now = m_loadClock.nsecsElapsed();
+        m_budget += m_config.rate * double(m_connectedClients.size()) * double(now - m_lastTick) / 1e9;
+        m_lastTick = now;
+
+        for (; m_budget >= 1.0; m_budget -= 1.0) {
+            auto *client = m_connectedClients[m_random.bounded(quint32(m_connectedClients.size()))];
+            const auto recipient = bareJid(int(m_random.bounded(m_config.clients)));
+            const auto sentAt = QString::number(timestamp());
+
+            switch (const auto kind = randomKind()) {
+            case Message: {
+                QXmppMessage message({}, recipient, sentAt);
+                client->sendPacket(message);
+                m_statistics.sent[kind]++;
+                break;
+            }
+            case Presence: {
+                QXmppPresence presence;
+                presence.setTo(recipient);
+                presence.setStatusText(sentAt);
+                client->sendPacket(presence);
+                m_statistics.sent[kind]++;
+                break;
+            }
+            case Iq: {
+                // answered by the server
+                QXmppPingIq ping;
+                ping.setTo(m_config.domain);
+                const auto sent = timestamp();
+                client->sendIq(std::move(ping)).then(this, [this, sent](auto &&) {
+                    m_statistics.received[Iq]++;
+                    m_latencies[Iq].record(timestamp() - sent);
+                });
+                m_statistics.sent[kind]++;
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+
+    const LoadConfig m_config;
+    const int m_firstIndex;
+    const int m_count;
+    LoadStatistics &m_statistics;
+
+    std::vector<QXmppClient *> m_clients;
+    std::vector<QXmppClient *> m_connectedClients;
+    int m_nextConnect = 0;
+
+    // a child, so it is moved into the thread of the group
+    QTimer m_loadTimer;
+    QElapsedTimer m_loadClock;
+    qint64 m_lastTick = 0;
+    double m_budget = 0;
+    QRandomGenerator m_random { quint32(m_firstIndex) };
+    Latencies m_latencies;
+};
+
+static double toMilliseconds(qint64 nsecs)
+{
+    return double(nsecs) / 1e6;
+}
+
+static double toMebibytes(qint64 bytes)
+{
+    return double(bytes) / (1024.0 * 1024.0);
+}
+
+static bool parseMix(const QString &text, std::array<int, StanzaKindCount> &mix)
+{
+    const auto parts = text.split(u',');
+    if (parts.size() != StanzaKindCount) {
+        return false;
+    }
+    int total = 0;
+    for (int i = 0; i < StanzaKindCount; i++) {
+        bool ok = false;
+        mix[i] = parts[i].toInt(&ok);
+        if (!ok || mix[i] < 0) {
+            return false;
+        }
+        total += mix[i];
+    }
+    return total > 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(u"qxmppserverload"_s);
+
+    LoadConfig config;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(u"Generates load on a local QXmppServer."_s);
+    parser.addHelpOption();
+    const QCommandLineOption clientsOption(u"clients"_s, u"Number of clients."_s, u"n"_s, QString::number(config.clients));
+    const QCommandLineOption threadsOption(u"threads"_s, u"Number of client threads."_s, u"n"_s, QString::number(config.threads));
+    const QCommandLineOption serverThreadsOption(u"server-threads"_s, u"Number of server worker threads."_s, u"n"_s, QString::number(config.serverThreads));
+    const QCommandLineOption durationOption(u"duration"_s, u"Seconds of load after all clients connected."_s, u"secs"_s, QString::number(config.duration));
+    const QCommandLineOption rateOption(u"rate"_s, u"Stanzas per client and second."_s, u"rate"_s, QString::number(config.rate));
+    const QCommandLineOption mixOption(u"mix"_s, u"Shares of messages, presences and IQs."_s, u"m,p,i"_s, u"70,20,10"_s);
+    const QCommandLineOption mechanismOption(u"mechanism"_s, u"SASL mechanism of the clients."_s, u"name"_s, config.mechanism);
+    parser.addOptions({ clientsOption, threadsOption, serverThreadsOption, durationOption, rateOption, mixOption, mechanismOption });
+    parser.process(app);
+
+    config.clients = std::max(1, parser.value(clientsOption).toInt());
+    config.threads = std::clamp(parser.value(threadsOption).toInt(), 1, config.clients);
+    config.serverThreads = std::max(0, parser.value(serverThreadsOption).toInt());
+    config.duration = std::max(1, parser.value(durationOption).toInt());
+    config.rate = std::max(0.0, parser.value(rateOption).toDouble());
+    config.mechanism = parser.value(mechanismOption);
+    if (!parseMix(parser.value(mixOption), config.mix)) {
+        std::fprintf(stderr, "Invalid stanza mix: %s\n", qPrintable(parser.value(mixOption)));
+        return EXIT_FAILURE;
+    }
+
+    // created in the main thread, the clients do not log
+    QXmppLogger::getLogger();
+
+    // server
+    LoadPasswordChecker passwordChecker;
+    QXmppServer server;
+    server.setDomain(config.domain);
+    server.setPasswordChecker(&passwordChecker);
+    server.setWorkerThreadCount(config.serverThreads);
+    config.port = freePort();
+    if (!server.listenForClients(QHostAddress::LocalHost, config.port)) {
+        std::fprintf(stderr, "Could not listen on port %d\n", config.port);
+        return EXIT_FAILURE;
+    }
+
+    // clients
+    LoadStatistics statistics;
+    std::vector<std::unique_ptr<QThread>> threads;
+    std::vector<ClientGroup *> groups;
+    for (int i = 0, first = 0; i < config.threads; i++) {
+        const auto count = config.clients / config.threads + (i < config.clients % config.threads ? 1 : 0);
+        auto thread = std::make_unique<QThread>();
+        thread->setObjectName(u"load %1"_s.arg(i));
+        auto *group = new ClientGroup(config, first, count, statistics);
+        group->moveToThread(thread.get());
+        QObject::connect(thread.get(), &QThread::finished, group, &QObject::deleteLater);
+        thread->start();
+        threads.push_back(std::move(thread));
+        groups.push_back(group);
+        first += count;
+    }
+
+    auto forEachGroup = [&](void (ClientGroup::*method)()) {
+        for (auto *group : groups) {
+            QMetaObject::invokeMethod(group, method, Qt::QueuedConnection);
+        }
+    };
+
+    const auto rssStart = residentSetSize();
+
+    // connect phase
+    QElapsedTimer phase;
+    phase.start();
+    forEachGroup(&ClientGroup::connectClients);
+    const auto connectTimeout = std::chrono::milliseconds(30s) + config.clients * 10ms;
+    waitUntil([&] { return statistics.connected + statistics.connectFailures >= config.clients; }, connectTimeout);
+    const auto connectNsecs = phase.nsecsElapsed();
+    const int connected = statistics.connected;
+    const auto rssConnected = residentSetSize();
+
+    // load phase
+    phase.restart();
+    forEachGroup(&ClientGroup::startLoad);
+    waitUntil([] { return false; }, std::chrono::seconds(config.duration));
+    forEachGroup(&ClientGroup::stopLoad);
+    const auto loadNsecs = phase.nsecsElapsed();
+
+    // wait for the stanzas in flight
+    auto allDelivered = [&] {
+        for (int kind = 0; kind < StanzaKindCount; kind++) {
+            if (statistics.received[kind] < statistics.sent[kind]) {
+                return false;
+            }
+        }
+        return true;
+    };
+    waitUntil(allDelivered, 5s);
+    const auto rssEnd = residentSetSize();
+
+    Latencies latencies;
+    for (auto *group : groups) {
+        Latencies groupLatencies;
+        QMetaObject::invokeMethod(group, &ClientGroup::latencies, Qt::BlockingQueuedConnection, &groupLatencies);
+        for (int kind = 0; kind < StanzaKindCount; kind++) {
+            latencies[kind].merge(groupLatencies[kind]);
+        }
+    }
+
+    // report
+    const auto loadSeconds = double(loadNsecs) / 1e9;
+    std::printf("clients          %d on %d threads, %d server worker threads\n", config.clients, config.threads, config.serverThreads);
+    std::printf("connected        %d in %.2f s (%.1f connects/s), %d failed\n",
+                connected,
+                double(connectNsecs) / 1e9,
+                double(connected) / (double(connectNsecs) / 1e9),
+                int(statistics.connectFailures));
+
+    quint64 totalSent = 0;
+    quint64 totalReceived = 0;
+    for (int kind = 0; kind < StanzaKindCount; kind++) {
+        totalSent += statistics.sent[kind];
+        totalReceived += statistics.received[kind];
+    }
+    std::printf("stanzas          %llu sent (%.1f/s), %llu delivered (%.1f/s) in %.2f s\n",
+                static_cast<unsigned long long>(totalSent),
+                double(totalSent) / loadSeconds,
+                static_cast<unsigned long long>(totalReceived),
+                double(totalReceived) / loadSeconds,
+                loadSeconds);
+    for (int kind = 0; kind < StanzaKindCount; kind++) {
+        std::printf("  %-14s %llu sent, %llu delivered, latency p50 %.3f ms, p99 %.3f ms\n",
+                    STANZA_KIND_NAMES[kind],
+                    static_cast<unsigned long long>(statistics.sent[kind]),
+                    static_cast<unsigned long long>(statistics.received[kind]),
+                    toMilliseconds(latencies[kind].percentile(0.5)),
+                    toMilliseconds(latencies[kind].percentile(0.99)));
+    }
+    std::printf("rss              %.1f MiB at start, %.1f MiB connected, %.1f MiB at end\n",
+                toMebibytes(rssStart),
+                toMebibytes(rssConnected),
+                toMebibytes(rssEnd));
+    std::fflush(stdout);
+
+    // shut down
+    forEachGroup(&ClientGroup::disconnectClients);
+    waitUntil([] { return false; }, 200ms);
+    for (const auto &thread : threads) {
+        thread->quit();
+        thread->wait();
+    }
+    server.close();
+
+    return connected == config.clients && totalReceived > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#include "qxmppserverload.moc"
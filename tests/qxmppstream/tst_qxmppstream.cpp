@@ -4,6 +4,7 @@
 
 #include "QXmppBindIq.h"
 #include "QXmppConstants_p.h"
+#include "QXmppMetrics_p.h"
 
 #include "Stream.h"
 #include "StreamError.h"
@@ -12,6 +13,10 @@
 #include "compat/QXmppStartTlsPacket.h"
 #include "util.h"
 
+#include <QSslSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+
 using namespace QXmpp;
 using namespace QXmpp::Private;
 
@@ -24,7 +29,11 @@ class tst_QXmppStream : public QObject
 private:
     Q_SLOT void initTestCase();
     Q_SLOT void testProcessData();
+    Q_SLOT void testProcessRawData();
+    Q_SLOT void testUnsupportedEncoding();
+    Q_SLOT void testStanzaDataCapture();
 #ifdef BUILD_INTERNAL_TESTS
+    Q_SLOT void testWriteCoalescing();
     Q_SLOT void streamOpen();
     Q_SLOT void testStreamError();
     Q_SLOT void starttlsPackets();
@@ -108,7 +117,161 @@ void tst_QXmppStream::testProcessData()
     socket.processData(R"(</stream:stream>)");
 }
 
+void tst_QXmppStream::testProcessRawData()
+{
+    XmppSocket socket(this);
+
+    QSignalSpy onStreamReceived(&socket, &XmppSocket::streamReceived);
+    QSignalSpy onStanzaReceived(&socket, &XmppSocket::stanzaReceived);
+    std::optional<StreamError> error;
+    connect(&socket, &XmppSocket::errorOccurred, this, [&](const QString &, std::variant<StreamError, QAbstractSocket::SocketError> condition) {
+        error = std::get<StreamError>(condition);
+    });
+
+    socket.processRawData(QByteArrayLiteral("<?xml version='1.0' encoding='UTF-8'?>"
+                                            "<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'>"));
+    QCOMPARE(onStreamReceived.size(), 1);
+
+    // multi-byte character split across two reads
+    const auto body = u"Grüße \U0001F600"_s.toUtf8();
+    const auto xml = QByteArrayLiteral("<message to='stpeter@im.example.com'><body>") + body + QByteArrayLiteral("</body></message>");
+    const auto splitPos = xml.indexOf(body) + 3;
+    socket.processRawData(xml.left(splitPos));
+    QCOMPARE(onStanzaReceived.size(), 0);
+    socket.processRawData(xml.mid(splitPos));
+    QCOMPARE(onStanzaReceived.size(), 1);
+
+    const auto message = onStanzaReceived[0][0].value<QDomElement>();
+    QCOMPARE(message.tagName(), u"message"_s);
+    QCOMPARE(message.firstChildElement(u"body"_s).text(), u"Grüße \U0001F600"_s);
+
+    // whitespace ping
+    socket.processRawData(QByteArrayLiteral(" "));
+    QCOMPARE(onStanzaReceived.size(), 2);
+    QVERIFY(onStanzaReceived[1][0].value<QDomElement>().isNull());
+
+    // errors are reported the same way as before
+    socket.processRawData(QByteArrayLiteral("<message><body>Moin</message>"));
+    QVERIFY(error);
+    QCOMPARE(*error, StreamError::NotWellFormed);
+}
+
+void tst_QXmppStream::testStanzaDataCapture()
+{
+    XmppSocket socket(this);
+    socket.setStanzaDataCaptureEnabled(true);
+
+    QList<QByteArray> stanzaData;
+    connect(&socket, &XmppSocket::stanzaReceived, this, [&](const QDomElement &element) {
+        if (!element.isNull()) {
+            stanzaData.append(socket.receivedStanzaData());
+        }
+    });
+
+    socket.processRawData(QByteArrayLiteral("<?xml version='1.0' encoding='UTF-8'?>"
+                                            "<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'>"));
+
+    // multi-byte characters, split across reads, followed by whitespace and another stanza
+    const auto message = u"<message to='stpeter@im.example.com'><body>Grüße \U0001F600</body></message>"_s.toUtf8();
+    const auto presence = QByteArrayLiteral("<presence/>");
+    const auto xml = message + "\n  " + presence + message;
+    const auto splitPos = xml.indexOf("\xC3") + 1;
+    socket.processRawData(xml.left(splitPos));
+    QVERIFY(stanzaData.isEmpty());
+    socket.processRawData(xml.mid(splitPos));
+    QCOMPARE(stanzaData.size(), 3);
+    QCOMPARE(stanzaData[0], message);
+    QCOMPARE(stanzaData[1], presence);
+    QCOMPARE(stanzaData[2], message);
+
+    // data is not available outside of stanzaReceived()
+    QVERIFY(socket.receivedStanzaData().isEmpty());
+
+    // stanzas with own default namespace or prefixes of the stream can not be copied
+    socket.processRawData(QByteArrayLiteral("<message xmlns='jabber:client'><body>Hi</body></message>"
+                                            "<stream:error><conflict xmlns='urn:ietf:params:xml:ns:xmpp-streams'/></stream:error>"));
+    QCOMPARE(stanzaData.size(), 5);
+    QVERIFY(stanzaData[3].isEmpty());
+    QVERIFY(stanzaData[4].isEmpty());
+}
+
+void tst_QXmppStream::testUnsupportedEncoding()
+{
+    XmppSocket socket(this);
+
+    QSignalSpy onStreamReceived(&socket, &XmppSocket::streamReceived);
+    std::optional<StreamError> error;
+    connect(&socket, &XmppSocket::errorOccurred, this, [&](const QString &, std::variant<StreamError, QAbstractSocket::SocketError> condition) {
+        error = std::get<StreamError>(condition);
+    });
+
+    socket.processRawData(QByteArrayLiteral("<?xml version='1.0' encoding='ISO-8859-1'?>"
+                                            "<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'>"));
+    QCOMPARE(onStreamReceived.size(), 0);
+    QVERIFY(error);
+    QCOMPARE(*error, StreamError::UnsupportedEncoding);
+}
+
 #ifdef BUILD_INTERNAL_TESTS
+void tst_QXmppStream::testWriteCoalescing()
+{
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    XmppSocket socket(nullptr);
+    socket.connectToHost({ ServerAddress::Tcp, u"127.0.0.1"_s, server.serverPort() });
+    QVERIFY(server.waitForNewConnection(5000));
+    auto *peer = server.nextPendingConnection();
+    QTRY_VERIFY(socket.isConnected());
+
+    auto metrics = StreamMetrics::create(std::make_shared<QXmppMetrics>(), u"test"_s);
+    socket.setMetrics(metrics);
+
+    auto writes = [&] { return int(socket.writeStatistics().writes); };
+    auto flushes = [&] { return int(socket.writeStatistics().flushes); };
+
+    // without coalescing every write goes to the socket directly
+    QVERIFY(socket.sendData("<a/>"));
+    QCOMPARE(writes(), 1);
+    QCOMPARE(flushes(), 1);
+
+    // writes of one event loop iteration are written at once
+    socket.setWriteCoalescingEnabled(true);
+    QVERIFY(socket.sendData("<b/>"));
+    QVERIFY(socket.sendData("<c/>"));
+    QVERIFY(socket.sendData("<r xmlns='urn:xmpp:sm:3'/>"));
+    QCOMPARE(writes(), 4);
+    QCOMPARE(flushes(), 1);
+    QTRY_COMPARE(flushes(), 2);
+    QCOMPARE(int(socket.writeStatistics().bytes), 38);
+
+    // the statistics are also reported as metrics
+    QCOMPARE(metrics->writes->value(), qint64(4));
+    QCOMPARE(metrics->flushes->value(), qint64(2));
+    QCOMPARE(metrics->bytesSent->value(), qint64(38));
+
+    QByteArray received;
+    QTRY_VERIFY((received += peer->readAll()).size() == 38);
+    QCOMPARE(received, QByteArray("<a/><b/><c/><r xmlns='urn:xmpp:sm:3'/>"));
+
+    // exceeding the threshold writes immediately
+    socket.setFlushThreshold(8);
+    QVERIFY(socket.sendData("<d/>"));
+    QCOMPARE(flushes(), 2);
+    QVERIFY(socket.sendData("<e/>"));
+    QCOMPARE(flushes(), 3);
+
+    // explicit flush
+    QVERIFY(socket.sendData("<f/>"));
+    QVERIFY(socket.flush());
+    QCOMPARE(flushes(), 4);
+    QCOMPARE(writes(), 7);
+
+    // the scheduled flush has nothing left to do
+    QTest::qWait(0);
+    QCOMPARE(flushes(), 4);
+}
+
 void tst_QXmppStream::streamOpen()
 {
     auto xml = "<?xml version='1.0' encoding='UTF-8'?><stream:stream from='juliet@im.example.com' to='im.example.com' id='abcdefg' version='1.0' xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'>";